@@ -0,0 +1,506 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The benchmark needs POSIX clocks and threads, beyond C99. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <exbo.h>
+#include <exbo_inline.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define Z_HAVE_TSC 1
+#else
+#define Z_HAVE_TSC 0
+#endif
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+/* Each worker cycles over this many instances, a power of two */
+#define Z_INSTANCES 64
+
+/* The cost of an attempt */
+#define Z_A ((int64_t)1000)
+
+/* Operations per measurement, unless given on the command line */
+#define Z_DEFAULT_OPS ((int64_t)1 << 18)
+
+/* Largest number of threads in a measurement */
+#define Z_MAXIMUM_THREADS 8
+
+/*********************************
+ * internal struct, union,
+ * typedef and enum declarations
+ *********************************/
+enum regime {
+    Z_UNDER,            // A <= D < L
+    Z_SATURATED,        // D == L
+    Z_OVER              // D > L
+};
+
+enum engine {
+    Z_DOUBLE,
+    Z_TABLE,
+    Z_INTEGER
+};
+
+/* One measurement: what was run, and how often */
+struct run {
+    const char *benchmark;
+    enum engine engine;
+    enum regime regime;
+    double X;
+    int64_t LOverA;
+    int threads;
+    int64_t ops;        // per thread
+};
+
+/* A thread's instances, each held in the regime of the run.  Recording
+ * an instance at intervals of A leaves its debt where it is, and
+ * recording it at intervals of 0 adds A to it.
+ */
+struct worker {
+    const struct run *run;
+    exbo instances[Z_INSTANCES];
+    int64_t times[Z_INSTANCES];
+    int64_t gap;
+    int64_t sink;
+    pthread_t thread;
+};
+
+/*********************************
+ * internal data declarations
+ *********************************/
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zClock(int64_t *nsp, uint64_t *cyclesp);
+static void zReport(const struct run *r, int64_t ns, uint64_t cycles);
+static int zWorkerInit(struct worker *w, const struct run *r);
+static void zWorkerFini(struct worker *w);
+static void *zWorkerRecord(void *arg);
+static void *zWorkerGetNext(void *arg);
+static void *zWorkerGetNextInline(void *arg);
+static void *zWorkerAtomic(void *arg);
+static void zMeasure(const struct run *r, void *(*body)(void *));
+static void zBenchCreate(int64_t ops);
+static void zBenchRecord(int64_t ops);
+static void zBenchIntegerEngine(int64_t ops);
+static void zBenchThreads(int64_t ops);
+static void zBenchClock(int64_t ops);
+
+/*********************************
+ * external data definitions
+ *********************************/
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static const char *const zRegimeNames[3] = {"under", "saturated", "over"};
+static const char *const zEngineNames[3] = {"double", "table", "integer"};
+static const double zXs[5] = {1.0, 1.01, 1.5, 2.0, 4.0};
+static const int64_t zLOverAs[4] = {1, 2, 6, 100};
+
+/* X near 1, where the bracket of J, about 1/(X - 1) wide, is widest */
+static const double zNearOneXs[3] = {1.001, 1.0001, 1.000001};
+
+/* Per clock source: reading the clock, then recording at its time */
+static const char *const zClockNames[4][2] = {
+    {"clock_now_monotonic", "record_now_monotonic"},
+    {"clock_now_coarse", "record_now_coarse"},
+    {"clock_now_tsc", "record_now_tsc"},
+    {"clock_now_manual", "record_now_manual"}
+};
+
+/* Shared by the threads of the atomic benchmark */
+static exboConfig zAtomicConfig;
+static exboAtomicState zAtomicState;
+static int64_t zAtomicClock;
+
+/*********************************
+ * external function definitions
+ *********************************/
+/* Writes one JSON object per line to stdout for each measurement:
+ * ns_per_op is wall-clock time per operation over all threads, and
+ * cycles_per_op counts time stamp counter ticks, or is null where there
+ * is no such counter.  An optional argument sets the operations per
+ * thread in each measurement.
+ */
+int main(int argc, char **argv) {
+    int64_t ops = Z_DEFAULT_OPS;
+    if (argc > 1) {
+        ops = (int64_t)strtoll(argv[1], (char **)0, 10);
+    }
+    if (ops > (int64_t)0) {
+        zBenchCreate(ops);
+        zBenchRecord(ops);
+        zBenchIntegerEngine(ops);
+        zBenchThreads(ops);
+        zBenchClock(ops);
+    } else {
+        fprintf(stderr, "usage: %s [operations]\n", argv[0]);
+    }
+    return (ops > (int64_t)0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zClock(int64_t *nsp, uint64_t *cyclesp) {
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    *nsp = (int64_t)now.tv_sec * (int64_t)1000000000 + (int64_t)now.tv_nsec;
+#if Z_HAVE_TSC
+    *cyclesp = (uint64_t)__rdtsc();
+#else
+    *cyclesp = UINT64_C(0);
+#endif
+    return;
+}
+
+static void zReport(const struct run *r, int64_t ns, uint64_t cycles) {
+    double ops = (double)r->ops * (double)r->threads;
+    printf("{\"benchmark\":\"%s\",\"engine\":\"%s\",\"regime\":\"%s\",\"X\":%.17g,\"L_over_A\":%lld,"
+           "\"threads\":%d,\"ops\":%.0f,\"ns_per_op\":%.3f,",
+           r->benchmark, zEngineNames[r->engine], zRegimeNames[r->regime], r->X, (long long)r->LOverA,
+           r->threads, ops, (double)ns / ops);
+    if (Z_HAVE_TSC) {
+        printf("\"cycles_per_op\":%.3f}\n", (double)cycles / ops);
+    } else {
+        printf("\"cycles_per_op\":null}\n");
+    }
+    fflush(stdout);
+    return;
+}
+
+static int zWorkerInit(struct worker *w, const struct run *r) {
+    // Create the instances and bring each to its debt in the regime.
+    int64_t A = Z_A;
+    int64_t L = Z_A * r->LOverA;
+    int result = 0;
+    int j;
+    w->run = r;
+    w->gap = (r->regime == Z_OVER) ? (int64_t)0 : A;
+    w->sink = (int64_t)0;
+    // Any instance not created is 0, for zWorkerFini().
+    for (j = 0; j < Z_INSTANCES; j++) {
+        w->instances[j] = (exbo)0;
+    }
+    for (j = 0; j < Z_INSTANCES; j++) {
+        exbo xp = exboCreateConfigured(r->X, A, L);
+        int64_t D;
+        int64_t k;
+        if (r->regime == Z_UNDER) {
+            D = A + (L - A) * (int64_t)j / (int64_t)Z_INSTANCES;
+        } else if (r->regime == Z_SATURATED) {
+            D = L;
+        } else {
+            D = L + (int64_t)1 + L * (int64_t)j / (int64_t)Z_INSTANCES;
+        }
+        w->instances[j] = xp;
+        if (xp == (exbo)0) {
+            result = ExboErr_OutOfMemory;
+            break;
+        }
+        if (r->engine == Z_TABLE) {
+            (void)exboConfigure_TableSize(xp, (int64_t)1024);
+        } else if (r->engine == Z_INTEGER) {
+            (void)exboConfigure_Engine(xp, ExboEngine_Integer);
+        }
+        if ((result = exboFinishConfig(xp)) != 0) {
+            break;
+        }
+        // Each record at the same time adds A; a last one, A - D % A
+        // later, adds the remainder.
+        w->times[j] = (int64_t)0;
+        for (k = (int64_t)0; k < D / A; k++) {
+            (void)exboRecordAttempt(xp, w->times[j]);
+        }
+        if (D % A != (int64_t)0) {
+            w->times[j] += A - D % A;
+            (void)exboRecordAttempt(xp, w->times[j]);
+        }
+    }
+    return result;
+}
+
+static void zWorkerFini(struct worker *w) {
+    int j;
+    for (j = 0; j < Z_INSTANCES; j++) {
+        if (w->instances[j] != (exbo)0) {
+            exboDestroy(w->instances[j]);
+            w->instances[j] = (exbo)0;
+        }
+    }
+    return;
+}
+
+static void *zWorkerRecord(void *arg) {
+    struct worker *w = (struct worker *)arg;
+    int64_t ops = w->run->ops;
+    int64_t gap = w->gap;
+    int64_t sink = (int64_t)0;
+    int64_t i;
+    for (i = (int64_t)0; i < ops; i++) {
+        int j = (int)(i & (int64_t)(Z_INSTANCES - 1));
+        w->times[j] += gap;
+        sink += (int64_t)exboRecordAttempt(w->instances[j], w->times[j]);
+    }
+    w->sink = sink;
+    return (void *)0;
+}
+
+static void *zWorkerGetNext(void *arg) {
+    struct worker *w = (struct worker *)arg;
+    int64_t ops = w->run->ops;
+    int64_t sink = (int64_t)0;
+    int64_t i;
+    for (i = (int64_t)0; i < ops; i++) {
+        sink += exboGetNextAttemptTime(w->instances[(int)(i & (int64_t)(Z_INSTANCES - 1))]);
+    }
+    w->sink = sink;
+    return (void *)0;
+}
+
+static void *zWorkerGetNextInline(void *arg) {
+    struct worker *w = (struct worker *)arg;
+    int64_t ops = w->run->ops;
+    int64_t sink = (int64_t)0;
+    int64_t i;
+    for (i = (int64_t)0; i < ops; i++) {
+        sink += exboInlineGetNextAttemptTime(w->instances[(int)(i & (int64_t)(Z_INSTANCES - 1))]);
+    }
+    w->sink = sink;
+    return (void *)0;
+}
+
+static void *zWorkerAtomic(void *arg) {
+    // Every thread records on the one shared state, at times drawn from
+    // a shared clock, so that they contend for it.
+    struct worker *w = (struct worker *)arg;
+    int64_t ops = w->run->ops;
+    int64_t sink = (int64_t)0;
+    int64_t i;
+    for (i = (int64_t)0; i < ops; i++) {
+        int64_t time = __atomic_fetch_add(&zAtomicClock, Z_A, __ATOMIC_RELAXED);
+        sink += (int64_t)exboAtomicStateRecordAttempt(zAtomicConfig, &zAtomicState, time);
+    }
+    w->sink = sink;
+    return (void *)0;
+}
+
+static void zMeasure(const struct run *r, void *(*body)(void *)) {
+    // Time r->threads workers running body at once.
+    static struct worker workers[Z_MAXIMUM_THREADS];
+    int64_t ns[2];
+    uint64_t cycles[2];
+    int ready = 1;
+    int initialized = 0;
+    int t;
+    // Stop at the first worker that fails, which is still finished below.
+    while (ready && (initialized < r->threads)) {
+        ready = (zWorkerInit(&workers[initialized], r) == 0);
+        initialized++;
+    }
+    if (ready) {
+        zClock(&ns[0], &cycles[0]);
+        if (r->threads == 1) {
+            (void)body((void *)&workers[0]);
+        } else {
+            for (t = 0; t < r->threads; t++) {
+                (void)pthread_create(&workers[t].thread, (const pthread_attr_t *)0, body, (void *)&workers[t]);
+            }
+            for (t = 0; t < r->threads; t++) {
+                (void)pthread_join(workers[t].thread, (void **)0);
+            }
+        }
+        zClock(&ns[1], &cycles[1]);
+        zReport(r, ns[1] - ns[0], cycles[1] - cycles[0]);
+    } else {
+        fprintf(stderr, "%s: X %g, L/A %lld: the instances could not be set up\n", r->benchmark, r->X,
+                (long long)r->LOverA);
+    }
+    for (t = 0; t < initialized; t++) {
+        zWorkerFini(&workers[t]);
+    }
+    return;
+}
+
+static void zBenchCreate(int64_t ops) {
+    // Creating on the heap and initializing in place
+    struct run run = {"create_destroy", Z_DOUBLE, Z_UNDER, 2.0, (int64_t)6, 1, (int64_t)0};
+    exboStorage storage;
+    int64_t ns[2];
+    uint64_t cycles[2];
+    int64_t i;
+    run.ops = ops;
+    zClock(&ns[0], &cycles[0]);
+    for (i = (int64_t)0; i < ops; i++) {
+        exboDestroy(exboCreateConfigured(2.0, Z_A, Z_A * (int64_t)6));
+    }
+    zClock(&ns[1], &cycles[1]);
+    zReport(&run, ns[1] - ns[0], cycles[1] - cycles[0]);
+    run.benchmark = "init_fini";
+    zClock(&ns[0], &cycles[0]);
+    for (i = (int64_t)0; i < ops; i++) {
+        exboFini(exboInitConfigured(&storage, 2.0, Z_A, Z_A * (int64_t)6));
+    }
+    zClock(&ns[1], &cycles[1]);
+    zReport(&run, ns[1] - ns[0], cycles[1] - cycles[0]);
+    return;
+}
+
+static void zBenchRecord(int64_t ops) {
+    // Every engine, X, L/A and regime; there is no under-saturated
+    // regime when L == A.
+    struct run run = {"record", Z_DOUBLE, Z_UNDER, 2.0, (int64_t)6, 1, (int64_t)0};
+    int e;
+    int x;
+    int l;
+    int g;
+    run.ops = ops;
+    for (e = Z_DOUBLE; e <= Z_INTEGER; e++) {
+        run.engine = (enum engine)e;
+        run.benchmark = "get_next";
+        run.X = 2.0;
+        run.LOverA = (int64_t)6;
+        run.regime = Z_UNDER;
+        zMeasure(&run, zWorkerGetNext);
+        run.benchmark = "get_next_inline";
+        zMeasure(&run, zWorkerGetNextInline);
+        run.benchmark = "record";
+        for (x = 0; x < (int)(sizeof(zXs) / sizeof(zXs[0])); x++) {
+            run.X = zXs[x];
+            for (l = 0; l < (int)(sizeof(zLOverAs) / sizeof(zLOverAs[0])); l++) {
+                run.LOverA = zLOverAs[l];
+                for (g = Z_UNDER; g <= Z_OVER; g++) {
+                    run.regime = (enum regime)g;
+                    if ((run.regime != Z_UNDER) || (run.LOverA > (int64_t)1)) {
+                        zMeasure(&run, zWorkerRecord);
+                    }
+                }
+            }
+        }
+    }
+    return;
+}
+
+static void zBenchIntegerEngine(int64_t ops) {
+    // The integer engine beside the double one, under-saturated, as X
+    // nears 1 and the search for J has the most to cover.
+    struct run run = {"record_near_one", Z_DOUBLE, Z_UNDER, 2.0, (int64_t)6, 1, (int64_t)0};
+    int x;
+    int l;
+    run.ops = ops;
+    for (x = 0; x < (int)(sizeof(zNearOneXs) / sizeof(zNearOneXs[0])); x++) {
+        run.X = zNearOneXs[x];
+        for (l = 2; l < (int)(sizeof(zLOverAs) / sizeof(zLOverAs[0])); l++) {
+            run.LOverA = zLOverAs[l];
+            run.engine = Z_DOUBLE;
+            zMeasure(&run, zWorkerRecord);
+            run.engine = Z_INTEGER;
+            zMeasure(&run, zWorkerRecord);
+        }
+    }
+    return;
+}
+
+static void zBenchThreads(int64_t ops) {
+    // Private instances per thread, then one atomic state shared by all.
+    struct run run = {"record", Z_DOUBLE, Z_UNDER, 2.0, (int64_t)6, 1, (int64_t)0};
+    int threads;
+    run.ops = ops;
+    for (threads = 1; threads <= Z_MAXIMUM_THREADS; threads *= 2) {
+        run.threads = threads;
+        run.benchmark = "record";
+        zMeasure(&run, zWorkerRecord);
+        run.benchmark = "record_atomic_shared";
+        zAtomicConfig = exboConfigCreate(run.X, Z_A, Z_A * run.LOverA);
+        (void)exboAtomicStateInit(&zAtomicState);
+        zAtomicClock = (int64_t)0;
+        if (zAtomicConfig != (exboConfig)0) {
+            zMeasure(&run, zWorkerAtomic);
+            exboConfigDestroy(zAtomicConfig);
+        }
+    }
+    return;
+}
+
+static void zBenchClock(int64_t ops) {
+    // Each clock source, in the milliseconds of the default A; a source
+    // that this machine lacks is skipped.
+    struct run run = {"clock_now", Z_DOUBLE, Z_OVER, 2.0, (int64_t)6, 1, (int64_t)0};
+    exbo xp = exboCreateConfigured(2.0, Z_A, Z_A * (int64_t)6);
+    int64_t ns[2];
+    uint64_t cycles[2];
+    int64_t sink = (int64_t)0;
+    int64_t i;
+    int source;
+    run.ops = ops;
+    (void)exboClockSet((int64_t)0);
+    for (source = ExboClock_Monotonic; source <= ExboClock_Manual; source++) {
+        if (exboClockConfigure(source, (int64_t)1000) == 0) {
+            run.benchmark = zClockNames[source][0];
+            zClock(&ns[0], &cycles[0]);
+            for (i = (int64_t)0; i < ops; i++) {
+                sink += exboClockNow();
+            }
+            zClock(&ns[1], &cycles[1]);
+            zReport(&run, ns[1] - ns[0], cycles[1] - cycles[0]);
+            run.benchmark = zClockNames[source][1];
+            zClock(&ns[0], &cycles[0]);
+            for (i = (int64_t)0; i < ops; i++) {
+                sink += (int64_t)exboRecordAttemptNow(xp);
+            }
+            zClock(&ns[1], &cycles[1]);
+            zReport(&run, ns[1] - ns[0], cycles[1] - cycles[0]);
+        }
+    }
+    (void)exboClockConfigure(ExboClock_Monotonic, (int64_t)1000);
+    exboDestroy(xp);
+    if (sink == (int64_t)1) {
+        // Keep the reads from being optimized away
+        printf("\n");
+    }
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
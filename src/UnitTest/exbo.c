@@ -0,0 +1,1705 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The unit tests exercise the internal functions directly, with the
+ * statistics compiled in unless the build says otherwise; the Makefile
+ * builds them both ways.
+ */
+#ifndef EXBO_STATS
+#define EXBO_STATS 1
+#endif
+#include "../exbo.c"
+#include <pthread.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Tolerance of the interval solver against the oracle */
+#define SOLVER_RELATIVE_TOLERANCE (1.0e-12)
+#define SOLVER_CASES 200000
+
+/* Tolerance of the integer engine against the double engine */
+#define INTEGER_RELATIVE_TOLERANCE (1.0e-9)
+#define INTEGER_CASES 100000
+
+/* Configs, and debts per config, in the comparison with the oracle; the
+ * first ORACLE_TABLES configs are also tabulated, some of them only in part.
+ */
+#define ORACLE_CONFIGS 4000
+#define ORACLE_DEBTS 50
+#define ORACLE_TABLES 200
+#define ORACLE_TABLE_SIZE ((int64_t)4096)
+
+/* Largest relative error against the oracle: the double engine may be
+ * off by 2^-30 near X = 1, and the integer engine keeps full precision.
+ */
+#define ORACLE_DOUBLE_TOLERANCE (1.0e-9L)
+#define ORACLE_INTEGER_TOLERANCE (1.0e-15L)
+
+/* Elements per batch in the batch kernel comparison */
+#define BATCH_SIZE 1003
+
+/* Threads and records per thread in the atomic stress test */
+#define STRESS_THREADS 8
+#define STRESS_RECORDS 50000
+
+/* Threads and records per thread counted by the statistics test */
+#define STATS_THREADS 4
+#define STATS_RECORDS 1000
+
+/* Attempts recorded against several levels at once */
+#define LEVELS 3
+#define LEVEL_ATTEMPTS 2000
+
+/* Weighted attempts compared with as many single attempts */
+#define WEIGHTED_CASES 2000
+#define WEIGHTED_MAXIMUM_UNITS 500
+
+/* Records per jitter mode, and clients in the retry storm */
+#define JITTER_RECORDS 20000
+#define JITTER_CLIENTS 1000
+
+/* Threads, each creating and destroying instances, in the pool test */
+#define POOL_THREADS 20
+#define POOL_INSTANCES 200
+
+/*********************************
+ * internal struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* The largest error of one engine against the oracle */
+struct oracleError {
+    const char *engine;
+    long double maxAbsolute;
+    long double maxRelative;
+    int cases;
+};
+
+/* What the counting allocator has handed out */
+struct allocatorCounts {
+    int64_t allocations;
+    int64_t frees;
+    int64_t bytes;
+};
+
+struct stressRecord {
+    int64_t time;
+    int result;
+};
+
+/* Each stats thread draws from its own seed and keeps its own failures,
+ * as zCheck() and zRandom() are not thread-safe.
+ */
+struct statsThread {
+    exboConfig config;
+    uint64_t seed;
+    int failures;
+};
+
+struct stressThread {
+    exboConfig config;
+    exboAtomicState *state;
+    uint64_t seed;
+    struct stressRecord records[STRESS_RECORDS];
+};
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line);
+static uint64_t zRandom(void);
+static double zRandomUnit(void);
+static void *zCountingAllocate(size_t size, void *context);
+static void zCountingFree(void *p, size_t size, void *context);
+static void *zPoolThread(void *arg);
+static void zTestAllocator(void);
+static void zTestSolverMatchesOracle(void);
+static long double zOracle_m(int64_t J, long double lnX, long double XMinusOne);
+static int64_t zOracle_J(long double l, long double lnX, long double XMinusOne);
+static long double zOracleInterval(int64_t L, int64_t A, double X, int64_t D);
+static void zOracleAccount(struct oracleError *ep, long double value, long double reference, int rounded);
+static void zOracleReport(const struct oracleError *ep);
+static void zTestEnginesMatchOracle(void);
+static void zTestInstanceAndStateAgree(void);
+static void zTestStorage(void);
+static void zTestIntegerEngineMatchesDouble(void);
+static void zTestIntegerEngineInstance(void);
+static void zBatchFill(int64_t L, int64_t *T, int64_t *D, int64_t *I, int64_t *time);
+static void zTestBatchKernel(exboConfig cp, const char *name,
+                             void (*kernel)(const struct config *, size_t, int64_t *, int64_t *, int64_t *,
+                                            const int64_t *, int *));
+static void zTestBatchMatchesScalar(void);
+static void *zStressThread(void *arg);
+static int zCompareStressRecords(const void *a, const void *b);
+static void zTestAtomicStress(void);
+static void zTestTryAttempt(void);
+static void zSnapshotForge(exbo xp, unsigned char *buffer, int at, uint64_t value, int width);
+static void zTestSnapshot(void);
+static void zTestInlineAccessors(void);
+static void zTestLevels(void);
+static void zTestWeighted(void);
+static exbo zJitterCreate(int jitter, int seeded, uint64_t seed);
+static int zCompareTimes(const void *a, const void *b);
+static void zTestJitter(void);
+static void zTestWarnings(void);
+static void zTestRecordContract(void);
+static void *zStatsThread(void *arg);
+static void zStatsCheckGrowth(const exboStats *before, const exboStats *after, const exboStats *expected);
+static void zTestStats(void);
+static void zTestStatsSink(void);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+static int64_t zStressClock = (int64_t)0;
+static uint64_t zRandomState = UINT64_C(0x9e3779b97f4a7c15);
+static struct allocatorCounts zAllocatorCounts;
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    // First, before anything holds memory from the default allocator
+    zTestAllocator();
+    zTestSolverMatchesOracle();
+    zTestEnginesMatchOracle();
+    zTestInstanceAndStateAgree();
+    zTestStorage();
+    zTestIntegerEngineMatchesDouble();
+    zTestIntegerEngineInstance();
+    zTestBatchMatchesScalar();
+    zTestAtomicStress();
+    zTestTryAttempt();
+    zTestSnapshot();
+    zTestInlineAccessors();
+    zTestLevels();
+    zTestWeighted();
+    zTestJitter();
+    zTestWarnings();
+    zTestRecordContract();
+    zTestStats();
+    zTestStatsSink();
+    if (zFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+static void *zCountingAllocate(size_t size, void *context) {
+    struct allocatorCounts *cp = (struct allocatorCounts *)context;
+    (void)__atomic_add_fetch(&cp->allocations, (int64_t)1, __ATOMIC_RELAXED);
+    (void)__atomic_add_fetch(&cp->bytes, (int64_t)size, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+static void zCountingFree(void *p, size_t size, void *context) {
+    struct allocatorCounts *cp = (struct allocatorCounts *)context;
+    (void)__atomic_add_fetch(&cp->frees, (int64_t)1, __ATOMIC_RELAXED);
+    (void)__atomic_sub_fetch(&cp->bytes, (int64_t)size, __ATOMIC_RELAXED);
+    free(p);
+    return;
+}
+
+static void *zPoolThread(void *arg) {
+    exbo instances[POOL_INSTANCES];
+    int i;
+    (void)arg;
+    for (i = 0; i < POOL_INSTANCES; i++) {
+        instances[i] = exboCreate();
+    }
+    for (i = 0; i < POOL_INSTANCES; i++) {
+        exboDestroy(instances[i]);
+    }
+    return arg;
+}
+
+/* Memory comes through the hooks, is returned with the size it was
+ * asked for, and churning instances, even across threads that come
+ * and go, reuses pool blocks rather than allocating.  Setting the
+ * allocator follows the one-shot contract of the pool.  The counting
+ * hooks stay in place for the tests that follow.
+ */
+static void zTestAllocator(void) {
+    exbo xp;
+    exbo yp;
+    exboConfig cp;
+    pthread_t id;
+    int64_t allocations;
+    int64_t bytes;
+    int expected;
+    int i;
+    CHECK(exboSetAllocator(zCountingAllocate, 0, (void *)0) == ExboErr_AllocatorIncomplete);
+    CHECK(exboSetAllocator(0, zCountingFree, (void *)0) == ExboErr_AllocatorIncomplete);
+    CHECK(exboSetAllocator(zCountingAllocate, zCountingFree, (void *)&zAllocatorCounts) == 0);
+    xp = exboCreate();
+    CHECK(xp != (exbo)0);
+    CHECK(zAllocatorCounts.allocations > 0);
+    CHECK(exboSetAllocator(0, 0, (void *)0) == ExboErr_AllocatorInUse);
+    // A table of the same size is kept; another size replaces it.
+    bytes = zAllocatorCounts.bytes;
+    CHECK(exboConfigure_TableSize(xp, (int64_t)64) == 0);
+    CHECK(zAllocatorCounts.bytes - bytes == (int64_t)Z_TABLE_BYTES(64));
+    allocations = zAllocatorCounts.allocations;
+    CHECK(exboConfigure_TableSize(xp, (int64_t)64) == 0);
+    CHECK(zAllocatorCounts.allocations == allocations);
+    CHECK(exboConfigure_TableSize(xp, (int64_t)128) == 0);
+    CHECK(zAllocatorCounts.bytes - bytes == (int64_t)Z_TABLE_BYTES(128));
+    CHECK(exboConfigure_X(xp, 2.0) == 0);
+    CHECK(exboConfigure_A(xp, (int64_t)100) == 0);
+    CHECK(exboConfigure_L(xp, (int64_t)1000) == 0);
+    CHECK(exboFinishConfig(xp) == 0);
+    // A config copied from it carries a table of its own.
+    cp = exboConfigCreateFrom(xp);
+    CHECK(cp != (exboConfig)0);
+    CHECK(zAllocatorCounts.bytes - bytes == (int64_t)(2 * Z_TABLE_BYTES(128) + (Z_POOL ? 0 : Z_BLOCK_SIZE)));
+    exboConfigDestroy(cp);
+    CHECK(zAllocatorCounts.bytes - bytes == (int64_t)Z_TABLE_BYTES(128));
+    CHECK(exboClearConfig(xp) == 0);
+    CHECK(zAllocatorCounts.bytes == bytes);
+    // A destroyed block is the next one handed out.
+    exboDestroy(xp);
+    yp = exboCreate();
+#if Z_POOL
+    CHECK(yp == xp);
+#endif
+    exboDestroy(yp);
+    allocations = zAllocatorCounts.allocations;
+    for (i = 0; i < 100000; i++) {
+        exboDestroy(exboCreate());
+    }
+#if Z_POOL
+    CHECK(zAllocatorCounts.allocations == allocations);
+#endif
+    // Exited threads hand their blocks on, so slabs stay few.
+    for (i = 0; i < POOL_THREADS; i++) {
+        CHECK(pthread_create(&id, (const pthread_attr_t *)0, zPoolThread, (void *)0) == 0);
+        CHECK(pthread_join(id, (void **)0) == 0);
+    }
+#if Z_POOL
+    CHECK(zAllocatorCounts.allocations - allocations
+          <= (int64_t)(2 * (POOL_INSTANCES + (int)Z_SLAB_BLOCKS - 1) / (int)Z_SLAB_BLOCKS));
+#endif
+    // Slabs are kept, so with the pool the allocator is set once for good;
+    // without it, the allocator can be set again once nothing is held,
+    // even while another thread allocates.
+    expected = Z_POOL ? ExboErr_AllocatorInUse : 0;
+    CHECK(exboSetAllocator(0, 0, (void *)0) == expected);
+    CHECK(exboSetAllocator(zCountingAllocate, zCountingFree, (void *)&zAllocatorCounts) == expected);
+    CHECK(pthread_create(&id, (const pthread_attr_t *)0, zPoolThread, (void *)0) == 0);
+    for (i = 0; i < 1000; i++) {
+        int result = exboSetAllocator(zCountingAllocate, zCountingFree, (void *)&zAllocatorCounts);
+        CHECK(result == 0 || result == ExboErr_AllocatorInUse);
+    }
+    CHECK(pthread_join(id, (void **)0) == 0);
+#if !Z_POOL
+    CHECK(zAllocatorCounts.bytes == (int64_t)0);
+#endif
+    printf("allocator: %lld allocation(s), %lld free(s), %lld byte(s) held\n",
+           (long long)zAllocatorCounts.allocations, (long long)zAllocatorCounts.frees,
+           (long long)zAllocatorCounts.bytes);
+    return;
+}
+
+static uint64_t zRandom(void) {
+    // xorshift64*
+    zRandomState ^= zRandomState >> 12;
+    zRandomState ^= zRandomState << 25;
+    zRandomState ^= zRandomState >> 27;
+    return zRandomState * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+static double zRandomUnit(void) {
+    return (double)(zRandom() >> 11) / 9007199254740992.0;
+}
+
+/* z_J() and zIntervalReal() against the long double oracle: the real
+ * interval within SOLVER_RELATIVE_TOLERANCE, and the interval rounded up
+ * to a whole time unit exactly as the oracle rounds it.
+ */
+static void zTestSolverMatchesOracle(void) {
+    double maxRelative = 0.0;
+    int roundingFlips = 0;
+    int i;
+    for (i = 0; i < SOLVER_CASES; i++) {
+        // X in (1, 17], biased towards 1; L/A up to 2^20.
+        double X = 1.0 + pow(16.0, zRandomUnit()) - 1.0 + 1.0e-4;
+        int64_t A = (int64_t)1 + (int64_t)(zRandom() % UINT64_C(100000));
+        int64_t L = A * ((int64_t)1 + (int64_t)(zRandom() % (UINT64_C(1) << (zRandom() % 21))));
+        int64_t D;
+        int64_t I;
+        if (L == A) {
+            continue;
+        }
+        D = A + (int64_t)(zRandom() % (uint64_t)(L - A));
+        long double reference = zOracleInterval(L, A, X, D);
+        double fast;
+        CHECK(zIntervalReal((double)(L - D), A, X, &fast) == 0);
+        if (reference >= 1.0L) {
+            // Below one time unit, only the rounded interval matters.
+            double relative = (double)(fabsl((long double)fast - reference) / reference);
+            if (relative > maxRelative) {
+                maxRelative = relative;
+            }
+            CHECK(relative <= SOLVER_RELATIVE_TOLERANCE);
+        }
+        CHECK(zInterval(L, A, X, D, &I) == 0);
+        if ((long double)I != fmaxl(ceill(reference), 1.0L)) {
+            roundingFlips++;
+        }
+    }
+    printf("z_J: max relative difference %.3g, %d rounding flip(s) in %d cases\n",
+           maxRelative, roundingFlips, SOLVER_CASES);
+    CHECK(roundingFlips == 0);
+    return;
+}
+
+/* The oracle computes the interval in long double, by an independent
+ * route: m(J) and X^J - 1 come from expm1l() and log1pl() of the exact
+ * X - 1, so that they keep their precision as X nears 1, and J is found
+ * by plain bisection over the integers.  Where long double is no wider
+ * than double, it is no better than the engines it checks.
+ */
+static long double zOracle_m(int64_t J, long double lnX, long double XMinusOne) {
+    return (long double)J + expm1l(-(long double)J * lnX) / XMinusOne;
+}
+
+static int64_t zOracle_J(long double l, long double lnX, long double XMinusOne) {
+    // The least integer J with m(J) >= l
+    int64_t J_low = (int64_t)0;
+    int64_t J_high = (int64_t)ceill(l + 1.0L / XMinusOne);
+    while (J_low < J_high) {
+        int64_t J_try = J_low + (J_high - J_low) / (int64_t)2;
+        if (zOracle_m(J_try, lnX, XMinusOne) >= l) {
+            J_high = J_try;
+        } else {
+            J_low = J_try + (int64_t)1;
+        }
+    }
+    return J_high;
+}
+
+static long double zOracleInterval(int64_t L, int64_t A, double X, int64_t D) {
+    // The interval before it is rounded up to a whole time unit
+    long double result;
+    if (D > L) {
+        result = (long double)(D - (L - A));
+    } else if ((D == L) || (X == 1.0)) {
+        result = (long double)A;
+    } else {
+        long double XMinusOne = (long double)X - 1.0L;
+        long double lnX = log1pl(XMinusOne);
+        long double excess = (long double)(L - D);
+        int64_t J = zOracle_J(excess / (long double)A, lnX, XMinusOne);
+        if (J == (int64_t)1) {
+            // Exactly A - (L - D)
+            result = (long double)A - excess;
+        } else {
+            result = ((long double)J * (long double)A - excess) * XMinusOne / expm1l((long double)J * lnX);
+        }
+    }
+    return result;
+}
+
+static void zOracleAccount(struct oracleError *ep, long double value, long double reference, int rounded) {
+    // A rounded value is in error only by as much as it misses being the
+    // least whole number at or above the reference, so that a reference
+    // within rounding of a whole number may round either way.
+    long double absolute = rounded ? fmaxl(fmaxl(reference - value, value - 1.0L - reference), 0.0L)
+                                   : fabsl(value - reference);
+    long double scale = rounded ? ceill(reference) : reference;
+    long double relative = (scale > 0.0L) ? absolute / scale : absolute;
+    if (absolute > ep->maxAbsolute) {
+        ep->maxAbsolute = absolute;
+    }
+    if (relative > ep->maxRelative) {
+        ep->maxRelative = relative;
+    }
+    ep->cases++;
+    return;
+}
+
+static void zOracleReport(const struct oracleError *ep) {
+    printf("oracle: %s: max absolute error %.3Lg, max relative error %.3Lg in %d cases\n",
+           ep->engine, ep->maxAbsolute, ep->maxRelative, ep->cases);
+    return;
+}
+
+static void zTestEnginesMatchOracle(void) {
+    // Each engine's interval against the oracle's, rounded up, and the
+    // double engine's real interval against the oracle's before rounding.
+    struct oracleError real = {"double engine before rounding", 0.0L, 0.0L, 0};
+    struct oracleError engines[3] = {
+        {"double engine", 0.0L, 0.0L, 0},
+        {"integer engine", 0.0L, 0.0L, 0},
+        {"table", 0.0L, 0.0L, 0}
+    };
+    int tableMismatches = 0;
+    int c;
+    int d;
+    for (c = 0; c < ORACLE_CONFIGS; c++) {
+        // X is 1, within 2^-40 to 2^-10 of 1, or in (1, 17]; L/A up to
+        // 2^20; A up to 2^40.
+        uint64_t kind = zRandom() % UINT64_C(20);
+        double X = (kind == UINT64_C(0)) ? 1.0
+                   : (kind < UINT64_C(4)) ? 1.0 + ldexp(1.0 + zRandomUnit(), -10 - (int)(zRandom() % UINT64_C(31)))
+                   : pow(16.0, zRandomUnit()) + 1.0e-4;
+        int64_t A = (int64_t)1 + (int64_t)(zRandom() % (UINT64_C(1) << (zRandom() % 41)));
+        int64_t L = A * ((int64_t)1 + (int64_t)(zRandom() % (UINT64_C(1) << (zRandom() % 21))));
+        struct config *table = (struct config *)0;
+        if (c < ORACLE_TABLES) {
+            table = zConfigCreate(X, A, L, ORACLE_TABLE_SIZE);
+            CHECK(table != (struct config *)0);
+        }
+        for (d = 0; d < ORACLE_DEBTS; d++) {
+            // Mostly under-saturated, sometimes saturated or beyond
+            int64_t D = A + (int64_t)(zRandom() % (uint64_t)(L - A + (int64_t)2));
+            long double reference = zOracleInterval(L, A, X, D);
+            int64_t I;
+            double v;
+            CHECK(zInterval(L, A, X, D, &I) <= 0);
+            zOracleAccount(&engines[0], (long double)I, reference, 1);
+            CHECK(zIntervalInteger(L, A, &X, D, &I) <= 0);
+            zOracleAccount(&engines[1], (long double)I, reference, 1);
+            if ((D < L) && (X > 1.0) && (reference >= 1.0L)) {
+                // Below one time unit, only the rounded interval matters.
+                CHECK(zIntervalReal((double)(L - D), A, X, &v) == 0);
+                zOracleAccount(&real, (long double)v, reference, 0);
+            }
+            if (table != (struct config *)0) {
+                // The table gives the double engine's interval exactly.
+                int64_t I_table;
+                CHECK(zInterval(L, A, X, D, &I) <= 0);
+                CHECK(zStateInterval(table, D, &I_table) <= 0);
+                zOracleAccount(&engines[2], (long double)I_table, reference, 1);
+                if (I_table != I) {
+                    tableMismatches++;
+                }
+            }
+        }
+        exboConfigDestroy((exboConfig)table);
+    }
+    zOracleReport(&real);
+    zOracleReport(&engines[0]);
+    zOracleReport(&engines[1]);
+    zOracleReport(&engines[2]);
+    CHECK(real.maxRelative <= ORACLE_DOUBLE_TOLERANCE);
+    CHECK(engines[0].maxRelative <= ORACLE_DOUBLE_TOLERANCE);
+    CHECK(engines[1].maxRelative <= ORACLE_INTEGER_TOLERANCE);
+    CHECK(engines[2].maxRelative <= ORACLE_DOUBLE_TOLERANCE);
+    CHECK(tableMismatches == 0);
+    return;
+}
+
+static void zTestInstanceAndStateAgree(void) {
+    exboConfig cp = exboConfigCreate(1.5, (int64_t)1000, (int64_t)6000);
+    exbo xp = exboCreateConfigured(1.5, (int64_t)1000, (int64_t)6000);
+    exboState state;
+    int64_t time = (int64_t)0;
+    int i;
+    CHECK(cp != (exboConfig)0);
+    CHECK(xp != (exbo)0);
+    CHECK(exboStateInit(&state) == 0);
+    for (i = 0; i < 10000; i++) {
+        time += (int64_t)(zRandom() % UINT64_C(1700));
+        CHECK(exboRecordAttempt(xp, time) == exboStateRecordAttempt(cp, &state, time));
+        CHECK(exboGetNextAttemptTime(xp) == exboStateGetNextAttemptTime(&state));
+        CHECK(exboGetPayBackTime(xp) == exboStateGetPayBackTime(&state));
+    }
+    exboDestroy(xp);
+    exboConfigDestroy(cp);
+    return;
+}
+
+/* An instance in caller storage lives in the storage, takes memory only
+ * for an interval table, which exboFini() returns, behaves as a created
+ * one does, and can be initialized again once finished.
+ */
+static void zTestStorage(void) {
+    exboStorage storage;
+    exboStorage other;
+    exbo xp;
+    exbo yp;
+    exbo created;
+    int64_t allocations = zAllocatorCounts.allocations;
+    int64_t bytes = zAllocatorCounts.bytes;
+    int64_t time = (int64_t)0;
+    int i;
+    // Without storage there is no instance, and finishing none is harmless.
+    CHECK(exboInit((exboStorage *)0) == (exbo)0);
+    CHECK(exboInitConfigured((exboStorage *)0, 1.5, (int64_t)1000, (int64_t)6000) == (exbo)0);
+    exboFini((exbo)0);
+    // A config that does not validate leaves nothing behind.
+    CHECK(exboInitConfigured(&storage, 0.5, (int64_t)1000, (int64_t)6000) == (exbo)0);
+    CHECK(exboInitConfigured(&storage, 1.5, (int64_t)0, (int64_t)6000) == (exbo)0);
+    CHECK(exboInitConfigured(&storage, 1.5, (int64_t)1000, (int64_t)0) == (exbo)0);
+    CHECK(exboInitConfigured(&storage, 1.5, (int64_t)1000, (int64_t)999) == (exbo)0);
+    CHECK(zAllocatorCounts.bytes == bytes);
+    // An unconfigured instance is configured as a created one is.
+    xp = exboInit(&storage);
+    CHECK(xp == (exbo)(void *)&storage);
+    CHECK(zAllocatorCounts.allocations == allocations);
+    CHECK(exboConfigure_X(xp, 1.5) == 0);
+    CHECK(exboConfigure_A(xp, (int64_t)1000) == 0);
+    CHECK(exboConfigure_L(xp, (int64_t)6000) == 0);
+    CHECK(exboConfigure_TableSize(xp, (int64_t)64) == 0);
+    CHECK(exboFinishConfig(xp) == 0);
+    CHECK(zAllocatorCounts.bytes - bytes == (int64_t)Z_TABLE_BYTES(64));
+    yp = exboInitConfigured(&other, 1.5, (int64_t)1000, (int64_t)6000);
+    CHECK(yp == (exbo)(void *)&other);
+    created = exboCreateConfigured(1.5, (int64_t)1000, (int64_t)6000);
+    CHECK(created != (exbo)0);
+    for (i = 0; i < 1000; i++) {
+        int expected;
+        time += (int64_t)(zRandom() % UINT64_C(1700));
+        expected = exboRecordAttempt(created, time);
+        CHECK(exboRecordAttempt(yp, time) == expected);
+        CHECK(exboGetNextAttemptTime(yp) == exboGetNextAttemptTime(created));
+        CHECK(exboGetPayBackTime(yp) == exboGetPayBackTime(created));
+        CHECK(exboRecordAttempt(xp, time) <= 0);
+    }
+    exboDestroy(created);
+    // Finishing returns the table; the storage then starts afresh.
+    exboFini(xp);
+    exboFini(yp);
+    CHECK(zAllocatorCounts.bytes == bytes);
+    xp = exboInitConfigured(&storage, 2.0, (int64_t)100, (int64_t)1000);
+    CHECK(xp == (exbo)(void *)&storage);
+    CHECK(exboGetPreviousAttemptTime(xp) == exboGetPreviousAttemptTime(exboInit(&other)));
+    CHECK(exboRecordAttempt(xp, (int64_t)0) == 0);
+    exboFini(xp);
+    exboFini((exbo)(void *)&other);
+    CHECK(zAllocatorCounts.bytes == bytes);
+    return;
+}
+
+static void zTestIntegerEngineMatchesDouble(void) {
+    int64_t maxDifference = (int64_t)0;
+    int i;
+    for (i = 0; i < INTEGER_CASES; i++) {
+        // X in (1, 17], biased towards 1; L/A up to 2^20; A up to 2^40.
+        double X = pow(16.0, zRandomUnit()) + 1.0e-4;
+        int64_t A = (int64_t)1 + (int64_t)(zRandom() % (UINT64_C(1) << (zRandom() % 41)));
+        int64_t L = A * ((int64_t)1 + (int64_t)(zRandom() % (UINT64_C(1) << (zRandom() % 21))));
+        int64_t D = A + (int64_t)(zRandom() % (uint64_t)(L - A + (int64_t)2));
+        int64_t I_double;
+        int64_t I_integer;
+        int r = zInterval(L, A, X, D, &I_double);
+        CHECK(zIntervalInteger(L, A, &X, D, &I_integer) == r);
+        int64_t difference = (I_double > I_integer) ? (I_double - I_integer) : (I_integer - I_double);
+        if (difference > maxDifference) {
+            maxDifference = difference;
+        }
+        CHECK((double)difference <= 1.0 + INTEGER_RELATIVE_TOLERANCE * (double)I_double);
+        if ((D < L) && (L - D <= A - (int64_t)ceil((double)A / X))) {
+            // J == 1, where the interval is exactly A - (L - D).
+            CHECK(I_integer == A - (L - D));
+        }
+    }
+    printf("integer engine: max difference %lld in %d cases\n",
+           (long long)maxDifference, INTEGER_CASES);
+    return;
+}
+
+static void zTestIntegerEngineInstance(void) {
+    exbo xd = exboCreateConfigured(2.0, (int64_t)1000, (int64_t)50000);
+    exbo xi = exboCreateConfigured(2.0, (int64_t)1000, (int64_t)50000);
+    exboConfig cp;
+    exboState state;
+    int64_t time = (int64_t)0;
+    int i;
+    CHECK(xd != (exbo)0);
+    CHECK(xi != (exbo)0);
+    CHECK(exboGetConfig_Engine(xi) == ExboEngine_Double);
+    CHECK(exboConfigure_Engine(xi, 2) == ExboErr_InvalidConfig_E1);
+    CHECK(exboConfigure_Engine(xi, ExboEngine_Integer) == 0);
+    CHECK(exboGetConfig_Engine(xi) == ExboEngine_Integer);
+    CHECK(exboGetConfig_Engine((exbo)0) == -ExboErr_NoInstance);
+    cp = exboConfigCreateFrom(xi);
+    CHECK(cp != (exboConfig)0);
+    CHECK(exboStateInit(&state) == 0);
+    for (i = 0; i < 10000; i++) {
+        time += (int64_t)(zRandom() % UINT64_C(3000));
+        CHECK(exboRecordAttempt(xd, time) == exboRecordAttempt(xi, time));
+        CHECK(exboStateRecordAttempt(cp, &state, time) <= 0);
+        int64_t next_d = exboGetNextAttemptTime(xd);
+        int64_t next_i = exboGetNextAttemptTime(xi);
+        CHECK((next_d - next_i <= (int64_t)1) && (next_i - next_d <= (int64_t)1));
+        CHECK(next_i == exboStateGetNextAttemptTime(&state));
+    }
+    exboConfigDestroy(cp);
+    exboDestroy(xi);
+    exboDestroy(xd);
+    return;
+}
+
+static void zBatchFill(int64_t L, int64_t *T, int64_t *D, int64_t *I, int64_t *time) {
+    // Mix fresh, prior, overflowing and ordinary elements.
+    int k;
+    for (k = 0; k < BATCH_SIZE; k++) {
+        switch (zRandom() % UINT64_C(8)) {
+        case 0:
+            T[k] = INT64_MIN;
+            D[k] = (int64_t)0;
+            I[k] = (int64_t)0;
+            time[k] = (int64_t)(zRandom() >> 1);
+            break;
+        case 1:
+            T[k] = (int64_t)(zRandom() % UINT64_C(1000000));
+            D[k] = (int64_t)(zRandom() % (uint64_t)L);
+            I[k] = (int64_t)(zRandom() % (uint64_t)L);
+            time[k] = T[k] - (int64_t)1;
+            break;
+        case 2:
+            T[k] = (int64_t)0;
+            D[k] = INT64_MAX - (int64_t)(zRandom() % UINT64_C(1000));
+            I[k] = (int64_t)1;
+            time[k] = (int64_t)(zRandom() % UINT64_C(100));
+            break;
+        default:
+            T[k] = (int64_t)(zRandom() % UINT64_C(1000000));
+            D[k] = (int64_t)(zRandom() % (uint64_t)(L + L / (int64_t)4));
+            I[k] = (int64_t)(zRandom() % (uint64_t)L);
+            time[k] = T[k] + (int64_t)(zRandom() % (uint64_t)L);
+            break;
+        }
+    }
+    return;
+}
+
+static void zTestBatchKernel(exboConfig cp, const char *name,
+                             void (*kernel)(const struct config *, size_t, int64_t *, int64_t *, int64_t *,
+                                            const int64_t *, int *)) {
+    const struct config *config = (const struct config *)cp;
+    int64_t T[BATCH_SIZE];
+    int64_t D[BATCH_SIZE];
+    int64_t I[BATCH_SIZE];
+    int64_t time[BATCH_SIZE];
+    int results[BATCH_SIZE];
+    int64_t T_ref[BATCH_SIZE];
+    int64_t D_ref[BATCH_SIZE];
+    int64_t I_ref[BATCH_SIZE];
+    int results_ref[BATCH_SIZE];
+    int mismatches = 0;
+    int round;
+    int k;
+    for (round = 0; round < 20; round++) {
+        zBatchFill(config->L, T, D, I, time);
+        memcpy(T_ref, T, sizeof(T));
+        memcpy(D_ref, D, sizeof(D));
+        memcpy(I_ref, I, sizeof(I));
+        for (k = 0; k < BATCH_SIZE; k++) {
+            results_ref[k] = zBatchElement(config, &T_ref[k], &D_ref[k], &I_ref[k], time[k]);
+        }
+        kernel(config, (size_t)BATCH_SIZE, T, D, I, time, results);
+        for (k = 0; k < BATCH_SIZE; k++) {
+            if ((T[k] != T_ref[k]) || (D[k] != D_ref[k]) || (I[k] != I_ref[k])
+                    || (results[k] != results_ref[k])) {
+                mismatches++;
+            }
+        }
+    }
+    if (mismatches != 0) {
+        fprintf(stderr, "%s: %d element(s) differ from the scalar path\n", name, mismatches);
+    }
+    CHECK(mismatches == 0);
+    return;
+}
+
+static void zTestBatchMatchesScalar(void) {
+    exbo xp = exboCreateConfigured(1.5, (int64_t)1000, (int64_t)20000);
+    exboConfig configs[4];
+    int64_t T = INT64_MIN;
+    int64_t D = (int64_t)0;
+    int64_t I = (int64_t)0;
+    int64_t time = (int64_t)0;
+    int result = 1;
+    int c;
+    configs[0] = exboConfigCreate(1.5, (int64_t)1000, (int64_t)20000);
+    configs[1] = exboConfigCreateTabulated(1.5, (int64_t)1000, (int64_t)20000, (int64_t)4096);
+    CHECK(exboConfigure_Engine(xp, ExboEngine_Integer) == 0);
+    configs[2] = exboConfigCreateFrom(xp);
+    // A table too short for the larger excesses leaves them to the solver.
+    configs[3] = exboConfigCreateTabulated(1.5, (int64_t)1000, (int64_t)20000, (int64_t)8);
+    for (c = 0; c < 4; c++) {
+        CHECK(configs[c] != (exboConfig)0);
+        zTestBatchKernel(configs[c], "scalar", zBatchScalar);
+#if Z_BATCH_X86
+        if (__builtin_cpu_supports("avx2")) {
+            zTestBatchKernel(configs[c], "avx2", zBatchAvx2);
+        }
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+            zTestBatchKernel(configs[c], "avx512", zBatchAvx512);
+        }
+#endif
+    }
+    CHECK(exboRecordAttemptBatch(configs[0], (size_t)1, &T, &D, &I, &time, &result) == 0);
+    CHECK((result == 0) && (T == time) && (D == (int64_t)1000));
+    CHECK(exboRecordAttemptBatch((exboConfig)0, (size_t)1, &T, &D, &I, &time, &result) == ExboErr_NoConfig);
+    CHECK(exboRecordAttemptBatch(configs[0], (size_t)1, &T, &D, (int64_t *)0, &time, &result)
+          == ExboErr_NoInstance);
+    for (c = 0; c < 4; c++) {
+        exboConfigDestroy(configs[c]);
+    }
+    exboDestroy(xp);
+    return;
+}
+
+static void *zStressThread(void *arg) {
+    struct stressThread *thread = (struct stressThread *)arg;
+    int i;
+    for (i = 0; i < STRESS_RECORDS; i++) {
+        // Step a shared clock, and sometimes report a slightly stale time.
+        uint64_t seed = thread->seed;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        thread->seed = seed;
+        int64_t time = __atomic_fetch_add(&zStressClock, (int64_t)2, __ATOMIC_RELAXED) - (int64_t)(seed % UINT64_C(8));
+        thread->records[i].time = time;
+        thread->records[i].result = exboAtomicStateRecordAttempt(thread->config, thread->state, time);
+    }
+    return arg;
+}
+
+static int zCompareStressRecords(const void *a, const void *b) {
+    int64_t ta = ((const struct stressRecord *)a)->time;
+    int64_t tb = ((const struct stressRecord *)b)->time;
+    return (ta > tb) - (ta < tb);
+}
+
+/* Racing writers must leave the state that replaying their successful
+ * records in time order gives, with the same warnings.
+ */
+static void zTestAtomicStress(void) {
+    exboConfig cp = exboConfigCreate(1.5, (int64_t)10, (int64_t)200);
+    exboAtomicState shared;
+    static struct stressThread threads[STRESS_THREADS];
+    static struct stressRecord committed[STRESS_THREADS * STRESS_RECORDS];
+    pthread_t ids[STRESS_THREADS];
+    int warnings[ExboWarn_COUNT];
+    size_t count = (size_t)0;
+    int failed = 0;
+    int t;
+    int i;
+    CHECK(cp != (exboConfig)0);
+    CHECK(exboAtomicStateInit(&shared) == 0);
+    for (t = 0; t < STRESS_THREADS; t++) {
+        threads[t].config = cp;
+        threads[t].state = &shared;
+        threads[t].seed = zRandom() | UINT64_C(1);
+        CHECK(pthread_create(&ids[t], (const pthread_attr_t *)0, zStressThread, (void *)&threads[t]) == 0);
+    }
+    for (t = 0; t < STRESS_THREADS; t++) {
+        CHECK(pthread_join(ids[t], (void **)0) == 0);
+    }
+    memset(warnings, 0, sizeof(warnings));
+    for (t = 0; t < STRESS_THREADS; t++) {
+        for (i = 0; i < STRESS_RECORDS; i++) {
+            if (threads[t].records[i].result <= 0) {
+                // No error, and perhaps a warning
+                committed[count++] = threads[t].records[i];
+                warnings[-threads[t].records[i].result]++;
+            } else {
+                CHECK(threads[t].records[i].result == ExboErr_RecordingAPriorAttempt);
+                CHECK(threads[t].records[i].time < exboAtomicStateGetPreviousAttemptTime(&shared));
+                failed++;
+            }
+        }
+    }
+    // The racing writers were warned, else the replay proves little.
+    CHECK(warnings[0] < (int)count);
+    qsort((void *)committed, count, sizeof(committed[0]), zCompareStressRecords);
+    struct state replay;
+    zStateInit(&replay);
+    for (i = 0; (size_t)i < count; i++) {
+        int warning;
+        CHECK(zStateRecordAttemptWarning(&replay, (const struct config *)cp, committed[i].time, &warning) == 0);
+        warnings[-warning]--;
+    }
+    for (i = 0; i < ExboWarn_COUNT; i++) {
+        CHECK(warnings[i] == 0);
+    }
+    CHECK(exboAtomicStateGetPreviousAttemptTime(&shared) == replay.T);
+    CHECK(exboAtomicStateGetPayBackTime(&shared) == zStateGetPayBackTime(&replay));
+    CHECK(exboAtomicStateGetNextAttemptTime(cp, &shared) == zStateGetNextAttemptTime(&replay));
+    printf("atomic: %d thread(s), %d record(s) committed, %d prior\n",
+           STRESS_THREADS, (int)count, failed);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestTryAttempt(void) {
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboState state;
+    exboAtomicState atomic;
+    int64_t now = (int64_t)0;
+    int64_t wait;
+    int64_t next;
+    int recorded = 0;
+    int i;
+    CHECK(exboStateInit(&state) == 0);
+    CHECK(exboAtomicStateInit(&atomic) == 0);
+    CHECK(exboTryAttempt(xp, now, &wait) == 0);
+    CHECK(wait == (int64_t)0);
+    next = exboGetNextAttemptTime(xp);
+    CHECK(exboTryAttempt(xp, next - (int64_t)1, &wait) == ExboErr_AttemptNotReady);
+    CHECK(wait == (int64_t)1);
+    CHECK(exboGetPreviousAttemptTime(xp) == now);
+    CHECK(exboTryAttempt(xp, next, (int64_t *)0) == 0);
+    CHECK(exboGetPreviousAttemptTime(xp) == next);
+    CHECK(exboTryAttempt((exbo)0, now, &wait) == ExboErr_NoInstance);
+    exboDestroy(xp);
+    // The three kinds of state agree, attempt by attempt.
+    xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    for (i = 0; i < 20000; i++) {
+        int64_t waits[3];
+        int results[3];
+        now += (int64_t)(zRandom() % UINT64_C(150));
+        results[0] = exboTryAttempt(xp, now, &waits[0]);
+        results[1] = exboStateTryAttempt(cp, &state, now, &waits[1]);
+        results[2] = exboAtomicStateTryAttempt(cp, &atomic, now, &waits[2]);
+        CHECK((results[0] == results[1]) && (results[1] == results[2]));
+        CHECK((waits[0] == waits[1]) && (waits[1] == waits[2]));
+        CHECK((results[0] <= 0) == (waits[0] == (int64_t)0));
+        CHECK(exboGetNextAttemptTime(xp) == exboStateGetNextAttemptTime(&state));
+        CHECK(exboGetNextAttemptTime(xp) == exboAtomicStateGetNextAttemptTime(cp, &atomic));
+        CHECK(exboGetPayBackTime(xp) == exboAtomicStateGetPayBackTime(&atomic));
+        if (results[0] <= 0) {
+            CHECK(exboGetPreviousAttemptTime(xp) == now);
+            recorded++;
+        } else {
+            CHECK(results[0] == ExboErr_AttemptNotReady);
+            CHECK(exboGetNextAttemptTime(xp) == now + waits[0]);
+        }
+    }
+    CHECK((recorded > 0) && (recorded < 20000));
+    exboConfigDestroy(cp);
+    exboDestroy(xp);
+    return;
+}
+
+static void zSnapshotForge(exbo xp, unsigned char *buffer, int at, uint64_t value, int width) {
+    // Snapshot xp, then set one field and checksum the snapshot again.
+    CHECK(exboSerialize(xp, buffer, (size_t)Exbo_SnapshotSize) == 0);
+    if (width == 4) {
+        zPut32(&buffer[at], (uint32_t)value);
+    } else {
+        zPut64(&buffer[at], value);
+    }
+    zPut32(&buffer[Z_SNAPSHOT_CHECKSUM], zChecksum(buffer, (size_t)Z_SNAPSHOT_CHECKSUM));
+    return;
+}
+
+static void zTestSnapshot(void) {
+    // A restored instance carries on exactly as the original would.
+    exbo originals[4];
+    exbo copies[4];
+    unsigned char buffer[4 * Exbo_SnapshotSize];
+    int results[4];
+    int64_t now = (int64_t)0;
+    int i;
+    int k;
+    originals[0] = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    originals[1] = exboCreateConfigured(1.5, (int64_t)1000, (int64_t)20000);
+    originals[2] = exboCreateConfigured(1.5, (int64_t)1000, (int64_t)20000);
+    originals[3] = exboCreate();
+    CHECK(exboConfigure_Engine(originals[1], ExboEngine_Integer) == 0);
+    CHECK(exboConfigure_TableSize(originals[2], (int64_t)64) == 0);
+    CHECK(exboConfigure_A(originals[3], (int64_t)10) == 0);
+    for (k = 0; k < 3; k++) {
+        CHECK(exboFinishConfig(originals[k]) == 0);
+        CHECK(exboRecordAttempt(originals[k], (int64_t)0) == 0);
+        CHECK(exboRecordAttempt(originals[k], (int64_t)50) == 0);
+    }
+    for (k = 0; k < 4; k++) {
+        copies[k] = exboCreateConfigured(3.0, (int64_t)7, (int64_t)7);
+    }
+    CHECK(exboSerializeBatch((const exbo *)originals, (size_t)4, buffer, sizeof(buffer), results) == 0);
+    for (k = 0; k < 4; k++) {
+        CHECK(results[k] == 0);
+    }
+    // The fields are little-endian at fixed offsets.
+    CHECK((buffer[0] == 'e') && (buffer[1] == 'x') && (buffer[2] == 'b') && (buffer[3] == 0));
+    CHECK((buffer[4] == 3) && (buffer[5] == 0));
+    CHECK((buffer[24] == 100) && (buffer[25] == 0) && (buffer[32] == 0xe8) && (buffer[33] == 0x03));
+    CHECK((buffer[40] == 50) && (buffer[47] == 0));
+    CHECK(exboDeserializeBatch((const exbo *)copies, (size_t)4, buffer, sizeof(buffer), results) == 0);
+    for (k = 0; k < 4; k++) {
+        CHECK(results[k] == 0);
+        CHECK(exboIsConfigFinished(copies[k]) == exboIsConfigFinished(originals[k]));
+        CHECK(exboDoesConfigHave_L(copies[k]) == exboDoesConfigHave_L(originals[k]));
+        CHECK(exboGetConfig_Engine(copies[k]) == exboGetConfig_Engine(originals[k]));
+        CHECK(exboGetPreviousAttemptTime(copies[k]) == exboGetPreviousAttemptTime(originals[k]));
+    }
+    CHECK(exboGetTableErrorBound(copies[2]) == exboGetTableErrorBound(originals[2]));
+    for (i = 0; i < 1000; i++) {
+        now += (int64_t)(zRandom() % UINT64_C(500));
+        for (k = 0; k < 4; k++) {
+            CHECK(exboRecordAttempt(copies[k], now) == exboRecordAttempt(originals[k], now));
+            CHECK(exboGetNextAttemptTime(copies[k]) == exboGetNextAttemptTime(originals[k]));
+            CHECK(exboGetPayBackTime(copies[k]) == exboGetPayBackTime(originals[k]));
+        }
+    }
+    // A damaged snapshot leaves the instance alone.
+    CHECK(exboSerialize(originals[0], buffer, (size_t)Exbo_SnapshotSize) == 0);
+    buffer[40] ^= (unsigned char)1;
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    CHECK(exboGetConfig_A(copies[1]) == (int64_t)1000);
+    // So does one whose checksum matches but whose fields cannot be right.
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_VERSION_AT, (uint64_t)Z_SNAPSHOT_VERSION + UINT64_C(1), 4);
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_FLAGS, UINT64_C(0xdf), 4);   // jitter mode 3
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_FLAGS, UINT64_C(0x21f), 4);  // an unknown flag
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_X, UINT64_C(0x7ff8000000000000), 8);   // NaN
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_X, UINT64_C(0x3fe0000000000000), 8);   // 0.5
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_A, UINT64_C(0), 8);
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_L, UINT64_C(99), 8);
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_D, (uint64_t)(int64_t)-1, 8);
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_RESERVED, UINT64_C(1), 4);
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == ExboErr_SnapshotCorrupt);
+    CHECK(exboGetConfig_A(copies[1]) == (int64_t)1000);
+    // A field changed within bounds is taken, as the checksum matches.
+    zSnapshotForge(originals[0], buffer, Z_SNAPSHOT_A, UINT64_C(200), 8);
+    CHECK(exboDeserialize(copies[1], buffer, (size_t)Exbo_SnapshotSize) == 0);
+    CHECK(exboGetConfig_A(copies[1]) == (int64_t)200);
+    CHECK(exboSerialize(originals[0], buffer, (size_t)Exbo_SnapshotSize - (size_t)1) == ExboErr_SnapshotTooSmall);
+    CHECK(exboDeserialize((exbo)0, buffer, (size_t)Exbo_SnapshotSize) == ExboErr_NoInstance);
+    CHECK(exboSerializeBatch((const exbo *)originals, (size_t)4, buffer, sizeof(buffer) - (size_t)1, results)
+          == ExboErr_SnapshotTooSmall);
+    for (k = 0; k < 4; k++) {
+        exboDestroy(originals[k]);
+        exboDestroy(copies[k]);
+    }
+    return;
+}
+
+/* The inline accessors agree with the library's, on states near every
+ * edge as well as on recorded ones.
+ */
+static void zTestInlineAccessors(void) {
+    static const int64_t edges[] = {INT64_MIN, INT64_MIN + 1, Exbo_MinimumTime - 1, Exbo_MinimumTime, -1, 0, 1,
+                                    INT64_MAX - 1, INT64_MAX};
+    const size_t count = sizeof(edges) / sizeof(edges[0]);
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    struct state *p = &((struct instance *)xp)->state;
+    exboState state;
+    int64_t now = (int64_t)0;
+    size_t t;
+    size_t d;
+    size_t i;
+    int k;
+    CHECK(exboInlineGetPreviousAttemptTime(xp) == exboGetPreviousAttemptTime(xp));
+    CHECK(exboInlineGetNextAttemptTime(xp) == exboGetNextAttemptTime(xp));
+    CHECK(exboInlineGetPayBackTime(xp) == exboGetPayBackTime(xp));
+    for (k = 0; k < 1000; k++) {
+        now += (int64_t)(zRandom() % UINT64_C(300));
+        CHECK(exboRecordAttempt(xp, now) <= 0);
+        CHECK(exboInlineGetPreviousAttemptTime(xp) == exboGetPreviousAttemptTime(xp));
+        CHECK(exboInlineGetNextAttemptTime(xp) == exboGetNextAttemptTime(xp));
+        CHECK(exboInlineGetPayBackTime(xp) == exboGetPayBackTime(xp));
+    }
+    for (t = 0; t < count; t++) {
+        for (d = 0; d < count; d++) {
+            for (i = 0; i < count; i++) {
+                state.opaque[0] = p->T = edges[t];
+                state.opaque[1] = p->D = edges[d];
+                state.opaque[2] = p->I = edges[i];
+                CHECK(exboInlineGetPreviousAttemptTime(xp) == exboGetPreviousAttemptTime(xp));
+                CHECK(exboInlineGetNextAttemptTime(xp) == exboGetNextAttemptTime(xp));
+                CHECK(exboInlineGetPayBackTime(xp) == exboGetPayBackTime(xp));
+                CHECK(exboInlineStateGetPreviousAttemptTime(&state) == exboStateGetPreviousAttemptTime(&state));
+                CHECK(exboInlineStateGetNextAttemptTime(&state) == exboStateGetNextAttemptTime(&state));
+                CHECK(exboInlineStateGetPayBackTime(&state) == exboStateGetPayBackTime(&state));
+            }
+        }
+    }
+    CHECK(exboInlineGetNextAttemptTime((exbo)0) == INT64_MIN + ExboErr_NoInstance);
+    CHECK(exboInlineStateGetPayBackTime((const exboState *)0) == INT64_MIN + ExboErr_NoInstance);
+    exboDestroy(xp);
+    return;
+}
+
+/* exboRecordAttempt() used to return 0 for a recorded attempt, whatever
+ * its warning.  It now returns the warning, so a caller that took any
+ * result other than 0 as a failure sees warnings as failures; a caller
+ * that tests for a result greater than 0 gets the verdict the old
+ * contract gave, and every attempt changes the state as it did.
+ */
+static void zTestRecordContract(void) {
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    struct state replay;
+    int64_t time = (int64_t)0;
+    int seen[3] = {0, 0, 0};   // errors, warnings, clean records
+    int i;
+    zStateInit(&replay);
+    for (i = 0; i < 5000; i++) {
+        int warning;
+        int old;
+        int r;
+        // Now and then, an attempt before the last one, which fails.
+        time += (i % 97 == 96) ? (int64_t)-1 : (int64_t)(zRandom() % UINT64_C(150));
+        old = zStateRecordAttemptWarning(&replay, &((const struct instance *)xp)->config, time, &warning);
+        r = exboRecordAttempt(xp, time);
+        CHECK(r == ((old != 0) ? old : warning));
+        CHECK((r > 0) == (old != 0));
+        CHECK(exboGetPreviousAttemptTime(xp) == zStateGetPreviousAttemptTime(&replay));
+        CHECK(exboGetPayBackTime(xp) == zStateGetPayBackTime(&replay));
+        seen[(r > 0) ? 0 : ((r < 0) ? 1 : 2)]++;
+        if (old != 0) {
+            time = exboGetPreviousAttemptTime(xp);
+        }
+    }
+    // Every kind of result came up.
+    CHECK((seen[0] > 0) && (seen[1] > 0) && (seen[2] > 0));
+    exboDestroy(xp);
+    return;
+}
+
+static void *zStatsThread(void *arg) {
+    struct statsThread *thread = (struct statsThread *)arg;
+    exboState state;
+    int64_t now = (int64_t)0;
+    int i;
+    thread->failures += (exboStateInit(&state) != 0);
+    for (i = 0; i < STATS_RECORDS; i++) {
+        uint64_t seed = thread->seed;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        thread->seed = seed;
+        now += (int64_t)(seed % UINT64_C(200));
+        thread->failures += (exboStateRecordAttempt(thread->config, &state, now) > 0);
+    }
+    return arg;
+}
+
+/* Recording against levels matches recording against each alone, the
+ * latest next attempt time governs, and a level that cannot record the
+ * attempt leaves every level as it was.
+ */
+static void zTestLevels(void) {
+    exbo levels[LEVELS];
+    exbo alone[LEVELS];
+    exbo many[Exbo_MaximumLevels + 1];
+    unsigned char before[LEVELS][Exbo_SnapshotSize];
+    unsigned char after[Exbo_SnapshotSize];
+    double X[LEVELS] = {2.0, 1.5, 1.1};
+    int64_t A[LEVELS] = {(int64_t)20, (int64_t)40, (int64_t)100};
+    int64_t L[LEVELS] = {(int64_t)100, (int64_t)600, (int64_t)4000};
+    int bindings[LEVELS] = {0, 0, 0};
+    int64_t time = (int64_t)0;
+    int64_t next;
+    size_t binding;
+    int i;
+    int k;
+    for (k = 0; k < LEVELS; k++) {
+        levels[k] = exboCreateConfigured(X[k], A[k], L[k]);
+        alone[k] = exboCreateConfigured(X[k], A[k], L[k]);
+    }
+    for (i = 0; i < LEVEL_ATTEMPTS; i++) {
+        int64_t latest = INT64_MIN;
+        int first = 0;
+        // Bursts of attempts alternate with quiet spells.
+        time += (int64_t)(zRandom() % (((i / 100) % 2 == 0) ? UINT64_C(20) : UINT64_C(400)));
+        CHECK(exboRecordAttemptLevels((const exbo *)levels, (size_t)LEVELS, time, &next, &binding) <= 0);
+        for (k = 0; k < LEVELS; k++) {
+            int64_t t;
+            CHECK(exboRecordAttempt(alone[k], time) <= 0);
+            t = exboGetNextAttemptTime(alone[k]);
+            CHECK(exboGetNextAttemptTime(levels[k]) == t);
+            CHECK(exboGetPayBackTime(levels[k]) == exboGetPayBackTime(alone[k]));
+            if (t > latest) {
+                latest = t;
+                first = k;
+            }
+        }
+        CHECK(next == latest);
+        CHECK(binding == (size_t)first);
+        bindings[binding]++;
+    }
+    CHECK((bindings[0] > 0) && (bindings[1] > 0) && (bindings[2] > 0));
+    // A prior attempt on one level changes no level.
+    CHECK(exboRecordAttempt(levels[1], time + (int64_t)1000) == 0);
+    for (k = 0; k < LEVELS; k++) {
+        CHECK(exboSerialize(levels[k], before[k], sizeof(before[k])) == 0);
+    }
+    next = (int64_t)-1;
+    binding = (size_t)99;
+    CHECK(exboRecordAttemptLevels((const exbo *)levels, (size_t)LEVELS, time + (int64_t)500, &next, &binding)
+          == ExboErr_RecordingAPriorAttempt);
+    CHECK((next == (int64_t)-1) && (binding == (size_t)99));
+    for (k = 0; k < LEVELS; k++) {
+        CHECK(exboSerialize(levels[k], after, sizeof(after)) == 0);
+        CHECK(memcmp((const void *)before[k], (const void *)after, sizeof(after)) == 0);
+    }
+    CHECK(exboRecordAttemptLevels((const exbo *)levels, (size_t)LEVELS, time + (int64_t)1000, (int64_t *)0,
+                                  (size_t *)0) <= 0);
+    // Missing and too many levels
+    CHECK(exboRecordAttemptLevels((const exbo *)0, (size_t)1, time, &next, &binding) == ExboErr_NoInstance);
+    CHECK(exboRecordAttemptLevels((const exbo *)levels, (size_t)0, time, &next, &binding) == ExboErr_NoInstance);
+    for (k = 0; k <= Exbo_MaximumLevels; k++) {
+        many[k] = levels[0];
+    }
+    CHECK(exboRecordAttemptLevels((const exbo *)many, (size_t)(Exbo_MaximumLevels + 1), time, &next, &binding)
+          == ExboErr_TooManyLevels);
+    many[0] = (exbo)0;
+    CHECK(exboRecordAttemptLevels((const exbo *)many, (size_t)2, time + (int64_t)2000, &next, &binding)
+          == ExboErr_NoInstance);
+    for (k = 0; k < LEVELS; k++) {
+        exboDestroy(levels[k]);
+        exboDestroy(alone[k]);
+    }
+    printf("levels: %d attempt(s), binding %d/%d/%d\n", LEVEL_ATTEMPTS, bindings[0], bindings[1], bindings[2]);
+    return;
+}
+
+/* A cost of k * A leaves the debt and interval of k attempts at once,
+ * a cost below A gives the interval of A, and a cost that overflows the
+ * debt sticks at INT64_MAX with a warning.
+ */
+static void zTestWeighted(void) {
+    exboConfig configs[3];
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    struct state state;
+    int64_t I;
+    int warning;
+    int c;
+    int i;
+    configs[0] = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    configs[1] = exboConfigCreateTabulated(1.01, (int64_t)10, (int64_t)100000, (int64_t)1024);
+    configs[2] = exboConfigCreate(1.5, (int64_t)7, (int64_t)70000);
+    for (c = 0; c < 3; c++) {
+        const struct config *config = (const struct config *)configs[c];
+        exboState weighted;
+        exboState looped;
+        int64_t time = (int64_t)0;
+        CHECK(exboStateInit(&weighted) == 0);
+        CHECK(exboStateInit(&looped) == 0);
+        for (i = 0; i < WEIGHTED_CASES; i++) {
+            int64_t units = (int64_t)(zRandom() % (uint64_t)WEIGHTED_MAXIMUM_UNITS) + (int64_t)1;
+            int64_t k;
+            time += (int64_t)(zRandom() % (uint64_t)(units * config->A * (int64_t)2));
+            CHECK(exboStateRecordAttemptWeighted(configs[c], &weighted, time, units * config->A) <= 0);
+            for (k = 0; k < units; k++) {
+                CHECK(exboStateRecordAttempt(configs[c], &looped, time) <= 0);
+            }
+            CHECK(memcmp((const void *)&weighted, (const void *)&looped, sizeof(looped)) == 0);
+        }
+    }
+    // A cost that is not a multiple of A
+    zStateInit(&state);
+    CHECK(zStateRecordCost(&state, (const struct config *)configs[0], (int64_t)0, (int64_t)250, &warning) == 0);
+    CHECK(zStateInterval((const struct config *)configs[0], (int64_t)250, &I) <= 0);
+    CHECK((state.D == (int64_t)250) && (state.I == I));
+    // A cost below A
+    zStateInit(&state);
+    CHECK(zStateRecordCost(&state, (const struct config *)configs[0], (int64_t)0, (int64_t)1, &warning) == 0);
+    CHECK(zStateInterval((const struct config *)configs[0], (int64_t)100, &I) <= 0);
+    CHECK((state.D == (int64_t)1) && (state.I == I));
+    // Debt overflow
+    CHECK(zStateRecordCost(&state, (const struct config *)configs[0], (int64_t)0, INT64_MAX, &warning) == 0);
+    CHECK(warning == ExboWarn_ExcessCostLimitBreachWithDebtOverflow);
+    CHECK((state.D == INT64_MAX) && (state.I == INT64_MAX - (int64_t)900));
+    // The instance form, and bad costs
+    CHECK(exboRecordAttemptWeighted(xp, (int64_t)0, (int64_t)300) == 0);
+    CHECK(exboGetPayBackTime(xp) == (int64_t)300);
+    CHECK(exboRecordAttemptWeighted(xp, (int64_t)0, (int64_t)0) == ExboErr_InvalidCost);
+    CHECK(exboRecordAttemptWeighted(xp, (int64_t)0, (int64_t)-5) == ExboErr_InvalidCost);
+    CHECK(exboStateRecordAttemptWeighted(configs[0], (exboState *)0, (int64_t)0, (int64_t)1) == ExboErr_NoInstance);
+    CHECK(exboRecordAttemptWeighted((exbo)0, (int64_t)0, (int64_t)1) == ExboErr_NoInstance);
+    CHECK(exboRecordAttemptWeighted(xp, (int64_t)-1, (int64_t)100) == ExboErr_RecordingAPriorAttempt);
+    for (c = 0; c < 3; c++) {
+        exboConfigDestroy(configs[c]);
+    }
+    exboDestroy(xp);
+    return;
+}
+
+static int zCompareTimes(const void *a, const void *b) {
+    int64_t ta = *(const int64_t *)a;
+    int64_t tb = *(const int64_t *)b;
+    return (ta > tb) - (ta < tb);
+}
+
+static exbo zJitterCreate(int jitter, int seeded, uint64_t seed) {
+    exbo xp = exboCreate();
+    CHECK(exboConfigure_X(xp, 2.0) == 0);
+    CHECK(exboConfigure_A(xp, (int64_t)100) == 0);
+    CHECK(exboConfigure_L(xp, (int64_t)10000) == 0);
+    CHECK(exboConfigure_Jitter(xp, jitter) == 0);
+    if (seeded) {
+        CHECK(exboConfigure_JitterSeed(xp, seed) == 0);
+    }
+    CHECK(exboFinishConfig(xp) == 0);
+    return xp;
+}
+
+/* A jittered interval lies within the computed one, and within three
+ * times the previous one for decorrelated jitter; the debt is untouched.
+ * Seeded draws repeat for the same seed, stream and history wherever the
+ * state is held, and clients that share a history, or a seeded config,
+ * no longer become ready together.
+ */
+static void zTestJitter(void) {
+    static exbo clients[JITTER_CLIENTS];
+    static exboState states[JITTER_CLIENTS];
+    static int64_t nexts[JITTER_CLIENTS];
+    static int64_t replayed[JITTER_RECORDS];
+    exbo plain = zJitterCreate(ExboJitter_None, 0, UINT64_C(0));
+    exbo full = zJitterCreate(ExboJitter_Full, 1, UINT64_C(42));
+    exbo twin = zJitterCreate(ExboJitter_Full, 1, UINT64_C(42));
+    exbo decorrelated = zJitterCreate(ExboJitter_Decorrelated, 0, UINT64_C(0));
+    unsigned char snapshot[Exbo_SnapshotSize];
+    unsigned char again[Exbo_SnapshotSize];
+    exbo restored = exboCreate();
+    exboStorage storage;
+    exbo stored;
+    exboConfig cp;
+    exboState s;
+    double sum = 0.0;
+    int64_t start;
+    int64_t time = (int64_t)0;
+    int64_t previous = (int64_t)0;
+    int differs = 0;
+    int distinct;
+    int i;
+    CHECK(exboGetConfig_Jitter(full) == ExboJitter_Full);
+    CHECK(exboGetConfig_Jitter(plain) == ExboJitter_None);
+    CHECK(exboGetConfig_Jitter((exbo)0) == -ExboErr_NoInstance);
+    CHECK(exboConfigure_Jitter(plain, 3) == ExboErr_InvalidConfig_J1);
+    CHECK(exboConfigure_Jitter(plain, -1) == ExboErr_InvalidConfig_J1);
+    CHECK(exboConfigure_Jitter((exbo)0, ExboJitter_Full) == ExboErr_NoInstance);
+    CHECK(exboConfigure_JitterSeed((exbo)0, UINT64_C(1)) == ExboErr_NoInstance);
+    CHECK(exboSerialize(full, snapshot, sizeof(snapshot)) == 0);
+    for (i = 0; i < JITTER_RECORDS; i++) {
+        const struct state *ps = &((const struct instance *)plain)->state;
+        const struct state *fs = &((const struct instance *)full)->state;
+        const struct state *ds = &((const struct instance *)decorrelated)->state;
+        int64_t dPrevious = ds->I;
+        time += (int64_t)(zRandom() % UINT64_C(120));
+        CHECK(exboRecordAttempt(plain, time) <= 0);
+        CHECK(exboRecordAttempt(full, time) <= 0);
+        CHECK(exboRecordAttempt(twin, time) <= 0);
+        CHECK(exboRecordAttempt(decorrelated, time) <= 0);
+        CHECK((fs->D == ps->D) && (ds->D == ps->D));
+        CHECK((fs->I >= (int64_t)1) && (fs->I <= ps->I));
+        CHECK((ds->I >= (int64_t)1) && (ds->I <= ps->I));
+        if (dPrevious > (int64_t)0) {
+            CHECK(ds->I <= dPrevious * (int64_t)3);
+        }
+        // The same seed makes another instance, elsewhere, draw the same.
+        differs += (exboGetNextAttemptTime(twin) != exboGetNextAttemptTime(full));
+        sum += (double)fs->I / (double)ps->I;
+    }
+    // Full jitter is uniform, so its mean is about half the interval.
+    CHECK((sum / JITTER_RECORDS > 0.45) && (sum / JITTER_RECORDS < 0.55));
+    CHECK(differs == 0);
+    // Restored, into the same instance or into caller storage, the same
+    // seed repeats its draws, and another seed, even one that differs
+    // only above the low 16 bits, does not.
+    CHECK(exboDeserialize(full, snapshot, sizeof(snapshot)) == 0);
+    CHECK(exboGetConfig_Jitter(full) == ExboJitter_Full);
+    start = time;
+    time = (int64_t)0;
+    for (i = 0; i < JITTER_RECORDS; i++) {
+        time += (int64_t)(i % 120);
+        CHECK(exboRecordAttempt(full, time) <= 0);
+        replayed[i] = exboGetNextAttemptTime(full) - time;
+    }
+    CHECK(exboDeserialize(full, snapshot, sizeof(snapshot)) == 0);
+    time = (int64_t)0;
+    for (i = 0; i < JITTER_RECORDS; i++) {
+        time += (int64_t)(i % 120);
+        CHECK(exboRecordAttempt(full, time) <= 0);
+        CHECK(exboGetNextAttemptTime(full) - time == replayed[i]);
+    }
+    stored = exboInit(&storage);
+    CHECK(exboDeserialize(stored, snapshot, sizeof(snapshot)) == 0);
+    time = (int64_t)0;
+    for (i = 0; i < JITTER_RECORDS; i++) {
+        time += (int64_t)(i % 120);
+        CHECK(exboRecordAttempt(stored, time) <= 0);
+        CHECK(exboGetNextAttemptTime(stored) - time == replayed[i]);
+    }
+    exboFini(stored);
+    CHECK(exboDeserialize(full, snapshot, sizeof(snapshot)) == 0);
+    CHECK(exboConfigure_JitterSeed(full, UINT64_C(42) | (UINT64_C(1) << 40)) == 0);
+    CHECK(exboFinishConfig(full) == 0);
+    time = (int64_t)0;
+    differs = 0;
+    for (i = 0; i < JITTER_RECORDS; i++) {
+        time += (int64_t)(i % 120);
+        CHECK(exboRecordAttempt(full, time) <= 0);
+        differs += (exboGetNextAttemptTime(full) - time != replayed[i]);
+    }
+    CHECK(differs > JITTER_RECORDS / 2);
+    time = start;
+    // The mode and seed travel in a snapshot.
+    CHECK(exboSerialize(full, snapshot, sizeof(snapshot)) == 0);
+    CHECK(exboDeserialize(restored, snapshot, sizeof(snapshot)) == 0);
+    CHECK(exboSerialize(restored, again, sizeof(again)) == 0);
+    CHECK(memcmp((const void *)snapshot, (const void *)again, sizeof(again)) == 0);
+    CHECK(exboGetConfig_Jitter(restored) == ExboJitter_Full);
+    // A shared config jitters states, each by its address.
+    cp = exboConfigCreateFrom(decorrelated);
+    CHECK(exboStateInit(&s) == 0);
+    for (i = 0; i < 100; i++) {
+        time += (int64_t)(zRandom() % UINT64_C(120));
+        previous = ((const struct state *)(const void *)&s)->I;
+        CHECK(exboStateRecordAttempt(cp, &s, time) <= 0);
+        CHECK((((const struct state *)(const void *)&s)->I >= (int64_t)1) &&
+              ((previous == (int64_t)0) || (((const struct state *)(const void *)&s)->I <= previous * (int64_t)3)));
+        CHECK(exboStateGetNextAttemptTime(&s) == time + ((const struct state *)(const void *)&s)->I);
+    }
+    exboConfigDestroy(cp);
+    // Under a seeded shared config, a stream draws the same for states
+    // held apart, and other streams draw apart.
+    cp = exboConfigCreateFrom(full);
+    CHECK(exboStateInit(&states[0]) == 0);
+    CHECK(exboStateInit(&states[1]) == 0);
+    CHECK(exboStateInit(&s) == 0);
+    CHECK(exboStateRecordAttemptStream((exboConfig)0, &s, (int64_t)0, UINT64_C(7)) == ExboErr_NoConfig);
+    CHECK(exboStateRecordAttemptStream(cp, (exboState *)0, (int64_t)0, UINT64_C(7)) == ExboErr_NoInstance);
+    differs = 0;
+    for (i = 0; i < JITTER_RECORDS; i++) {
+        int64_t at = (int64_t)i * (int64_t)50;
+        CHECK(exboStateRecordAttemptStream(cp, &states[0], at, UINT64_C(7)) <= 0);
+        CHECK(exboStateRecordAttemptStream(cp, &states[1], at, UINT64_C(7)) <= 0);
+        CHECK(exboStateRecordAttemptStream(cp, &s, at, UINT64_C(8)) <= 0);
+        CHECK(exboStateGetNextAttemptTime(&states[0]) == exboStateGetNextAttemptTime(&states[1]));
+        differs += (exboStateGetNextAttemptTime(&s) != exboStateGetNextAttemptTime(&states[0]));
+    }
+    CHECK(differs > JITTER_RECORDS / 2);
+    exboConfigDestroy(cp);
+    // A retry storm: clients that failed together retry apart.
+    for (i = 0; i < JITTER_CLIENTS; i++) {
+        int k;
+        clients[i] = zJitterCreate(ExboJitter_Full, 0, UINT64_C(0));
+        for (k = 0; k < 200; k++) {
+            CHECK(exboRecordAttempt(clients[i], (int64_t)k) <= 0);
+        }
+        nexts[i] = exboGetNextAttemptTime(clients[i]);
+    }
+    qsort((void *)nexts, (size_t)JITTER_CLIENTS, sizeof(nexts[0]), zCompareTimes);
+    distinct = 1;
+    for (i = 1; i < JITTER_CLIENTS; i++) {
+        distinct += (nexts[i] != nexts[i - 1]);
+    }
+    CHECK(distinct > JITTER_CLIENTS * 8 / 10);
+    for (i = 0; i < JITTER_CLIENTS; i++) {
+        exboDestroy(clients[i]);
+    }
+    printf("jitter: full mean %.3f of I, %d of %d storm client(s) ready at distinct times\n",
+           sum / JITTER_RECORDS, distinct, JITTER_CLIENTS);
+    // The same storm over states that share one seeded config
+    cp = exboConfigCreateFrom(full);
+    CHECK(cp != (exboConfig)0);
+    for (i = 0; i < JITTER_CLIENTS; i++) {
+        int k;
+        CHECK(exboStateInit(&states[i]) == 0);
+        for (k = 0; k < 200; k++) {
+            CHECK(exboStateRecordAttempt(cp, &states[i], (int64_t)k) <= 0);
+        }
+        nexts[i] = exboStateGetNextAttemptTime(&states[i]);
+    }
+    qsort((void *)nexts, (size_t)JITTER_CLIENTS, sizeof(nexts[0]), zCompareTimes);
+    distinct = 1;
+    for (i = 1; i < JITTER_CLIENTS; i++) {
+        distinct += (nexts[i] != nexts[i - 1]);
+    }
+    CHECK(distinct > JITTER_CLIENTS * 8 / 10);
+    exboConfigDestroy(cp);
+    printf("jitter: %d of %d seeded shared-config state(s) ready at distinct times\n", distinct, JITTER_CLIENTS);
+    exboDestroy(plain);
+    exboDestroy(full);
+    exboDestroy(twin);
+    exboDestroy(decorrelated);
+    exboDestroy(restored);
+    return;
+}
+
+/* Every way of recording an attempt returns the same warning for it. */
+static void zTestWarnings(void) {
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exbo weighted = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exbo level = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exbo tried = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exboState state;
+    exboState stateWeighted;
+    exboState stateTried;
+    exboAtomicState atomic;
+    exboAtomicState atomicTried;
+    struct state replay;
+    struct state replayTried;
+    int64_t T = INT64_MIN;
+    int64_t D = (int64_t)0;
+    int64_t I = (int64_t)0;
+    int64_t time = (int64_t)0;
+    int counts[ExboWarn_COUNT];
+    int i;
+    CHECK(exboStateInit(&state) == 0);
+    CHECK(exboStateInit(&stateWeighted) == 0);
+    CHECK(exboStateInit(&stateTried) == 0);
+    CHECK(exboAtomicStateInit(&atomic) == 0);
+    CHECK(exboAtomicStateInit(&atomicTried) == 0);
+    zStateInit(&replay);
+    zStateInit(&replayTried);
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < 5000; i++) {
+        int warning;
+        int expected;
+        int result;
+        int64_t wait;
+        time += (int64_t)(zRandom() % UINT64_C(150));
+        CHECK(zStateRecordAttemptWarning(&replay, (const struct config *)cp, time, &warning) == 0);
+        counts[-warning]++;
+        CHECK(exboRecordAttempt(xp, time) == warning);
+        CHECK(exboStateRecordAttempt(cp, &state, time) == warning);
+        CHECK(exboAtomicStateRecordAttempt(cp, &atomic, time) == warning);
+        CHECK(exboRecordAttemptWeighted(weighted, time, (int64_t)100) == warning);
+        CHECK(exboStateRecordAttemptWeighted(cp, &stateWeighted, time, (int64_t)100) == warning);
+        CHECK(exboRecordAttemptLevels(&level, (size_t)1, time, (int64_t *)0, (size_t *)0) == warning);
+        CHECK(exboRecordAttemptBatch(cp, (size_t)1, &T, &D, &I, &time, &result) == 0);
+        CHECK(result == warning);
+        // A try records only once the state is ready.
+        if (time >= zStateGetNextAttemptTime(&replayTried)) {
+            CHECK(zStateRecordAttemptWarning(&replayTried, (const struct config *)cp, time, &warning) == 0);
+            expected = warning;
+        } else {
+            expected = ExboErr_AttemptNotReady;
+        }
+        CHECK(exboTryAttempt(tried, time, &wait) == expected);
+        CHECK(exboStateTryAttempt(cp, &stateTried, time, &wait) == expected);
+        CHECK(exboAtomicStateTryAttempt(cp, &atomicTried, time, &wait) == expected);
+    }
+    CHECK((counts[-ExboWarn_AttemptIsEarlierThanRecommended] > 0) && (counts[-ExboWarn_ExcessCostLimitBreach] > 0));
+    CHECK(strcmp(exboGetErrorMessage(ExboWarn_ExcessCostLimitBreach), "Excess cost limit breach") == 0);
+    CHECK(strcmp(exboGetErrorMessage(-ExboWarn_COUNT), "Negative error number is undefined") == 0);
+    exboConfigDestroy(cp);
+    exboDestroy(xp);
+    exboDestroy(weighted);
+    exboDestroy(level);
+    exboDestroy(tried);
+    return;
+}
+
+static void zStatsCheckGrowth(const exboStats *before, const exboStats *after, const exboStats *expected) {
+    int i;
+    CHECK(after->records - before->records == expected->records);
+    CHECK(after->errors - before->errors == expected->errors);
+    CHECK(after->notReady - before->notReady == expected->notReady);
+    for (i = 0; i < ExboWarn_COUNT; i++) {
+        CHECK(after->warnings[i] - before->warnings[i] == expected->warnings[i]);
+    }
+    for (i = 0; i < Exbo_StatsBuckets; i++) {
+        CHECK(after->intervals[i] - before->intervals[i] == expected->intervals[i]);
+        CHECK(after->debts[i] - before->debts[i] == expected->debts[i]);
+    }
+    return;
+}
+
+/* The counts taken around a known sequence of records grow by what
+ * replaying it predicts, and threads that have exited stay counted.
+ * Without EXBO_STATS, nothing is counted and exboGetStats() says so.
+ */
+static void zTestStats(void) {
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboStats before;
+    exboStats after;
+    exboStats expected;
+    exboState state;
+    struct state replay;
+    struct statsThread threads[STATS_THREADS];
+    pthread_t ids[STATS_THREADS];
+    int64_t now = (int64_t)0;
+    int64_t wait;
+    int64_t sum;
+    int i;
+    int t;
+    CHECK(exboGetStats((exboStats *)0) == ExboErr_NoInstance);
+    memset((void *)&before, 0xff, sizeof(before));
+    CHECK(exboGetStats(&before) == (EXBO_STATS ? 0 : ExboErr_StatsDisabled));
+    memset((void *)&expected, 0, sizeof(expected));
+    CHECK(exboStateInit(&state) == 0);
+    zStateInit(&replay);
+    for (i = 0; i < 5000; i++) {
+        // Mostly early and late attempts, and now and then a prior one
+        int64_t time = now + (int64_t)(zRandom() % UINT64_C(300)) - (int64_t)20;
+        int warning;
+        int result = zStateRecordAttemptWarning(&replay, (const struct config *)cp, time, &warning);
+        CHECK(exboStateRecordAttempt(cp, &state, time) == ((result == 0) ? warning : result));
+        if (result == 0) {
+            now = time;
+            expected.records++;
+            expected.warnings[-warning]++;
+            expected.intervals[zStatsBucket(replay.I)]++;
+            expected.debts[zStatsBucket(replay.D)]++;
+        } else {
+            CHECK(result == ExboErr_RecordingAPriorAttempt);
+            expected.errors++;
+        }
+    }
+    CHECK(exboStateTryAttempt(cp, &state, exboStateGetNextAttemptTime(&state) - (int64_t)1, &wait)
+          == ExboErr_AttemptNotReady);
+    expected.notReady++;
+    CHECK((expected.warnings[0] > 0) && (expected.warnings[-ExboWarn_AttemptIsEarlierThanRecommended] > 0));
+    CHECK(expected.errors > 0);
+#if !EXBO_STATS
+    // Both calls zeroed their counts.
+    memset((void *)&expected, 0, sizeof(expected));
+#endif
+    CHECK(exboGetStats(&after) == (EXBO_STATS ? 0 : ExboErr_StatsDisabled));
+    zStatsCheckGrowth(&before, &after, &expected);
+    // Each thread counts in a block of its own, merged on read.
+    before = after;
+    for (t = 0; t < STATS_THREADS; t++) {
+        threads[t].config = cp;
+        threads[t].seed = zRandom() | UINT64_C(1);
+        threads[t].failures = 0;
+        CHECK(pthread_create(&ids[t], (const pthread_attr_t *)0, zStatsThread, (void *)&threads[t]) == 0);
+    }
+    for (t = 0; t < STATS_THREADS; t++) {
+        CHECK(pthread_join(ids[t], (void **)0) == 0);
+        CHECK(threads[t].failures == 0);
+    }
+    CHECK(exboGetStats(&after) == (EXBO_STATS ? 0 : ExboErr_StatsDisabled));
+    CHECK(after.records - before.records == (int64_t)(EXBO_STATS ? STATS_THREADS * STATS_RECORDS : 0));
+    sum = (int64_t)0;
+    for (i = 0; i < Exbo_StatsBuckets; i++) {
+        sum += after.intervals[i] - before.intervals[i];
+    }
+    CHECK(sum == (int64_t)(EXBO_STATS ? STATS_THREADS * STATS_RECORDS : 0));
+    printf("stats: %lld record(s), %lld error(s), %lld not ready, %lld early\n", (long long)after.records,
+           (long long)after.errors, (long long)after.notReady,
+           (long long)after.warnings[-ExboWarn_AttemptIsEarlierThanRecommended]);
+    exboConfigDestroy(cp);
+    return;
+}
+
+/* A sink counts what was recorded or tried through its instance alone,
+ * as replaying it predicts, whether or not EXBO_STATS is set, and stops
+ * counting once detached.
+ */
+static void zTestStatsSink(void) {
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exbo other = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    const struct config *config = &((struct instance *)xp)->config;
+    exboStats sink;
+    exboStats none;
+    exboStats expected;
+    exboStats held;
+    struct state replay;
+    int64_t now = (int64_t)0;
+    int64_t wait;
+    int i;
+    CHECK((xp != (exbo)0) && (other != (exbo)0));
+    CHECK(exboSetStatsSink((exbo)0, &sink) == ExboErr_NoInstance);
+    memset((void *)&sink, 0, sizeof(sink));
+    memset((void *)&none, 0, sizeof(none));
+    memset((void *)&expected, 0, sizeof(expected));
+    CHECK(exboSetStatsSink(xp, &sink) == 0);
+    zStateInit(&replay);
+    for (i = 0; i < 5000; i++) {
+        // Each way of recording through an instance, with early, late and
+        // now and then prior attempts
+        int64_t time = now + (int64_t)(zRandom() % UINT64_C(300)) - (int64_t)20;
+        int way = (int)(zRandom() % UINT64_C(4));
+        int warning;
+        int result;
+        if ((way == 3) && (time < zStateGetNextAttemptTime(&replay))) {
+            CHECK(exboTryAttempt(xp, time, &wait) == ExboErr_AttemptNotReady);
+            expected.notReady++;
+        } else {
+            result = zStateRecordAttemptWarning(&replay, config, time, &warning);
+            if (way == 0) {
+                CHECK(exboRecordAttempt(xp, time) == ((result == 0) ? warning : result));
+            } else if (way == 1) {
+                CHECK(exboRecordAttemptWeighted(xp, time, config->A) == ((result == 0) ? warning : result));
+            } else if (way == 2) {
+                CHECK(exboRecordAttemptLevels(&xp, (size_t)1, time, (int64_t *)0, (size_t *)0)
+                      == ((result == 0) ? warning : result));
+            } else {
+                CHECK(exboTryAttempt(xp, time, &wait) == ((result == 0) ? warning : result));
+            }
+            if (result == 0) {
+                now = time;
+                expected.records++;
+                expected.warnings[-warning]++;
+                expected.intervals[zStatsBucket(replay.I)]++;
+                expected.debts[zStatsBucket(replay.D)]++;
+            } else {
+                CHECK(result == ExboErr_RecordingAPriorAttempt);
+                expected.errors++;
+            }
+        }
+    }
+    zStatsCheckGrowth(&none, &sink, &expected);
+    CHECK((expected.warnings[0] > 0) && (expected.warnings[-ExboWarn_AttemptIsEarlierThanRecommended] > 0));
+    CHECK((expected.errors > 0) && (expected.notReady > 0));
+    // Another instance, and a detached one, leave the sink alone.
+    held = sink;
+    CHECK(exboRecordAttempt(other, (int64_t)0) == 0);
+    CHECK(exboSetStatsSink(xp, (exboStats *)0) == 0);
+    CHECK(exboRecordAttempt(xp, now + (int64_t)100000) == 0);
+    CHECK(memcmp((const void *)&held, (const void *)&sink, sizeof(sink)) == 0);
+    exboDestroy(xp);
+    exboDestroy(other);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
@@ -0,0 +1,209 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The unit tests exercise the internal functions directly. */
+#include "../exboClock.c"
+#include <stdio.h>
+#include <string.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Reads of each clock checked against CLOCK_MONOTONIC */
+#define CLOCK_READS 100000
+
+/* Microseconds, to compare the clocks in */
+#define MICROSECONDS ((int64_t)1000000)
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line);
+static void zTestConfigure(void);
+static void zTestSource(int source, int64_t behind, int64_t ahead);
+static void zTestSources(void);
+static void zTestNowVariants(void);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    zTestConfigure();
+    zTestSources();
+    zTestNowVariants();
+    if (zFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+/* The default is milliseconds of CLOCK_MONOTONIC, and a configuration
+ * that fails leaves the clock as it was.
+ */
+static void zTestConfigure(void) {
+    CHECK(exboClockGetSource() == ExboClock_Monotonic);
+    CHECK(exboClockGetUnitsPerSecond() == (int64_t)1000);
+    CHECK(exboClockConfigure(ExboClock_Coarse, (int64_t)0) == ExboErr_InvalidClockUnits);
+    CHECK(exboClockConfigure(ExboClock_Coarse, Exbo_MaximumClockUnits + (int64_t)1) == ExboErr_InvalidClockUnits);
+    CHECK(exboClockConfigure(99, (int64_t)1000) == ExboErr_InvalidClockSource);
+    CHECK(exboClockGetSource() == ExboClock_Monotonic);
+    CHECK(exboClockGetUnitsPerSecond() == (int64_t)1000);
+    CHECK(exboClockConfigure(ExboClock_Coarse, Exbo_MaximumClockUnits) == 0);
+    CHECK(exboClockGetUnitsPerSecond() == Exbo_MaximumClockUnits);
+    CHECK(exboClockSet(Exbo_MinimumTime - (int64_t)1) == ExboErr_InvalidClockTime);
+    CHECK(exboClockConfigure(ExboClock_Monotonic, (int64_t)1000) == 0);
+    return;
+}
+
+/* Each read lies between reads of CLOCK_MONOTONIC taken around it, give
+ * or take the microseconds it may be behind or ahead, and no read goes
+ * back.
+ */
+static void zTestSource(int source, int64_t behind, int64_t ahead) {
+    int64_t previous = INT64_MIN;
+    int64_t worst = (int64_t)0;
+    int i;
+    for (i = 0; i < CLOCK_READS; i++) {
+        int64_t before = zRead(CLOCK_MONOTONIC, MICROSECONDS);
+        int64_t now = exboClockNow();
+        int64_t after = zRead(CLOCK_MONOTONIC, MICROSECONDS);
+        CHECK(now >= previous);
+        CHECK((now >= before - behind) && (now <= after + ahead));
+        if (before - now > worst) {
+            worst = before - now;
+        }
+        if (now - after > worst) {
+            worst = now - after;
+        }
+        previous = now;
+    }
+    printf("clock %d: %d read(s), at most %lld us outside CLOCK_MONOTONIC\n", source, CLOCK_READS,
+           (long long)worst);
+    return;
+}
+
+static void zTestSources(void) {
+    int r;
+    CHECK(exboClockConfigure(ExboClock_Monotonic, MICROSECONDS) == 0);
+    zTestSource(ExboClock_Monotonic, (int64_t)0, (int64_t)0);
+    // The coarse clock is stale by a tick, or by more when ticks are
+    // skipped, but never ahead.
+    CHECK(exboClockConfigure(ExboClock_Coarse, MICROSECONDS) == 0);
+    zTestSource(ExboClock_Coarse, (int64_t)100000, (int64_t)0);
+    // The counter drifts from CLOCK_MONOTONIC by its calibration error.
+    r = exboClockConfigure(ExboClock_Tsc, MICROSECONDS);
+    if (r == 0) {
+        CHECK(exboClockGetSource() == ExboClock_Tsc);
+        zTestSource(ExboClock_Tsc, (int64_t)2000, (int64_t)2000);
+    } else {
+        CHECK(r == ExboErr_ClockUnsupported);
+        CHECK(exboClockGetSource() == ExboClock_Coarse);
+        printf("clock %d: unsupported\n", ExboClock_Tsc);
+    }
+    CHECK(exboClockConfigure(ExboClock_Monotonic, (int64_t)1000) == 0);
+    return;
+}
+
+/* The Now variants act as their counterparts at the clock's time. */
+static void zTestNowVariants(void) {
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exbo yp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboState s;
+    exboState t;
+    int64_t wait;
+    int64_t waitReference;
+    int64_t next;
+    CHECK(exboStateInit(&s) == 0);
+    CHECK(exboStateInit(&t) == 0);
+    CHECK(exboClockConfigure(ExboClock_Manual, (int64_t)1000) == 0);
+    CHECK(exboClockSet((int64_t)5000) == 0);
+    CHECK(exboClockNow() == (int64_t)5000);
+    CHECK(exboRecordAttemptNow(xp) == 0);
+    CHECK(exboRecordAttempt(yp, (int64_t)5000) == 0);
+    CHECK(exboStateRecordAttemptNow(cp, &s) == 0);
+    CHECK(exboStateRecordAttempt(cp, &t, (int64_t)5000) == 0);
+    CHECK(exboGetPreviousAttemptTime(xp) == (int64_t)5000);
+    next = exboGetNextAttemptTime(xp);
+    CHECK(exboGetWaitNow(xp) == next - (int64_t)5000);
+    // Not yet ready
+    CHECK(exboClockSet(next - (int64_t)1) == 0);
+    CHECK(exboGetWaitNow(xp) == (int64_t)1);
+    CHECK(exboTryAttemptNow(xp, &wait) == ExboErr_AttemptNotReady);
+    CHECK(exboTryAttempt(yp, next - (int64_t)1, &waitReference) == ExboErr_AttemptNotReady);
+    CHECK(wait == waitReference);
+    CHECK(exboStateTryAttemptNow(cp, &s, &wait) == ExboErr_AttemptNotReady);
+    CHECK(wait == (int64_t)1);
+    // Ready
+    CHECK(exboClockSet(next + (int64_t)7) == 0);
+    CHECK(exboTryAttemptNow(xp, &wait) == 0);
+    CHECK(exboTryAttempt(yp, next + (int64_t)7, &waitReference) == 0);
+    CHECK((wait == (int64_t)0) && (waitReference == (int64_t)0));
+    CHECK(exboStateTryAttemptNow(cp, &s, (int64_t *)0) == 0);
+    CHECK(exboStateTryAttempt(cp, &t, next + (int64_t)7, (int64_t *)0) == 0);
+    CHECK(memcmp((const void *)&s, (const void *)&t, sizeof(s)) == 0);
+    CHECK(exboGetNextAttemptTime(xp) == exboGetNextAttemptTime(yp));
+    CHECK(exboGetPayBackTime(xp) == exboGetPayBackTime(yp));
+    CHECK(exboClockSet(INT64_MAX) == 0);
+    CHECK(exboGetWaitNow(xp) == (int64_t)0);
+    // Errors pass through.
+    CHECK(exboRecordAttemptNow((exbo)0) == ExboErr_NoInstance);
+    CHECK(exboGetWaitNow((exbo)0) == INT64_MIN + (int64_t)ExboErr_NoInstance);
+    CHECK(exboStateRecordAttemptNow((exboConfig)0, &s) == ExboErr_NoConfig);
+    CHECK(exboClockConfigure(ExboClock_Monotonic, (int64_t)1000) == 0);
+    exboConfigDestroy(cp);
+    exboDestroy(xp);
+    exboDestroy(yp);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
@@ -0,0 +1,367 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <exbo_coro.hpp>
+#include <cstdio>
+#include <new>
+#include <vector>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Attempts each coroutine waits for */
+#define WAIT_ATTEMPTS 1000
+
+/* Coroutines sharing a state, and attempts each records */
+#define SHARED_TASKS 5
+#define SHARED_ATTEMPTS 200
+
+/* Tasks started one after another on a frame pool */
+#define FRAME_TASKS 1000
+
+/*********************************
+ * internal class declarations
+ *********************************/
+/* A memory resource that counts allocations, and what is outstanding */
+class countingResource : public std::pmr::memory_resource {
+public:
+    long allocations = 0;
+    long outstanding = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        allocations++;
+        outstanding++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        outstanding--;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+/* A memory resource that is always out of memory */
+class failingResource : public std::pmr::memory_resource {
+private:
+    void *do_allocate(std::size_t, std::size_t) override {
+        throw std::bad_alloc();
+    }
+
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+using zBackoff = Exbo::backoff<2, 1, 100, 1000>;
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(bool condition, const char *text, const char *file, int line);
+static Exbo::task zWaitInstance(Exbo::instance &x, Exbo::simple_executor &ex, std::vector<std::int64_t> &times);
+static Exbo::task zWaitBackoff(Exbo::state &s, Exbo::simple_executor &ex);
+static Exbo::task zWaitAtomic(exboConfig cp, exboAtomicState &s, Exbo::simple_executor &ex);
+static Exbo::task zWaitShared(exboConfig cp, exboState &s, Exbo::simple_executor &ex,
+                              std::vector<std::int64_t> &times, int &retries);
+static Exbo::task zWaitOnce(Exbo::instance &x, Exbo::simple_executor &ex, bool &ran);
+static void zTestInstanceWaits(void);
+static void zTestBackoffWaits(void);
+static void zTestAtomicWaits(void);
+static void zTestSharedState(void);
+static void zTestErrors(void);
+static void zTestFrames(void);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    zTestInstanceWaits();
+    zTestBackoffWaits();
+    zTestAtomicWaits();
+    zTestSharedState();
+    zTestErrors();
+    zTestFrames();
+    if (zFailures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(bool condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+/* Each wait ends at the next attempt time, or at once if that has
+ * passed, with the attempt recorded then.
+ */
+static Exbo::task zWaitInstance(Exbo::instance &x, Exbo::simple_executor &ex, std::vector<std::int64_t> &times) {
+    for (int i = 0; i < WAIT_ATTEMPTS; i++) {
+        std::int64_t expected = std::max(ex.now(), *x.next_attempt_time());
+        Exbo::result<void> r = co_await Exbo::wait_ready(x, ex);
+        CHECK(r.has_value());
+        CHECK(ex.now() == expected);
+        CHECK(*x.previous_attempt_time() == expected);
+        times.push_back(ex.now());
+    }
+}
+
+static Exbo::task zWaitBackoff(Exbo::state &s, Exbo::simple_executor &ex) {
+    for (int i = 0; i < WAIT_ATTEMPTS; i++) {
+        std::int64_t expected = std::max(ex.now(), zBackoff::next_attempt_time(s));
+        Exbo::result<void> r = co_await Exbo::wait_ready<zBackoff>(s, ex);
+        CHECK(r.has_value());
+        CHECK(ex.now() == expected);
+        CHECK(s.T == expected);
+    }
+}
+
+static Exbo::task zWaitAtomic(exboConfig cp, exboAtomicState &s, Exbo::simple_executor &ex) {
+    for (int i = 0; i < WAIT_ATTEMPTS; i++) {
+        std::int64_t expected = std::max(ex.now(), exboAtomicStateGetNextAttemptTime(cp, &s));
+        Exbo::result<void> r = co_await Exbo::wait_ready(cp, s, ex);
+        CHECK(r.has_value());
+        CHECK(ex.now() == expected);
+        CHECK(exboAtomicStateGetPreviousAttemptTime(&s) == expected);
+    }
+}
+
+/* Coroutines that lose the attempt to another wait again */
+static Exbo::task zWaitShared(exboConfig cp, exboState &s, Exbo::simple_executor &ex,
+                              std::vector<std::int64_t> &times, int &retries) {
+    int recorded = 0;
+    while (recorded < SHARED_ATTEMPTS) {
+        Exbo::result<void> r = co_await Exbo::wait_ready(cp, s, ex);
+        if (r) {
+            times.push_back(ex.now());
+            recorded++;
+        } else {
+            CHECK(r.error() == ExboErr_AttemptNotReady);
+            retries++;
+        }
+    }
+}
+
+static Exbo::task zWaitOnce(Exbo::instance &x, Exbo::simple_executor &ex, bool &ran) {
+    ran = true;
+    // Tasks that share x may lose the attempt; only the frame matters here.
+    static_cast<void>(co_await Exbo::wait_ready(x, ex));
+}
+
+/* Once the timer heap has grown, waiting allocates nothing. */
+static void zTestInstanceWaits(void) {
+    countingResource counting;
+    Exbo::simple_executor ex(1000, &counting);
+    Exbo::result<Exbo::instance> x = Exbo::instance::create(2.0, 100, 1000);
+    std::vector<std::int64_t> times;
+    CHECK(x.has_value());
+    times.reserve(WAIT_ATTEMPTS);
+    ex.reserve(1);
+    long allocations = counting.allocations;
+    Exbo::task t = zWaitInstance(*x, ex, times);
+    CHECK(static_cast<bool>(t));
+    // The first attempt is ready at once, the second is not.
+    CHECK(!t.done());
+    CHECK(ex.pending() == 1);
+    CHECK(times.size() == 1);
+    CHECK(ex.run() == WAIT_ATTEMPTS - 1);
+    CHECK(t.done());
+    CHECK(times.size() == WAIT_ATTEMPTS);
+    CHECK(counting.allocations == allocations);
+    // The waits replay as records on a state with the same config.
+    exboConfig cp = exboConfigCreate(2.0, 100, 1000);
+    exboState s;
+    CHECK(exboStateInit(&s) == 0);
+    for (std::size_t i = 0; i < times.size(); i++) {
+        if (i > 0) {
+            CHECK(times[i] == exboStateGetNextAttemptTime(&s));
+        }
+        CHECK(exboStateRecordAttempt(cp, &s, times[i]) == 0);
+    }
+    exboConfigDestroy(cp);
+    std::printf("wait: %zu attempt(s) up to time %lld\n", times.size(), static_cast<long long>(ex.now()));
+    return;
+}
+
+static void zTestBackoffWaits(void) {
+    Exbo::simple_executor ex(-5000);
+    Exbo::state s;
+    Exbo::task t = zWaitBackoff(s, ex);
+    CHECK(ex.run() == WAIT_ATTEMPTS - 1);
+    CHECK(t.done());
+    return;
+}
+
+static void zTestAtomicWaits(void) {
+    Exbo::simple_executor ex;
+    exboConfig cp = exboConfigCreate(1.5, 10, 10000);
+    exboAtomicState s;
+    CHECK(exboAtomicStateInit(&s) == 0);
+    Exbo::task t = zWaitAtomic(cp, s, ex);
+    CHECK(ex.run() == WAIT_ATTEMPTS - 1);
+    CHECK(t.done());
+    exboConfigDestroy(cp);
+    return;
+}
+
+/* Coroutines on one state: every attempt recorded was ready when it was
+ * recorded, and those that lost the race waited again.
+ */
+static void zTestSharedState(void) {
+    Exbo::simple_executor ex;
+    exboConfig cp = exboConfigCreate(2.0, 10, 1000);
+    exboState s;
+    std::vector<std::int64_t> times;
+    std::vector<Exbo::task> tasks;
+    int retries = 0;
+    CHECK(exboStateInit(&s) == 0);
+    for (int k = 0; k < SHARED_TASKS; k++) {
+        tasks.push_back(zWaitShared(cp, s, ex, times, retries));
+    }
+    ex.run();
+    for (const Exbo::task &t : tasks) {
+        CHECK(t.done());
+    }
+    CHECK(times.size() == SHARED_TASKS * SHARED_ATTEMPTS);
+    CHECK(retries > 0);
+    exboState replay;
+    CHECK(exboStateInit(&replay) == 0);
+    for (std::int64_t time : times) {
+        CHECK(time >= exboStateGetNextAttemptTime(&replay));
+        CHECK(exboStateRecordAttempt(cp, &replay, time) == 0);
+    }
+    CHECK(std::memcmp(&replay, &s, sizeof(s)) == 0);
+    std::printf("shared: %d coroutine(s), %zu attempt(s), %d lost\n", SHARED_TASKS, times.size(), retries);
+    exboConfigDestroy(cp);
+    return;
+}
+
+/* An error is reported at once, without suspending. */
+static void zTestErrors(void) {
+    Exbo::simple_executor ex;
+    Exbo::result<Exbo::instance> x = Exbo::instance::create(2.0, 100, 1000);
+    Exbo::instance moved = std::move(*x);
+    exboState s;
+    CHECK(exboStateInit(&s) == 0);
+    auto awaitNone = [&]() -> Exbo::task {
+        Exbo::result<void> r = co_await Exbo::wait_ready(*x, ex);
+        CHECK(!r && (r.error() == ExboErr_NoInstance));
+        r = co_await Exbo::wait_ready(static_cast<exboConfig>(nullptr), s, ex);
+        CHECK(!r && (r.error() == ExboErr_NoConfig));
+    };
+    Exbo::task t = awaitNone();
+    CHECK(t.done());
+    CHECK(ex.pending() == 0);
+    return;
+}
+
+/* Frames come from the resource of the enclosing scope, or the thread's
+ * frame resource, and are returned there, even after the scope ends; a pool in front of the thread's resource
+ * serves task after task from the same memory.
+ */
+static void zTestFrames(void) {
+    countingResource counting;
+    failingResource failing;
+    Exbo::simple_executor ex;
+    Exbo::result<Exbo::instance> x = Exbo::instance::create(2.0, 100, 1000);
+    bool ran = false;
+    {
+        std::vector<Exbo::task> tasks;
+        tasks.reserve(100);
+        {
+            Exbo::frame_resource_scope scope(&counting);
+            for (int i = 0; i < 100; i++) {
+                tasks.push_back(zWaitOnce(*x, ex, ran));
+            }
+        }
+        CHECK(Exbo::frame_resource() != &counting);
+        CHECK(counting.outstanding == 100);
+        ex.run();
+        CHECK(counting.outstanding == 100);
+    }
+    CHECK(counting.outstanding == 0);
+    // Out of memory
+    ran = false;
+    {
+        Exbo::frame_resource_scope scope(&failing);
+        Exbo::task empty = zWaitOnce(*x, ex, ran);
+        CHECK(!empty && !ran);
+    }
+    // The thread's frame resource
+    std::pmr::unsynchronized_pool_resource pool(&counting);
+    CHECK(Exbo::set_frame_resource(&pool) == nullptr);
+    CHECK(Exbo::frame_resource() == &pool);
+    long allocations = 0;
+    for (int i = 0; i < FRAME_TASKS; i++) {
+        ran = false;
+        Exbo::task t = zWaitOnce(*x, ex, ran);
+        ex.run();
+        CHECK(ran && t.done());
+        if (i == 0) {
+            allocations = counting.allocations;
+        }
+    }
+    CHECK(counting.allocations == allocations);
+    CHECK(Exbo::set_frame_resource(nullptr) == &pool);
+    CHECK(Exbo::frame_resource() != &pool);
+    // The default pool of the thread
+    ran = false;
+    Exbo::task t = zWaitOnce(*x, ex, ran);
+    ex.run();
+    CHECK(ran && t.done());
+    std::printf("frames: %d task(s), %ld upstream allocation(s)\n", FRAME_TASKS, allocations);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
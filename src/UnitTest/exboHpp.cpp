@@ -0,0 +1,280 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <exbo.hpp>
+#include <cstdio>
+#include <vector>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Random debts and random walks compared per configuration */
+#define DEBT_CASES 20000
+#define WALK_STEPS 20000
+
+/* Instances held in a container */
+#define CONTAINER_INSTANCES 100
+
+/*********************************
+ * internal class declarations
+ *********************************/
+/* A memory resource that counts what is outstanding */
+class countingResource : public std::pmr::memory_resource {
+public:
+    long outstanding = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        outstanding++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        outstanding--;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(bool condition, const char *text, const char *file, int line);
+static std::uint64_t zRandom(void);
+template <std::int64_t X_num, std::int64_t X_den, std::int64_t A, std::int64_t L>
+static void zTestBackoff(const char *name);
+static void zTestWarnings(void);
+static void zTestInstance(void);
+static void zTestInstanceContainers(void);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+static std::uint64_t zRandomState = UINT64_C(0x9e3779b97f4a7c15);
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    zTestBackoff<2, 1, 100, 1000>("2/1");
+    zTestBackoff<3, 2, 1000, 20000>("3/2");
+    zTestBackoff<101, 100, 10, 1000>("101/100");
+    zTestBackoff<1000001, 1000000, 1000, 60000>("1000001/1000000");
+    zTestBackoff<4, 1, 1, 100>("4/1");
+    zTestBackoff<-3, -2, 7, 70000>("-3/-2");
+    zTestBackoff<1, 1, 10, 100>("1/1");
+    zTestBackoff<2, 1, 5, 5>("2/1, L == A");
+    zTestWarnings();
+    zTestInstance();
+    zTestInstanceContainers();
+    if (zFailures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(bool condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+static std::uint64_t zRandom(void) {
+    // xorshift64*
+    zRandomState ^= zRandomState >> 12;
+    zRandomState ^= zRandomState << 25;
+    zRandomState ^= zRandomState >> 27;
+    return zRandomState * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+/* Each record matches the library's integer engine, which is exact,
+ * in result, T and D, and in I to within the one time unit that rounding
+ * in long double may cost.
+ */
+template <std::int64_t X_num, std::int64_t X_den, std::int64_t A, std::int64_t L>
+static void zTestBackoff(const char *name) {
+    using backoff = Exbo::backoff<X_num, X_den, A, L>;
+    exbo xp = exboCreateConfigured(backoff::X, A, L);
+    CHECK(exboConfigure_Engine(xp, ExboEngine_Integer) == 0);
+    exboConfig cp = exboConfigCreateFrom(xp);
+    exboState reference;
+    Exbo::state expected;
+    Exbo::state s;
+    std::int64_t now = 0;
+    int offByOne = 0;
+    int cases = 0;
+    int i;
+    CHECK(cp != (exboConfig)0);
+    CHECK(exboStateInit(&reference) == 0);
+    s = Exbo::from_exbo_state(reference);
+    CHECK((s.T == INT64_MIN) && (s.D == 0) && (s.I == 0));
+    for (i = 0; i < DEBT_CASES + WALK_STEPS; i++) {
+        if (i < DEBT_CASES) {
+            // A debt anywhere up to a little past L, recorded at once
+            expected.T = 0;
+            expected.D = static_cast<std::int64_t>(zRandom() % static_cast<std::uint64_t>(L + A));
+            expected.I = 0;
+            Exbo::to_exbo_state(expected, reference);
+            now = 0;
+        } else {
+            // A random walk, averaging one attempt every A
+            now += static_cast<std::int64_t>(zRandom() % static_cast<std::uint64_t>(2 * A));
+        }
+        s = Exbo::from_exbo_state(reference);
+        CHECK(backoff::record(s, now) == exboStateRecordAttempt(cp, &reference, now));
+        expected = Exbo::from_exbo_state(reference);
+        CHECK((s.T == expected.T) && (s.D == expected.D));
+        CHECK((s.I >= expected.I - 1) && (s.I <= expected.I + 1));
+        offByOne += (s.I != expected.I);
+        cases++;
+        // Carry on from the reference state.
+        s = Exbo::from_exbo_state(reference);
+        CHECK(backoff::previous_attempt_time(s) == exboStateGetPreviousAttemptTime(&reference));
+        CHECK(backoff::next_attempt_time(s) == exboStateGetNextAttemptTime(&reference));
+        CHECK(backoff::payback_time(s) == exboStateGetPayBackTime(&reference));
+    }
+    CHECK(backoff::record(s, now - 1) == ExboErr_RecordingAPriorAttempt);
+    std::printf("backoff %s, A %lld, L %lld: table of %zu, %d of %d interval(s) off by one\n", name,
+                static_cast<long long>(A), static_cast<long long>(L), backoff::table_size(), offByOne, cases);
+    exboConfigDestroy(cp);
+    exboDestroy(xp);
+    return;
+}
+
+static void zTestWarnings(void) {
+    using backoff = Exbo::backoff<2, 1, 100, 1000>;
+    Exbo::state s;
+    int warning;
+    CHECK((backoff::record(s, 0, warning) == 0) && (warning == 0));
+    CHECK((backoff::record(s, 0, warning) == 0) && (warning == ExboWarn_AttemptIsEarlierThanRecommended));
+    s.D = 1000;
+    CHECK((backoff::record(s, 0, warning) == 0) && (warning == ExboWarn_ExcessCostLimitBreach));
+    CHECK((s.D == 1100) && (s.I == 200));
+    s.D = INT64_MAX - 50;
+    CHECK((backoff::record(s, 0, warning) == 0) && (warning == ExboWarn_ExcessCostLimitBreachWithDebtOverflow));
+    CHECK((s.D == INT64_MAX) && (s.I == INT64_MAX - 900));
+    CHECK((backoff::record(s, -1, warning) == ExboErr_RecordingAPriorAttempt) && (warning == 0));
+    return;
+}
+
+static void zTestInstance(void) {
+    static_assert(std::is_nothrow_move_constructible<Exbo::instance>::value, "instance must move without throwing");
+    static_assert(std::is_nothrow_move_assignable<Exbo::instance>::value, "instance must move without throwing");
+    static_assert(!std::is_copy_constructible<Exbo::instance>::value, "instance must not be copied");
+    countingResource counting;
+    exbo xp = exboCreateConfigured(2.0, 100, 1000);
+    {
+        Exbo::result<Exbo::instance> created = Exbo::instance::create(2.0, 100, 1000, &counting);
+        CHECK(created.has_value() && (created.error() == 0) && (counting.outstanding == 1));
+        Exbo::instance x = std::move(created).value();
+        CHECK(x && (x.resource() == &counting));
+        CHECK((x.X().value() == 2.0) && (*x.A() == 100) && (*x.L() == 1000));
+        CHECK(x.next_attempt_time().value() == Exbo_MinimumTime);
+        std::int64_t now = 0;
+        int i;
+        for (i = 0; i < 1000; i++) {
+            now += static_cast<std::int64_t>(zRandom() % UINT64_C(200));
+            CHECK(x.record(now).has_value() && (exboRecordAttempt(xp, now) <= 0));
+            CHECK(*x.previous_attempt_time() == exboGetPreviousAttemptTime(xp));
+            CHECK(*x.next_attempt_time() == exboGetNextAttemptTime(xp));
+            CHECK(*x.payback_time() == exboGetPayBackTime(xp));
+        }
+        Exbo::result<void> prior = x.record(now - 1);
+        CHECK(!prior && (prior.error() == ExboErr_RecordingAPriorAttempt));
+        std::int64_t wait;
+        Exbo::result<void> early = x.try_attempt(*x.next_attempt_time() - 1, wait);
+        CHECK((early.error() == ExboErr_AttemptNotReady) && (wait == 1));
+        CHECK(x.record_weighted(now, 300).has_value() && (exboRecordAttemptWeighted(xp, now, 300) <= 0));
+        CHECK(*x.payback_time() == exboGetPayBackTime(xp));
+        CHECK(x.record_weighted(now, 0).error() == ExboErr_InvalidCost);
+        // A moved-from instance is empty, and its errors are decoded.
+        Exbo::instance y = std::move(x);
+        CHECK(!x && y && (counting.outstanding == 1));
+        CHECK(x.record(now).error() == ExboErr_NoInstance);
+        CHECK(x.next_attempt_time().error() == ExboErr_NoInstance);
+        CHECK(x.X().error() == ExboErr_NoInstance);
+        CHECK(x.A().value_or(-1) == -1);
+        CHECK(*y.previous_attempt_time() == now);
+        Exbo::result<Exbo::instance> other = Exbo::instance::create(1.5, 10, 10, &counting);
+        CHECK(counting.outstanding == 2);
+        y = std::move(*other);
+        CHECK((counting.outstanding == 1) && (*y.L() == 10));
+    }
+    CHECK(counting.outstanding == 0);
+    // An invalid configuration fails with the library's error.
+    Exbo::result<Exbo::instance> invalid = Exbo::instance::create(2.0, 100, 10, &counting);
+    CHECK(!invalid && (invalid.error() == ExboErr_InvalidConfig_L2) && (counting.outstanding == 0));
+    CHECK(Exbo::instance::create(0.5, 100, 1000).error() == ExboErr_InvalidConfig_X2);
+    CHECK(Exbo::instance::create(2.0, 0, 1000).error() == ExboErr_InvalidConfig_A1);
+    exboDestroy(xp);
+    return;
+}
+
+static void zTestInstanceContainers(void) {
+    // Instances and the vector that holds them come from one arena.
+    std::pmr::monotonic_buffer_resource arena;
+    countingResource counting;
+    {
+        std::pmr::vector<Exbo::instance> instances(&arena);
+        std::vector<Exbo::instance> pooled;
+        int i;
+        for (i = 0; i < CONTAINER_INSTANCES; i++) {
+            instances.push_back(*Exbo::instance::create(2.0, 100, 1000, &arena));
+            pooled.push_back(*Exbo::instance::create(2.0, 100, 1000, &counting));
+        }
+        for (i = 0; i < CONTAINER_INSTANCES; i++) {
+            CHECK(instances[static_cast<std::size_t>(i)].record(i).has_value());
+            CHECK(*instances[static_cast<std::size_t>(i)].previous_attempt_time() == i);
+        }
+        CHECK(counting.outstanding == CONTAINER_INSTANCES);
+        pooled.erase(pooled.begin(), pooled.begin() + CONTAINER_INSTANCES / 2);
+        CHECK(counting.outstanding == CONTAINER_INSTANCES / 2);
+    }
+    CHECK(counting.outstanding == 0);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
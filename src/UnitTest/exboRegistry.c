@@ -0,0 +1,265 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The unit tests exercise the internal functions directly. */
+#include "../exboRegistry.c"
+#include <stdio.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Keys in the model comparison */
+#define MODEL_KEYS 5000
+#define MODEL_STEPS 200000
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line);
+static uint64_t zRandom(void);
+static void zCheckProbeRuns(const struct registry *p);
+static void zTestMatchesModel(void);
+static void zTestByteKeys(void);
+static void zTestLimits(void);
+static void zTestReclaim(void);
+static int zPaidBack(const exboState *sp, int64_t now);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+static uint64_t zRandomState = UINT64_C(0x9e3779b97f4a7c15);
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    zTestMatchesModel();
+    zTestByteKeys();
+    zTestLimits();
+    zTestReclaim();
+    if (zFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+static uint64_t zRandom(void) {
+    // xorshift64*
+    zRandomState ^= zRandomState >> 12;
+    zRandomState ^= zRandomState << 25;
+    zRandomState ^= zRandomState >> 27;
+    return zRandomState * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+/* Every key must be reachable from its home slot without crossing an
+ * empty slot.
+ */
+static void zCheckProbeRuns(const struct registry *p) {
+    int64_t count = (int64_t)0;
+    uint64_t i;
+    for (i = UINT64_C(0); i <= p->mask; i++) {
+        if (p->control[i] != Z_CONTROL_EMPTY) {
+            uint64_t hash = (p->keySize == (size_t)0) ? zHash64(p->slots[i].key) : p->slots[i].key;
+            uint64_t j = hash & p->mask;
+            while ((j != i) && (p->control[j] != Z_CONTROL_EMPTY)) {
+                j = (j + UINT64_C(1)) & p->mask;
+            }
+            CHECK(j == i);
+            CHECK(p->control[i] == zControl(hash));
+            count++;
+        }
+    }
+    CHECK(count == p->count);
+    return;
+}
+
+static int zPaidBack(const exboState *sp, int64_t now) {
+    int64_t payBack = exboStateGetPayBackTime(sp);
+    return (payBack >= Exbo_MinimumTime) && (payBack <= now);
+}
+
+static void zTestMatchesModel(void) {
+    // Keep a plain exboState per key alongside the registry.  The
+    // registry may drop a key the model still has once it is paid back.
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboRegistry rp = exboRegistryCreate(cp, (int64_t)MODEL_KEYS, (size_t)0);
+    static exboState model[MODEL_KEYS];
+    static int present[MODEL_KEYS];
+    int64_t count = (int64_t)0;
+    int64_t now = (int64_t)0;
+    int step;
+    int k;
+    CHECK(rp != (exboRegistry)0);
+    for (step = 0; step < MODEL_STEPS; step++) {
+        k = (int)(zRandom() % (uint64_t)MODEL_KEYS);
+        uint64_t key = (uint64_t)k * UINT64_C(0x10000) + UINT64_C(7);
+        now += (int64_t)(zRandom() % UINT64_C(20));
+        if (zRandom() % UINT64_C(4) == UINT64_C(0)) {
+            int removed = exboRegistryRemove(rp, key);
+            CHECK(removed == present[k] || (present[k] && zPaidBack(&model[k], now)));
+            present[k] = 0;
+        } else {
+            if (!present[k]) {
+                exboStateInit(&model[k]);
+                present[k] = 1;
+            }
+            CHECK(exboRegistryRecord(rp, key, now) == exboStateRecordAttempt(cp, &model[k], now));
+        }
+    }
+    zCheckProbeRuns((const struct registry *)rp);
+    for (k = 0; k < MODEL_KEYS; k++) {
+        const exboState *sp = exboRegistryFind(rp, (uint64_t)k * UINT64_C(0x10000) + UINT64_C(7));
+        CHECK((sp != (const exboState *)0) == present[k] || (present[k] && zPaidBack(&model[k], now)));
+        if (sp != (const exboState *)0) {
+            CHECK(exboStateGetNextAttemptTime(sp) == exboStateGetNextAttemptTime(&model[k]));
+            CHECK(exboStateGetPayBackTime(sp) == exboStateGetPayBackTime(&model[k]));
+            count++;
+        }
+    }
+    CHECK(exboRegistryGetCount(rp) == count);
+    exboRegistryDestroy(rp);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestByteKeys(void) {
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboRegistry rp = exboRegistryCreate(cp, (int64_t)100, (size_t)16);
+    const char *hosts[3] = {"example.com", "example.org", ""};
+    char name[32];
+    int i;
+    CHECK(rp != (exboRegistry)0);
+    CHECK(exboRegistryRecordBytes(rp, hosts[0], strlen(hosts[0]), (int64_t)10) == 0);
+    CHECK(exboRegistryRecordBytes(rp, hosts[1], strlen(hosts[1]), (int64_t)20) == 0);
+    CHECK(exboRegistryRecordBytes(rp, hosts[2], strlen(hosts[2]), (int64_t)30) == 0);
+    CHECK(exboRegistryRecordBytes(rp, hosts[0], strlen(hosts[0]), (int64_t)5) == ExboErr_RecordingAPriorAttempt);
+    CHECK(exboStateGetPreviousAttemptTime(exboRegistryFindBytes(rp, hosts[1], strlen(hosts[1])))
+          == (int64_t)20);
+    CHECK(exboRegistryFindBytes(rp, "example", (size_t)7) == (const exboState *)0);
+    CHECK(exboRegistryRecordBytes(rp, "a-name-that-is-too-long", (size_t)23, (int64_t)0)
+          == ExboErr_RegistryKeyTooLong);
+    CHECK(exboRegistryRecord(rp, UINT64_C(1), (int64_t)0) == ExboErr_RegistryKeyType);
+    for (i = 0; i < 60; i++) {
+        sprintf(name, "tenant-%d", i);
+        CHECK(exboRegistryRecordBytes(rp, name, strlen(name), (int64_t)i) == 0);
+    }
+    for (i = 0; i < 60; i += 2) {
+        sprintf(name, "tenant-%d", i);
+        CHECK(exboRegistryRemoveBytes(rp, name, strlen(name)) == 1);
+    }
+    zCheckProbeRuns((const struct registry *)rp);
+    for (i = 0; i < 60; i++) {
+        sprintf(name, "tenant-%d", i);
+        CHECK((exboRegistryFindBytes(rp, name, strlen(name)) != (const exboState *)0) == (i % 2));
+    }
+    CHECK(exboRegistryGetCount(rp) == (int64_t)33);
+    exboRegistryDestroy(rp);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestLimits(void) {
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboRegistry rp = exboRegistryCreate(cp, (int64_t)10, (size_t)0);
+    int64_t limit;
+    int64_t i;
+    CHECK(exboRegistryCreate((exboConfig)0, (int64_t)10, (size_t)0) == (exboRegistry)0);
+    CHECK(exboRegistryCreate(cp, (int64_t)0, (size_t)0) == (exboRegistry)0);
+    CHECK(exboRegistryCreate(cp, (int64_t)10, (size_t)256) == (exboRegistry)0);
+    CHECK(rp != (exboRegistry)0);
+    limit = ((const struct registry *)rp)->limit;
+    CHECK(limit >= (int64_t)10);
+    for (i = 0; i < limit; i++) {
+        CHECK(exboRegistryRecord(rp, (uint64_t)i, (int64_t)0) == 0);
+    }
+    CHECK(exboRegistryRecord(rp, (uint64_t)limit, (int64_t)0) == ExboErr_RegistryFull);
+    CHECK(exboRegistryRecord(rp, UINT64_C(0), (int64_t)1) == 0);
+    CHECK(exboRegistryRecord((exboRegistry)0, UINT64_C(0), (int64_t)1) == ExboErr_NoInstance);
+    CHECK(exboRegistryRecordBytes(rp, "x", (size_t)1, (int64_t)0) == ExboErr_RegistryKeyType);
+    exboRegistryDestroy(rp);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestReclaim(void) {
+    // Keys paid back make room for new ones.
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboRegistry rp = exboRegistryCreate(cp, (int64_t)10, (size_t)0);
+    int64_t limit;
+    int64_t count;
+    int64_t i;
+    CHECK(rp != (exboRegistry)0);
+    limit = ((const struct registry *)rp)->limit;
+    for (i = 0; i < limit; i++) {
+        CHECK(exboRegistryRecord(rp, (uint64_t)i, i) == 0);
+    }
+    CHECK(exboRegistryRecord(rp, (uint64_t)limit, (int64_t)99) == ExboErr_RegistryFull);
+    // Keys 0 and 1 are paid back at 100 and 101.
+    CHECK(exboRegistryRecord(rp, (uint64_t)limit, (int64_t)101) == 0);
+    CHECK(exboRegistryFind(rp, UINT64_C(0)) == (const exboState *)0);
+    CHECK(exboRegistryFind(rp, UINT64_C(1)) == (const exboState *)0);
+    CHECK(exboRegistryFind(rp, UINT64_C(2)) != (const exboState *)0);
+    CHECK(exboRegistryGetCount(rp) == limit - (int64_t)1);
+    zCheckProbeRuns((const struct registry *)rp);
+    // A reclaimed key starts afresh.
+    CHECK(exboRegistryRecord(rp, UINT64_C(0), (int64_t)102) == 0);
+    CHECK(exboStateGetPayBackTime(exboRegistryFind(rp, UINT64_C(0))) == (int64_t)202);
+    count = exboRegistryGetCount(rp);
+    CHECK(exboRegistryReclaim(rp, (int64_t)150) == count - (int64_t)2);
+    CHECK(exboRegistryFind(rp, (uint64_t)limit) != (const exboState *)0);
+    zCheckProbeRuns((const struct registry *)rp);
+    CHECK(exboRegistryReclaim(rp, (int64_t)1000) == (int64_t)2);
+    CHECK(exboRegistryGetCount(rp) == (int64_t)0);
+    CHECK(exboRegistryReclaim((exboRegistry)0, (int64_t)0) < Exbo_MinimumTime);
+    exboRegistryDestroy(rp);
+    exboConfigDestroy(cp);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
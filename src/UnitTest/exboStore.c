@@ -0,0 +1,322 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The unit tests exercise the internal functions directly. */
+#include "../exboStore.c"
+#include <stdio.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Keys in the model comparison */
+#define MODEL_KEYS 1000
+#define MODEL_STEPS 50000
+
+/* Keys churned through a small store */
+#define CHURN_KEYS 64
+#define CHURN_STEPS 100000
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line);
+static uint64_t zRandom(void);
+static void zTempPath(char *path);
+static void zTestReopen(void);
+static void zTestRejects(void);
+static void zTestBusy(void);
+static void zTestChurn(void);
+static void zTestStaleCopy(void);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+static uint64_t zRandomState = UINT64_C(0x9e3779b97f4a7c15);
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    zTestReopen();
+    zTestRejects();
+    zTestBusy();
+    zTestChurn();
+    zTestStaleCopy();
+    if (zFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+static uint64_t zRandom(void) {
+    // xorshift64*
+    zRandomState ^= zRandomState >> 12;
+    zRandomState ^= zRandomState << 25;
+    zRandomState ^= zRandomState >> 27;
+    return zRandomState * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+static void zTempPath(char *path) {
+    // Reserve a fresh name, leaving an empty file for the store to size.
+    int fd;
+    strcpy(path, "/tmp/exboStoreXXXXXX");
+    fd = mkstemp(path);
+    CHECK(fd >= 0);
+    (void)close(fd);
+    return;
+}
+
+static void zTestReopen(void) {
+    // States recorded before a close carry on after a reopen.
+    static exboState model[MODEL_KEYS];
+    static int present[MODEL_KEYS];
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboStore stp;
+    char path[32];
+    int64_t count = (int64_t)0;
+    int64_t now = (int64_t)0;
+    int step;
+    int k;
+    zTempPath(path);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)MODEL_KEYS) == 0);
+    for (step = 0; step < MODEL_STEPS; step++) {
+        k = (int)(zRandom() % (uint64_t)MODEL_KEYS);
+        now += (int64_t)(zRandom() % UINT64_C(20));
+        if (zRandom() % UINT64_C(4) == UINT64_C(0)) {
+            CHECK(exboStoreRemove(stp, (uint64_t)k << 32) == present[k]);
+            count -= (int64_t)present[k];
+            present[k] = 0;
+        } else {
+            if (!present[k]) {
+                exboStateInit(&model[k]);
+                present[k] = 1;
+                count++;
+            }
+            CHECK(exboStoreRecord(stp, (uint64_t)k << 32, now) == exboStateRecordAttempt(cp, &model[k], now));
+        }
+        if (step % (MODEL_STEPS / 5) == 0) {
+            CHECK(exboStoreSync(stp) == 0);
+            CHECK(exboStoreClose(stp) == 0);
+            CHECK(exboStoreOpen(&stp, path, cp, (int64_t)0) == 0);
+        }
+    }
+    CHECK(exboStoreClose(stp) == 0);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)0) == 0);
+    CHECK(exboStoreGetCount(stp) == count);
+    for (k = 0; k < MODEL_KEYS; k++) {
+        const exboState *sp = exboStoreFind(stp, (uint64_t)k << 32);
+        CHECK((sp != (const exboState *)0) == present[k]);
+        if (sp != (const exboState *)0) {
+            CHECK(exboStateGetPreviousAttemptTime(sp) == exboStateGetPreviousAttemptTime(&model[k]));
+            CHECK(exboStateGetNextAttemptTime(sp) == exboStateGetNextAttemptTime(&model[k]));
+            CHECK(exboStateGetPayBackTime(sp) == exboStateGetPayBackTime(&model[k]));
+        }
+    }
+    CHECK(exboStoreClose(stp) == 0);
+    CHECK(remove(path) == 0);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestRejects(void) {
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboConfig other = exboConfigCreate(2.0, (int64_t)100, (int64_t)2000);
+    exboStore stp;
+    char path[32];
+    FILE *file;
+    int64_t limit;
+    int64_t i;
+    zTempPath(path);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)0) == ExboErr_StoreIo);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)10) == 0);
+    limit = ((const struct store *)stp)->limit;
+    for (i = 0; i < limit; i++) {
+        CHECK(exboStoreRecord(stp, (uint64_t)i, (int64_t)0) == 0);
+    }
+    CHECK(exboStoreRecord(stp, (uint64_t)limit, (int64_t)0) == ExboErr_StoreFull);
+    CHECK(exboStoreRecord(stp, UINT64_C(0), (int64_t)-1) == ExboErr_RecordingAPriorAttempt);
+    CHECK(exboStoreClose(stp) == 0);
+    CHECK(exboStoreOpen(&stp, path, other, (int64_t)10) == ExboErr_StoreConfigMismatch);
+    CHECK(stp == (exboStore)0);
+    // Spoil the magic.
+    file = fopen(path, "r+b");
+    CHECK(file != (FILE *)0);
+    CHECK(fputc('X', file) == 'X');
+    CHECK(fclose(file) == 0);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)10) == ExboErr_StoreFormat);
+    CHECK(truncate(path, (off_t)100) == 0);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)10) == ExboErr_StoreFormat);
+    CHECK(exboStoreOpen((exboStore *)0, path, cp, (int64_t)10) == ExboErr_NoInstance);
+    CHECK(exboStoreRecord((exboStore)0, UINT64_C(0), (int64_t)0) == ExboErr_NoInstance);
+    CHECK(exboStoreGetCount((exboStore)0) < Exbo_MinimumTime);
+    CHECK(remove(path) == 0);
+    CHECK(exboStoreOpen(&stp, "/nonexistent/exbo.store", cp, (int64_t)10) == ExboErr_StoreIo);
+    exboConfigDestroy(other);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestBusy(void) {
+    // The file is locked while a store has it open.
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboStore stp;
+    exboStore second;
+    char path[32];
+    zTempPath(path);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)10) == 0);
+    CHECK(exboStoreRecord(stp, UINT64_C(1), (int64_t)0) == 0);
+    CHECK(exboStoreOpen(&second, path, cp, (int64_t)10) == ExboErr_StoreBusy);
+    CHECK(second == (exboStore)0);
+    CHECK(exboStoreClose(stp) == 0);
+    CHECK(exboStoreOpen(&second, path, cp, (int64_t)10) == 0);
+    CHECK(exboStoreFind(second, UINT64_C(1)) != (const exboState *)0);
+    CHECK(exboStoreClose(second) == 0);
+    CHECK(remove(path) == 0);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestChurn(void) {
+    // Removed records never keep a key out of a store below its limit,
+    // and a present key's state stays in place until a new key is
+    // recorded.
+    static const exboState *places[CHURN_KEYS];
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboStore stp;
+    const struct store *p;
+    char path[32];
+    int64_t count = (int64_t)0;
+    int64_t now = (int64_t)0;
+    int64_t reused = (int64_t)0;
+    int64_t compacted = (int64_t)0;
+    int step;
+    int k;
+    zTempPath(path);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)10) == 0);
+    p = (const struct store *)stp;
+    for (step = 0; step < CHURN_STEPS; step++) {
+        k = (int)(zRandom() % (uint64_t)CHURN_KEYS);
+        now += (int64_t)(zRandom() % UINT64_C(20));
+        if (zRandom() % UINT64_C(2) == UINT64_C(0)) {
+            CHECK(exboStoreRemove(stp, (uint64_t)k) == (places[k] != (const exboState *)0));
+            count -= (int64_t)(places[k] != (const exboState *)0);
+            places[k] = (const exboState *)0;
+        } else if (places[k] != (const exboState *)0) {
+            CHECK(exboStoreRecord(stp, (uint64_t)k, now) <= 0);
+            CHECK(exboStoreFind(stp, (uint64_t)k) == places[k]);
+        } else if (count < p->limit) {
+            int64_t removed = p->header->removed;
+            int i;
+            CHECK(exboStoreRecord(stp, (uint64_t)k, now) == 0);
+            compacted += (int64_t)(p->header->removed < removed - (int64_t)1);
+            reused += (int64_t)(p->header->removed == removed - (int64_t)1);
+            count++;
+            // Compacting may have moved any state.
+            for (i = 0; i < CHURN_KEYS; i++) {
+                if ((places[i] != (const exboState *)0) || (i == k)) {
+                    places[i] = exboStoreFind(stp, (uint64_t)i);
+                    CHECK(places[i] != (const exboState *)0);
+                }
+            }
+        } else {
+            CHECK(exboStoreRecord(stp, (uint64_t)k, now) == ExboErr_StoreFull);
+        }
+        CHECK(exboStoreGetCount(stp) == count);
+        CHECK(count + p->header->removed <= p->limit);
+    }
+    for (k = 0; k < CHURN_KEYS; k++) {
+        CHECK(exboStoreFind(stp, (uint64_t)k) == places[k]);
+    }
+    CHECK((reused > (int64_t)0) && (compacted > (int64_t)0));
+    CHECK(exboStoreClose(stp) == 0);
+    CHECK(remove(path) == 0);
+    exboConfigDestroy(cp);
+    return;
+}
+
+static void zTestStaleCopy(void) {
+    // A crash while compacting can leave a moved record's old copy; the
+    // first copy is the one used, and removing the key clears both.
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboStore stp;
+    struct store *p;
+    char path[32];
+    uint64_t a = UINT64_C(0);
+    uint64_t b;
+    uint64_t home;
+    zTempPath(path);
+    CHECK(exboStoreOpen(&stp, path, cp, (int64_t)10) == 0);
+    p = (struct store *)stp;
+    home = zHash64(a) & p->mask;
+    b = a + UINT64_C(1);
+    while ((zHash64(b) & p->mask) != home) {
+        b++;
+    }
+    CHECK(exboStoreRecord(stp, a, (int64_t)0) == 0);
+    CHECK(exboStoreRecord(stp, b, (int64_t)0) == 0);
+    CHECK(exboStoreRemove(stp, a) == 1);
+    CHECK(p->records[home].configId == Z_REMOVED);
+    // Move b back into the removed record, and crash before marking its
+    // old place removed.
+    p->records[home].key = b;
+    p->records[home].state = p->records[(home + UINT64_C(1)) & p->mask].state;
+    zSetConfigId(&p->records[home], p->configId);
+    CHECK(exboStoreFind(stp, b) == &p->records[home].state);
+    CHECK(exboStoreRecord(stp, b, (int64_t)500) <= 0);
+    CHECK(exboStateGetPreviousAttemptTime(exboStoreFind(stp, b)) == (int64_t)500);
+    CHECK(exboStoreRemove(stp, b) == 1);
+    CHECK(exboStoreFind(stp, b) == (const exboState *)0);
+    CHECK((exboStoreGetCount(stp) == (int64_t)0) && (p->header->removed == (int64_t)2));
+    CHECK(exboStoreClose(stp) == 0);
+    CHECK(remove(path) == 0);
+    exboConfigDestroy(cp);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
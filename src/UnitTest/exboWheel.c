@@ -0,0 +1,234 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The unit tests exercise the internal functions directly. */
+#include "../exboWheel.c"
+#include <stdio.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define CHECK(condition) zCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Entries in the model comparison */
+#define MODEL_ENTRIES 2000
+#define MODEL_STEPS 200000
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line);
+static uint64_t zRandom(void);
+static void zTestMatchesModel(void);
+static void zTestRecordAttempt(void);
+static void zTestLimits(void);
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static int zFailures = 0;
+static uint64_t zRandomState = UINT64_C(0x9e3779b97f4a7c15);
+
+/*********************************
+ * external function definitions
+ *********************************/
+int main(void) {
+    zTestMatchesModel();
+    zTestRecordAttempt();
+    zTestLimits();
+    if (zFailures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", zFailures);
+    }
+    return (zFailures == 0) ? 0 : 1;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static void zCheck(int condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        zFailures++;
+    }
+    return;
+}
+
+static uint64_t zRandom(void) {
+    // xorshift64*
+    zRandomState ^= zRandomState >> 12;
+    zRandomState ^= zRandomState << 25;
+    zRandomState ^= zRandomState >> 27;
+    return zRandomState * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+/* Every entry must come back at the first advance at or after its time,
+ * and no more than resolution - 1 after it.
+ */
+static void zTestMatchesModel(void) {
+    static exboWheelEntry entries[MODEL_ENTRIES];
+    static int64_t model[MODEL_ENTRIES];
+    static int scheduled[MODEL_ENTRIES];
+    static int seen[MODEL_ENTRIES];
+    const int64_t origin = (int64_t)-12345;
+    const int64_t resolution = (int64_t)7;
+    exboWheel wp = exboWheelCreate(origin, resolution);
+    int64_t now = origin;
+    int64_t count = (int64_t)0;
+    int step;
+    int k;
+    CHECK(wp != (exboWheel)0);
+    for (k = 0; k < MODEL_ENTRIES; k++) {
+        CHECK(exboWheelEntryInit(&entries[k]) == 0);
+    }
+    for (step = 0; step < MODEL_STEPS; step++) {
+        uint64_t choice = zRandom() % UINT64_C(8);
+        k = (int)(zRandom() % (uint64_t)MODEL_ENTRIES);
+        if (choice < UINT64_C(4)) {
+            // Schedule near, far, or in the past.
+            uint64_t scale = zRandom() % UINT64_C(4);
+            int64_t delay = (int64_t)(zRandom() % (UINT64_C(100) << (scale * UINT64_C(12))));
+            int64_t when = (choice == UINT64_C(0)) ? now - delay : now + delay;
+            CHECK(exboWheelSchedule(wp, &entries[k], when, &model[k]) == 0);
+            count += (int64_t)!scheduled[k];
+            model[k] = when;
+            scheduled[k] = 1;
+        } else if (choice == UINT64_C(4)) {
+            CHECK(exboWheelCancel(wp, &entries[k]) == scheduled[k]);
+            count -= (int64_t)scheduled[k];
+            scheduled[k] = 0;
+        } else {
+            // Advance by a small step, or occasionally by a large gap.
+            exboWheelEntry *ep;
+            int64_t gap = (zRandom() % UINT64_C(64) == UINT64_C(0)) ? (int64_t)(zRandom() % UINT64_C(100000000))
+                                                                     : (int64_t)(zRandom() % UINT64_C(30));
+            int64_t tick;
+            now += gap;
+            tick = origin + ((now - origin) / resolution) * resolution;
+            for (k = 0; k < MODEL_ENTRIES; k++) {
+                seen[k] = 0;
+            }
+            for (ep = exboWheelAdvance(wp, now); ep != (exboWheelEntry *)0; ep = exboWheelEntryGetNext(ep)) {
+                int64_t *whenp = (int64_t *)exboWheelEntryGetUserData(ep);
+                int j = (int)(whenp - model);
+                CHECK(scheduled[j]);
+                CHECK(exboWheelEntryGetTime(ep) == model[j]);
+                seen[j] = 1;
+            }
+            for (k = 0; k < MODEL_ENTRIES; k++) {
+                // Due entries come back; no entry comes back early.
+                if (scheduled[k]) {
+                    CHECK(seen[k] == (model[k] <= tick));
+                    if (seen[k]) {
+                        scheduled[k] = 0;
+                        count--;
+                    }
+                } else {
+                    CHECK(!seen[k]);
+                }
+            }
+        }
+        CHECK(exboWheelGetCount(wp) == count);
+    }
+    exboWheelDestroy(wp);
+    return;
+}
+
+static void zTestRecordAttempt(void) {
+    // The wheel hands back a backed-off instance once it is ready.
+    exbo xp = exboCreateConfigured(2.0, (int64_t)100, (int64_t)1000);
+    exboConfig cp = exboConfigCreate(2.0, (int64_t)100, (int64_t)1000);
+    exboState state;
+    exboWheel wp = exboWheelCreate((int64_t)0, (int64_t)10);
+    exboWheelEntry entry;
+    exboWheelEntry stateEntry;
+    exboWheelEntry *ep;
+    int64_t next;
+    int64_t wait;
+    CHECK(xp != (exbo)0);
+    CHECK(exboStateInit(&state) == 0);
+    CHECK(exboWheelEntryInit(&entry) == 0);
+    CHECK(exboWheelEntryInit(&stateEntry) == 0);
+    CHECK(exboWheelRecordAttempt(wp, &entry, xp, (int64_t)5) == 0);
+    CHECK(exboWheelStateRecordAttempt(wp, &stateEntry, cp, &state, (int64_t)5) == 0);
+    CHECK(exboWheelGetCount(wp) == (int64_t)2);
+    next = exboGetNextAttemptTime(xp);
+    CHECK(next == exboStateGetNextAttemptTime(&state));
+    CHECK(next > (int64_t)5);
+    CHECK(exboWheelAdvance(wp, next - (int64_t)1) == (exboWheelEntry *)0);
+    ep = exboWheelAdvance(wp, next + (int64_t)9);
+    CHECK(ep != (exboWheelEntry *)0);
+    CHECK(exboWheelEntryGetNext(exboWheelEntryGetNext(ep)) == (exboWheelEntry *)0);
+    CHECK(exboTryAttempt(xp, next + (int64_t)9, &wait) == 0);
+    CHECK(exboWheelRecordAttempt(wp, &entry, xp, (int64_t)1) == ExboErr_RecordingAPriorAttempt);
+    CHECK(exboWheelGetCount(wp) == (int64_t)0);
+    CHECK(exboWheelRecordAttempt(wp, &entry, xp, next + (int64_t)9) == ExboWarn_AttemptIsEarlierThanRecommended);
+    CHECK(exboWheelGetCount(wp) == (int64_t)1);
+    CHECK(exboWheelCancel(wp, &entry) == 1);
+    CHECK(exboWheelCancel(wp, &entry) == 0);
+    CHECK(exboWheelGetCount(wp) == (int64_t)0);
+    exboWheelDestroy(wp);
+    exboConfigDestroy(cp);
+    exboDestroy(xp);
+    return;
+}
+
+static void zTestLimits(void) {
+    exboWheel wp = exboWheelCreate(INT64_MIN, (int64_t)1);
+    exboWheelEntry first;
+    exboWheelEntry last;
+    exboWheelEntry *ep;
+    CHECK(exboWheelCreate((int64_t)0, (int64_t)0) == (exboWheel)0);
+    CHECK(wp != (exboWheel)0);
+    CHECK(exboWheelEntryInit((exboWheelEntry *)0) == ExboErr_NoInstance);
+    CHECK(exboWheelSchedule((exboWheel)0, &first, (int64_t)0, (void *)0) == ExboErr_NoInstance);
+    CHECK(exboWheelEntryGetTime((const exboWheelEntry *)0) < Exbo_MinimumTime);
+    CHECK(exboWheelGetCount((exboWheel)0) < Exbo_MinimumTime);
+    CHECK(exboWheelEntryInit(&first) == 0);
+    CHECK(exboWheelEntryInit(&last) == 0);
+    CHECK(exboWheelSchedule(wp, &first, INT64_MIN, (void *)&first) == 0);
+    CHECK(exboWheelSchedule(wp, &last, INT64_MAX, (void *)&last) == 0);
+    ep = exboWheelAdvance(wp, INT64_MIN);
+    CHECK(ep == &first);
+    CHECK(exboWheelEntryGetNext(ep) == (exboWheelEntry *)0);
+    CHECK(exboWheelAdvance(wp, INT64_MAX - (int64_t)1) == (exboWheelEntry *)0);
+    ep = exboWheelAdvance(wp, INT64_MAX);
+    CHECK(ep == &last);
+    CHECK(exboWheelEntryGetUserData(ep) == (void *)&last);
+    CHECK(exboWheelGetCount(wp) == (int64_t)0);
+    exboWheelDestroy(wp);
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
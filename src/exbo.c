@@ -34,8 +34,60 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <exbo.h>
+#include <exbo_inline.h>
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(EXBO_NO_SIMD)
+#include <immintrin.h>
+#define Z_BATCH_X86 1
+#else
+#define Z_BATCH_X86 0
+#endif
+
+/* How a 16-byte compare-and-swap is done: 1 inline cmpxchg16b, 2 the
+ * generic GCC builtin (which may call libatomic), 0 not at all.
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__SIZEOF_INT128__)
+#define Z_ATOMIC 1
+#elif defined(__GNUC__)
+#define Z_ATOMIC 2
+#else
+#define Z_ATOMIC 0
+#endif
+
+/* Instances and configs come from a pool of blocks on per-thread free
+ * lists, unless built with -DEXBO_NO_POOL.
+ */
+#if defined(__GNUC__) && !defined(EXBO_NO_POOL)
+#include <pthread.h>
+#define Z_POOL 1
+#else
+#define Z_POOL 0
+#endif
+
+/* Allocations and exboSetAllocator() are serialized by a mutex in a GNU C
+ * build; otherwise the process is taken to have one thread.
+ */
+#if defined(__GNUC__)
+#include <pthread.h>
+#define Z_ALLOCATOR_LOCK 1
+#else
+#define Z_ALLOCATOR_LOCK 0
+#endif
+
+/* Hot-path statistics are counted only in a build with -DEXBO_STATS=1;
+ * otherwise counting compiles to nothing.
+ */
+#ifndef EXBO_STATS
+#define EXBO_STATS 0
+#endif
+#if EXBO_STATS
+#include <pthread.h>
+#define Z_STATS(result, warning, D, I) zStatsCount((result), (warning), (D), (I))
+#else
+#define Z_STATS(result, warning, D, I) ((void)0)
+#endif
 
 /*********************************
  * internal macro declarations
@@ -47,6 +99,45 @@
 #define DEFAULT_A ((int64_t)(60 * ONE_SECOND))
 #define DEFAULT_L_OVER_A ((int64_t)6)
 
+/* The engine of a config that does not choose one */
+#ifndef EXBO_DEFAULT_ENGINE
+#define EXBO_DEFAULT_ENGINE ExboEngine_Double
+#endif
+
+/* Solver Tuning */
+#define Z_J_NEWTON_SPAN ((int64_t)16)    // wider brackets are narrowed by Newton's method
+#define Z_J_NEWTON_STEPS 64
+
+/* Pool Tuning */
+#define Z_BLOCK_SIZE ((size_t)128)  // holds an instance or a config, on two cache lines
+#define Z_SLAB_BLOCKS ((size_t)64)  // blocks carved from each slab
+
+/* Bytes of an interval table of n entries, two doubles each */
+#define Z_TABLE_BYTES(n) (sizeof(struct table) + (size_t)(n) * (size_t)2 * sizeof(double))
+
+/* The bit pattern of (double)1.0 */
+#define Z_BITS_OF_ONE UINT64_C(0x3ff0000000000000)
+
+/* Exponents below this flush a fixed value to zero */
+#define Z_FIXED_MINIMUM_EXPONENT (-((int64_t)1 << 40))
+
+/* Snapshot layout: the magic and version, then little-endian fields */
+#define Z_SNAPSHOT_MAGIC UINT32_C(0x00627865)     // "exb"
+#define Z_SNAPSHOT_VERSION UINT32_C(3)
+#define Z_SNAPSHOT_FLAGS_KNOWN UINT32_C(0x000001ff)
+#define Z_SNAPSHOT_VERSION_AT 4
+#define Z_SNAPSHOT_FLAGS 8
+#define Z_SNAPSHOT_TABLE_SIZE 12
+#define Z_SNAPSHOT_X 16
+#define Z_SNAPSHOT_A 24
+#define Z_SNAPSHOT_L 32
+#define Z_SNAPSHOT_T 40
+#define Z_SNAPSHOT_D 48
+#define Z_SNAPSHOT_I 56
+#define Z_SNAPSHOT_SEED 64
+#define Z_SNAPSHOT_RESERVED 72
+#define Z_SNAPSHOT_CHECKSUM 76
+
 /* Internal Error Code Constants */
 #define NanTag_ExboErr_NoInstance        "1"
 #define NanTag_ExboErr_NoConfig          "2"
@@ -58,23 +149,113 @@
  * typedef and enum declarations
  *********************************/
 struct config {
-    int isFinished;
-    int isValid;
-    int has_X;
-    int has_A;
-    int has_L;
+    unsigned int isFinished : 1;
+    unsigned int isValid : 1;
+    unsigned int has_X : 1;
+    unsigned int has_A : 1;
+    unsigned int has_L : 1;
+    unsigned int engine : 1;
+    unsigned int jitter : 2;
+    unsigned int hasSeed : 1;
     double X;
     int64_t A;
     int64_t L;
+    struct table *table;
+    uint64_t seed;          // last, past the first cache line of an instance: only jitter reads it
 };
 
-struct instance {
+/* A table of m(J) and of (X - 1)/(X^J - 1) for J in [0, size), built by
+ * zConfigFinish().  For a given J the interval is linear in L - D, so
+ * these are all zInterval() needs once J is known.
+ */
+struct table {
+    int64_t size;
+    int64_t last;   // the greatest J tabulated, 0 if none is
+    double c;       // 1/(X - 1)
+    double values[];    // m(J) at values[J], the factor at values[size + J]
+};
+
+/* An unsigned value m * 2^e, where m is zero or has its top bit set.
+ * The integer engine does all of its arithmetic in this form.
+ */
+struct fixed {
+    uint64_t m;
+    int64_t e;
+};
+
+struct state {
     int64_t T;
     int64_t D;
     int64_t I;
-    struct config *config;
 };
 
+/* The part of a state that is swapped atomically */
+struct atomicState {
+    int64_t T;
+    int64_t D;
+};
+
+#if Z_ATOMIC == 1
+__extension__ typedef unsigned __int128 zAtomicWord;
+#endif
+
+/* The config is held inline so that an instance, together with its
+ * configuration, fits in the caller-provided exboStorage.
+ */
+struct instance {
+    struct state state;
+    struct config config;
+    exboStats *stats;   // the caller's sink, if any, set by exboSetStatsSink()
+};
+
+/* A free block of the pool */
+struct block {
+    struct block *next;
+};
+
+/* The hooks that memory comes from, set together by exboSetAllocator() */
+struct allocator {
+    exboAllocateFunction allocate;
+    exboFreeFunction release;
+    void *context;
+};
+
+#if EXBO_STATS
+/* The counts of one thread.  A block is claimed by one thread at a time
+ * and never freed, so its counts outlive the thread.
+ */
+struct statsBlock {
+    struct statsBlock *next;   // the block claimed before it
+    int inUse;                 // 1 while a thread counts in it
+    exboStats stats;           // written only by that thread
+};
+#endif
+
+/* Compile-time check that an instance fits in an exboStorage */
+typedef char zInstanceFitsInStorage[(sizeof(struct instance) <= sizeof(exboStorage)) ? 1 : -1];
+
+/* Compile-time check that instances and configs fit in pool blocks */
+typedef char zInstanceFitsInBlock[(sizeof(struct instance) <= Z_BLOCK_SIZE) ? 1 : -1];
+typedef char zConfigFitsInBlock[(sizeof(struct config) <= Z_BLOCK_SIZE) ? 1 : -1];
+
+/* Compile-time check that a state fits in an exboState */
+typedef char zStateFitsInExboState[(sizeof(struct state) <= sizeof(exboState)) ? 1 : -1];
+
+/* Compile-time checks that a state, at the start of an instance, has the
+ * layout that exbo_inline.h reads
+ */
+typedef char zStateIsLayout[(sizeof(struct state) == sizeof(exboStateLayout)) ? 1 : -1];
+typedef char zStateLayoutT[(offsetof(struct state, T) == offsetof(exboStateLayout, T)) ? 1 : -1];
+typedef char zStateLayoutD[(offsetof(struct state, D) == offsetof(exboStateLayout, D)) ? 1 : -1];
+typedef char zStateLayoutI[(offsetof(struct state, I) == offsetof(exboStateLayout, I)) ? 1 : -1];
+typedef char zInstanceStartsWithState[(offsetof(struct instance, state) == 0) ? 1 : -1];
+
+/* Compile-time check that an atomic state is an exboAtomicState */
+typedef char zAtomicStateIsExboAtomicState[(sizeof(struct atomicState) == sizeof(exboAtomicState)) ? 1 : -1];
+
+/* Compile-time check that the snapshot fields fill Exbo_SnapshotSize */
+typedef char zSnapshotIsFull[(Z_SNAPSHOT_CHECKSUM + 4 == Exbo_SnapshotSize) ? 1 : -1];
+
 /*********************************
  * internal data declarations
  *********************************/
@@ -82,11 +263,77 @@ struct instance {
 /*********************************
  * internal function declarations
  *********************************/
+static void *zAllocate(size_t size);
+static void zFree(void *p, size_t size);
+static void zHeldAdd(int64_t delta);
+static void *zDefaultAllocate(size_t size, void *context);
+static void zDefaultFree(void *p, size_t size, void *context);
+static void *zBlockGet(void);
+static void zBlockPut(void *p);
+#if Z_POOL
+static struct block *zPoolRefill(void);
+static void zPoolRegister(void);
+static void zPoolCreateKey(void);
+static void zPoolRelease(void *unused);
+#endif
 static struct instance *zInstanceCreate(void);
 static void zInstanceDestroy(struct instance *p);
-static struct config *zConfigCreate(void);
-static void zConfigDestroy(struct config *p);
+static void zInstanceInit(struct instance *p);
+static void zInstanceFini(struct instance *p);
+static int zInstanceConfigure(struct instance *p, double X, int64_t A, int64_t L);
+static void zStateInit(struct state *p);
+static int zStateRecordAttempt(struct state *p, const struct config *config, int64_t time, uint64_t stream);
+static int zStateRecordAttemptWarning(struct state *p, const struct config *config, int64_t time, int *warningp);
+static int zStateRecordCost(struct state *p, const struct config *config, int64_t time, int64_t cost,
+                            int *warningp);
+static int zStateRecordJittered(struct state *p, const struct config *config, int64_t time, int64_t cost,
+                                uint64_t stream, int *warningp);
+static uint64_t zInstanceStream(const struct instance *p);
+static void zJitter(struct state *p, const struct config *config, uint64_t stream, int64_t I_in);
+static uint64_t zMix(uint64_t z);
+static int zStateInterval(const struct config *config, int64_t D, int64_t *Ip);
+static int zStateTryAttempt(struct state *p, const struct config *config, int64_t now, uint64_t stream, int64_t *waitp,
+                            int *warningp);
+static int zReady(int64_t next, int64_t now, int64_t *waitp);
+static int64_t zStateGetPreviousAttemptTime(const struct state *p);
+static int64_t zStateGetNextAttemptTime(const struct state *p);
+static int64_t zStateGetPayBackTime(const struct state *p);
+static void zBatchScalar(const struct config *config, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                         const int64_t *time, int *results);
+static int zBatchElement(const struct config *config, int64_t *T, int64_t *D, int64_t *I, int64_t time);
+#if Z_BATCH_X86
+static void zBatchAvx2(const struct config *config, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                       const int64_t *time, int *results);
+static void zBatchAvx512(const struct config *config, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                         const int64_t *time, int *results);
+#endif
+static int zAtomicRecordAttempt(struct atomicState *p, const struct config *config, int64_t time, int64_t *waitp,
+                                int *warningp);
+static int zAtomicLoad(struct atomicState *p, const struct config *config, struct state *statep);
+static int zAtomicCompareExchange(struct atomicState *p, struct state *expectedp, const struct state *desiredp);
+static void zSnapshotWrite(const struct instance *p, unsigned char *bytes);
+static int zSnapshotRead(struct instance *p, const unsigned char *bytes);
+static int zSnapshotPlausible(const struct config *config, int64_t D, int64_t I);
+static uint32_t zChecksum(const unsigned char *bytes, size_t length);
+static void zPut32(unsigned char *bytes, uint32_t value);
+static void zPut64(unsigned char *bytes, uint64_t value);
+static uint32_t zGet32(const unsigned char *bytes);
+static uint64_t zGet64(const unsigned char *bytes);
+static void zInstanceCount(const struct instance *p, int result, int warning);
+static void zStatsCountInto(exboStats *sp, int result, int warning, int64_t D, int64_t I);
+static void zStatsAdd(int64_t *counter);
+static int zStatsBucket(int64_t value);
+#if EXBO_STATS
+static void zStatsCount(int result, int warning, int64_t D, int64_t I);
+static struct statsBlock *zStatsClaim(void);
+static void zStatsCreateKey(void);
+static void zStatsRelease(void *block);
+static void zStatsMerge(exboStats *sp, const exboStats *from);
+#endif
+static struct config *zConfigCreate(double X, int64_t A, int64_t L, int64_t tableSize);
 static void zConfigInit(struct config *p);
+static void zConfigFini(struct config *p);
+static int zConfigSetTableSize(struct config *p, int64_t tableSize);
 static int zConfigValidate(struct config *p);
 static int zConfigRevalidate(struct config *p);
 static int zConfigValidate_X(struct config *p);
@@ -98,8 +345,29 @@ static int zSetDefault_X(struct config *p);
 static int zSetDefault_A(struct config *p);
 static int zSetDefault_L(struct config *p);
 static int zValidateFinish(struct config *p);
+static int zTableBuild(struct config *p);
 static int zInterval(int64_t L, int64_t A, double X, int64_t D, int64_t *Ip);
-static int z_J(double l, double X, double *jp);
+static int zIntervalReal(double excess, int64_t A, double X, double *vp);
+static int zIntervalTabulated(const struct table *table, int64_t L, int64_t A, double X, int64_t D, int64_t *Ip);
+static int zIntervalInteger(int64_t L, int64_t A, const double *Xp, int64_t D, int64_t *Ip);
+static int z_mInteger(int64_t J, int64_t excess, int64_t A, const struct fixed *dp, const struct fixed *ep,
+                      int *vp);
+static void zMul64(uint64_t a, uint64_t b, uint64_t *hip, uint64_t *lop);
+static uint64_t zDiv128(uint64_t hi, uint64_t lo, uint64_t d);
+static int zLeadingZeros(uint64_t x);
+static void zFixedNormalize(uint64_t hi, uint64_t lo, int64_t e, struct fixed *rp);
+static void zFixedFromDouble(const double *xp, struct fixed *rp);
+static void zFixedMul(const struct fixed *ap, const struct fixed *bp, struct fixed *rp);
+static void zFixedDiv(const struct fixed *ap, const struct fixed *bp, struct fixed *rp);
+static void zFixedAdd(const struct fixed *ap, const struct fixed *bp, struct fixed *rp);
+static void zFixedMinusOne(const struct fixed *ap, struct fixed *rp);
+static void zFixedPowMinusOne(const struct fixed *dp, int64_t n, struct fixed *rp);
+static void zFixedCompound(const struct fixed *ap, const struct fixed *bp, struct fixed *rp);
+static void zFixedSquareCompound(const struct fixed *ap, struct fixed *rp);
+static int zFixedCompare(const struct fixed *ap, const struct fixed *bp);
+static int64_t zFixedCeil(const struct fixed *ap);
+static int z_J(double l, double X, double *Jp);
+static int z_jRoot(double l, double X, double *jp);
 static int z_m(double j, double x, double *vp);
 
 /*********************************
@@ -112,6 +380,12 @@ static int z_m(double j, double x, double *vp);
 static const char *zErrMessageNotError = "Exbo_MinimumTime (== INT64_MIN + 64) and above are valid times";
 static const char *zErrMessageNegative = "Negative error number is undefined";
 static const char *zErrMessageMaximum = "ExboErr_MAXIMUM (==64) and above are undefined errors";
+static const char *zWarnMessages[ExboWarn_COUNT] = {
+    "No Error",
+    "This attempt is earlier than was recommended",                       // ExboWarn_AttemptIsEarlierThanRecommended       (-1)
+    "Excess cost limit breach",                                           // ExboWarn_ExcessCostLimitBreach                 (-2)
+    "Excess cost limit breach with debt accumulator overflow"             // ExboWarn_ExcessCostLimitBreachWithDebtOverflow (-3)
+};
 static const char *zErrMessages[ExboErr_MAXIMUM] = {
     "No Error",
     "No instance was provided",                                   // ExboErr_NoInstance               (1)
@@ -130,31 +404,31 @@ static const char *zErrMessages[ExboErr_MAXIMUM] = {
     "BUG: the finished config is not marked as finished",         // ExboErr_InternalError_1         (14)
     "BUG: the finished config has missing parts",                 // ExboErr_InternalError_2         (15)
     "BUG: the finished config is invalid",                        // ExboErr_InternalError_3         (16)
-    "Error 17 is undefined",
-    "Error 18 is undefined",
-    "Error 19 is undefined",
-    "Error 20 is undefined",
-    "Error 21 is undefined",
-    "Error 22 is undefined",
-    "Error 23 is undefined",
-    "Error 24 is undefined",
-    "Error 25 is undefined",
-    "Error 26 is undefined",
-    "Error 27 is undefined",
-    "Error 28 is undefined",
-    "Error 29 is undefined",
-    "Error 30 is undefined",
-    "Error 31 is undefined",
-    "Error 32 is undefined",
-    "Error 33 is undefined",
-    "Error 34 is undefined",
-    "Error 35 is undefined",
-    "Error 36 is undefined",
-    "Error 37 is undefined",
-    "Error 38 is undefined",
-    "Error 39 is undefined",
-    "Error 40 is undefined",
-    "Error 41 is undefined",
+    "The given table size is out of range",                       // ExboErr_InvalidConfig_T1        (17)
+    "Memory could not be allocated",                              // ExboErr_OutOfMemory             (18)
+    "The given engine is undefined",                              // ExboErr_InvalidConfig_E1        (19)
+    "The registry is full",                                       // ExboErr_RegistryFull            (20)
+    "The key is not of the registry's key type",                  // ExboErr_RegistryKeyType         (21)
+    "The given key is too long",                                  // ExboErr_RegistryKeyTooLong      (22)
+    "Atomic recording is not supported by this build",            // ExboErr_AtomicUnsupported       (23)
+    "The next attempt time has not been reached",                 // ExboErr_AttemptNotReady         (24)
+    "The store file could not be opened, sized or mapped",        // ExboErr_StoreIo                 (25)
+    "The store file is not a store of this version",              // ExboErr_StoreFormat             (26)
+    "The store file was created with a different configuration",  // ExboErr_StoreConfigMismatch     (27)
+    "The store is full",                                          // ExboErr_StoreFull               (28)
+    "The buffer is too small for the snapshot",                   // ExboErr_SnapshotTooSmall        (29)
+    "The snapshot is of another version or is corrupt",           // ExboErr_SnapshotCorrupt         (30)
+    "Statistics are not compiled into this build",                // ExboErr_StatsDisabled           (31)
+    "Memory is still held from the current allocator",            // ExboErr_AllocatorInUse          (32)
+    "Only one of the allocator functions was given",              // ExboErr_AllocatorIncomplete     (33)
+    "More levels were given than Exbo_MaximumLevels",             // ExboErr_TooManyLevels           (34)
+    "The given cost is not positive",                             // ExboErr_InvalidCost             (35)
+    "The given clock source is not defined",                      // ExboErr_InvalidClockSource      (36)
+    "The given clock units per second are out of range",          // ExboErr_InvalidClockUnits       (37)
+    "The clock source is not supported on this machine",          // ExboErr_ClockUnsupported        (38)
+    "The given time is less than Exbo_MinimumTime",               // ExboErr_InvalidClockTime        (39)
+    "The given jitter mode is undefined",                         // ExboErr_InvalidConfig_J1        (40)
+    "The store file is already open",                             // ExboErr_StoreBusy               (41)
     "Error 42 is undefined",
     "Error 43 is undefined",
     "Error 44 is undefined",
@@ -178,10 +452,65 @@ static const char *zErrMessages[ExboErr_MAXIMUM] = {
     "Error 62 is undefined",
     "Error 63 is undefined"
 };
+static struct allocator zAllocator = {zDefaultAllocate, zDefaultFree, (void *)0};
+static int64_t zAllocatorHeld = (int64_t)0;   // allocations not yet freed, slabs included
+#if Z_ALLOCATOR_LOCK
+static pthread_mutex_t zAllocatorMutex = PTHREAD_MUTEX_INITIALIZER;   // guards zAllocator and counting up zAllocatorHeld
+#endif
+#if Z_POOL
+static __thread struct block *zPoolFree = (struct block *)0;   // the free blocks of this thread
+static __thread int zPoolHasThread = 0;                         // the key is set for this thread
+static struct block *zPoolShared = (struct block *)0;          // the free blocks of exited threads
+static pthread_once_t zPoolOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t zPoolKey;   // hands the blocks of an exiting thread to zPoolShared
+static int zPoolHasKey = 0;
+#endif
+#if EXBO_STATS
+static struct statsBlock *zStatsBlocks = (struct statsBlock *)0;       // every block, newest first
+static __thread struct statsBlock *zStatsMine = (struct statsBlock *)0;  // the block of this thread
+static pthread_once_t zStatsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t zStatsKey;   // releases the block of an exiting thread
+static int zStatsHasKey = 0;
+#endif
 
 /*********************************
  * external function definitions
  *********************************/
+int exboSetAllocator(exboAllocateFunction allocate, exboFreeFunction release, void *context) {
+    int result;
+    if ((allocate == (exboAllocateFunction)0) == (release == (exboFreeFunction)0)) {
+        int64_t held;
+#if Z_ALLOCATOR_LOCK
+        (void)pthread_mutex_lock(&zAllocatorMutex);
+        held = __atomic_load_n(&zAllocatorHeld, __ATOMIC_ACQUIRE);
+#else
+        held = zAllocatorHeld;
+#endif
+        // An allocation counts itself under the mutex before it reads the
+        // hooks, so none can be made with the old hooks once this passes.
+        if (held == (int64_t)0) {
+            if (allocate != (exboAllocateFunction)0) {
+                zAllocator.allocate = allocate;
+                zAllocator.release = release;
+                zAllocator.context = context;
+            } else {
+                zAllocator.allocate = zDefaultAllocate;
+                zAllocator.release = zDefaultFree;
+                zAllocator.context = (void *)0;
+            }
+            result = 0;
+        } else {
+            result = ExboErr_AllocatorInUse;
+        }
+#if Z_ALLOCATOR_LOCK
+        (void)pthread_mutex_unlock(&zAllocatorMutex);
+#endif
+    } else {
+        result = ExboErr_AllocatorIncomplete;
+    }
+    return result;
+}
+
 exbo exboCreate(void) {
     return (exbo)zInstanceCreate();
 }
@@ -190,25 +519,11 @@ exbo exboCreateConfigured(double X, int64_t A, int64_t L) {
     exbo result;
     struct instance *p = zInstanceCreate();
     if (p != (struct instance *)0) {
-        if (!exboConfigure_X((exbo)p, X)) {
-            if (!exboConfigure_A((exbo)p, A)) {
-                if (!exboConfigure_L((exbo)p, L)) {
-                    if (!exboFinishConfig((exbo)p)) {
-                        result = (exbo)p;
-                    } else {
-                        result = (exbo)0;
-                    }
-                } else {
-                    result = (exbo)0;
-                }
-            } else {
-                result = (exbo)0;
-            }
+        if (!zInstanceConfigure(p, X, A, L)) {
+            result = (exbo)p;
         } else {
-            result = (exbo)0;
-        }
-        if (result == (exbo)0) {
             zInstanceDestroy(p);
+            result = (exbo)0;
         }
     } else {
         result = (exbo)0;
@@ -221,17 +536,48 @@ void exboDestroy(exbo xp) {
     return;
 }
 
+exbo exboInit(exboStorage *storage) {
+    exbo result;
+    if (storage != (exboStorage *)0) {
+        struct instance *p = (struct instance *)(void *)storage;
+        zInstanceInit(p);
+        result = (exbo)p;
+    } else {
+        result = (exbo)0;
+    }
+    return result;
+}
+
+exbo exboInitConfigured(exboStorage *storage, double X, int64_t A, int64_t L) {
+    exbo result;
+    if (storage != (exboStorage *)0) {
+        struct instance *p = (struct instance *)(void *)storage;
+        zInstanceInit(p);
+        if (!zInstanceConfigure(p, X, A, L)) {
+            result = (exbo)p;
+        } else {
+            zInstanceFini(p);
+            result = (exbo)0;
+        }
+    } else {
+        result = (exbo)0;
+    }
+    return result;
+}
+
+void exboFini(exbo xp) {
+    if (xp != (exbo)0) {
+        zInstanceFini((struct instance *)xp);
+    }
+    return;
+}
+
 int exboClearConfig(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            zConfigInit(config);
-            result = 0;
-        } else {
-            // There is no instance structure
-            result = ExboErr_NoConfig;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        zConfigFini(config);
+        result = 0;
     } else {
         // There is no instance structure
         result = ExboErr_NoInstance;
@@ -242,17 +588,12 @@ int exboClearConfig(exbo xp) {
 int exboConfigure_X(exbo xp, double X) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            config->isFinished = 0;
-            config->isValid = 0;
-            config->has_X = 1;
-            config->X = X;
-            result = 0;
-        } else {
-            // There is no instance structure
-            result = ExboErr_NoConfig;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        config->isFinished = 0;
+        config->isValid = 0;
+        config->has_X = 1;
+        config->X = X;
+        result = 0;
     } else {
         // There is no instance structure
         result = ExboErr_NoInstance;
@@ -263,16 +604,60 @@ int exboConfigure_X(exbo xp, double X) {
 int exboConfigure_A(exbo xp, int64_t A) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
+        struct config *config = &((struct instance *)xp)->config;
+        config->isFinished = 0;
+        config->isValid = 0;
+        config->has_A = 1;
+        config->A = A;
+        result = 0;
+    } else {
+        // There is no instance structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboConfigure_L(exbo xp, int64_t L) {
+    int result;
+    if (xp != (exbo)0) {
+        struct config *config = &((struct instance *)xp)->config;
+        config->isFinished = 0;
+        config->isValid = 0;
+        config->has_L = 1;
+        config->L = L;
+        result = 0;
+    } else {
+        // There is no instance structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboConfigure_TableSize(exbo xp, int64_t tableSize) {
+    int result;
+    if (xp != (exbo)0) {
+        struct config *config = &((struct instance *)xp)->config;
+        config->isFinished = 0;
+        config->isValid = 0;
+        result = zConfigSetTableSize(config, tableSize);
+    } else {
+        // There is no instance structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboConfigure_Engine(exbo xp, int engine) {
+    int result;
+    if (xp != (exbo)0) {
+        if ((engine == ExboEngine_Double) || (engine == ExboEngine_Integer)) {
+            struct config *config = &((struct instance *)xp)->config;
             config->isFinished = 0;
             config->isValid = 0;
-            config->has_A = 1;
-            config->A = A;
+            config->engine = (unsigned int)engine & 1u;
             result = 0;
         } else {
-            // There is no instance structure
-            result = ExboErr_NoConfig;
+            result = ExboErr_InvalidConfig_E1;
         }
     } else {
         // There is no instance structure
@@ -281,19 +666,17 @@ int exboConfigure_A(exbo xp, int64_t A) {
     return result;
 }
 
-int exboConfigure_L(exbo xp, int64_t L) {
+int exboConfigure_Jitter(exbo xp, int jitter) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
+        if ((jitter >= ExboJitter_None) && (jitter <= ExboJitter_Decorrelated)) {
+            struct config *config = &((struct instance *)xp)->config;
             config->isFinished = 0;
             config->isValid = 0;
-            config->has_L = 1;
-            config->L = L;
+            config->jitter = (unsigned int)jitter & 3u;
             result = 0;
         } else {
-            // There is no instance structure
-            result = ExboErr_NoConfig;
+            result = ExboErr_InvalidConfig_J1;
         }
     } else {
         // There is no instance structure
@@ -302,19 +685,30 @@ int exboConfigure_L(exbo xp, int64_t L) {
     return result;
 }
 
+int exboConfigure_JitterSeed(exbo xp, uint64_t seed) {
+    int result;
+    if (xp != (exbo)0) {
+        struct config *config = &((struct instance *)xp)->config;
+        config->isFinished = 0;
+        config->isValid = 0;
+        config->hasSeed = 1;
+        config->seed = seed;
+        result = 0;
+    } else {
+        // There is no instance structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
 int exboValidateConfig(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            if (config->isFinished == 0) {
-                result = zConfigValidate(config);
-            } else {
-                result = 0; // finished implies validated
-            }
+        struct config *config = &((struct instance *)xp)->config;
+        if (config->isFinished == 0) {
+            result = zConfigValidate(config);
         } else {
-            // There is no instance structure
-            result = ExboErr_NoConfig;
+            result = 0; // finished implies validated
         }
     } else {
         // There is no instance structure
@@ -326,13 +720,8 @@ int exboValidateConfig(exbo xp) {
 int exboFinishConfig(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            result = zConfigFinish(config);
-        } else {
-            // There is no instance structure
-            result = ExboErr_NoConfig;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        result = zConfigFinish(config);
     } else {
         // There is no instance structure
         result = ExboErr_NoInstance;
@@ -343,12 +732,8 @@ int exboFinishConfig(exbo xp) {
 int exboIsConfigFinished(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            result = config->isFinished;
-        } else {
-            result = 0;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        result = config->isFinished;
     } else {
         result = 0;
     }
@@ -358,12 +743,8 @@ int exboIsConfigFinished(exbo xp) {
 int exboIsConfigValidated(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            result = config->isValid;
-        } else {
-            result = 0;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        result = config->isValid;
     } else {
         result = 0;
     }
@@ -373,12 +754,8 @@ int exboIsConfigValidated(exbo xp) {
 int exboDoesConfigHave_X(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            result = config->has_X;
-        } else {
-            result = 0;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        result = config->has_X;
     } else {
         result = 0;
     }
@@ -388,12 +765,8 @@ int exboDoesConfigHave_X(exbo xp) {
 int exboDoesConfigHave_A(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            result = config->has_A;
-        } else {
-            result = 0;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        result = config->has_A;
     } else {
         result = 0;
     }
@@ -403,12 +776,8 @@ int exboDoesConfigHave_A(exbo xp) {
 int exboDoesConfigHave_L(exbo xp) {
     int result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            result = config->has_L;
-        } else {
-            result = 0;
-        }
+        struct config *config = &((struct instance *)xp)->config;
+        result = config->has_L;
     } else {
         result = 0;
     }
@@ -418,15 +787,11 @@ int exboDoesConfigHave_L(exbo xp) {
 double exboGetConfig_X(exbo xp) {
     double result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            if (config->has_X) {
-                result = config->X;
-            } else {
-                result = nan(NanTag_ExboErr_ConfigValueNotSet);
-            }
+        struct config *config = &((struct instance *)xp)->config;
+        if (config->has_X) {
+            result = config->X;
         } else {
-            result = nan(NanTag_ExboErr_NoConfig);
+            result = nan(NanTag_ExboErr_ConfigValueNotSet);
         }
     } else {
         result = nan(NanTag_ExboErr_NoInstance);
@@ -437,15 +802,11 @@ double exboGetConfig_X(exbo xp) {
 int64_t exboGetConfig_A(exbo xp) {
     int64_t result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            if (config->has_A) {
-                result = config->A;
-            } else {
-                result = INT64_MIN + ExboErr_ConfigValueNotSet;
-            }
+        struct config *config = &((struct instance *)xp)->config;
+        if (config->has_A) {
+            result = config->A;
         } else {
-            result = INT64_MIN + ExboErr_NoConfig;
+            result = INT64_MIN + ExboErr_ConfigValueNotSet;
         }
     } else {
         result = INT64_MIN + ExboErr_NoInstance;
@@ -456,15 +817,48 @@ int64_t exboGetConfig_A(exbo xp) {
 int64_t exboGetConfig_L(exbo xp) {
     int64_t result;
     if (xp != (exbo)0) {
-        struct config *config = ((struct instance *)xp)->config;
-        if (config != (struct config *)0) {
-            if (config->has_L) {
-                result = config->L;
-            } else {
-                result = INT64_MIN + ExboErr_ConfigValueNotSet;
-            }
+        struct config *config = &((struct instance *)xp)->config;
+        if (config->has_L) {
+            result = config->L;
         } else {
-            result = INT64_MIN + ExboErr_NoConfig;
+            result = INT64_MIN + ExboErr_ConfigValueNotSet;
+        }
+    } else {
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboGetConfig_Engine(exbo xp) {
+    int result;
+    if (xp != (exbo)0) {
+        result = (int)((struct instance *)xp)->config.engine;
+    } else {
+        result = -ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboGetConfig_Jitter(exbo xp) {
+    int result;
+    if (xp != (exbo)0) {
+        result = (int)((struct instance *)xp)->config.jitter;
+    } else {
+        result = -ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int64_t exboGetTableErrorBound(exbo xp) {
+    int64_t result;
+    if (xp != (exbo)0) {
+        struct config *config = &((struct instance *)xp)->config;
+        if ((config->table != (struct table *)0) && config->isFinished
+                && (config->engine == ExboEngine_Double)) {
+            // The table reproduces zInterval() exactly.
+            result = (int64_t)0;
+        } else {
+            result = INT64_MIN + ExboErr_ConfigValueNotSet;
         }
     } else {
         result = INT64_MIN + ExboErr_NoInstance;
@@ -476,86 +870,15 @@ int exboRecordAttempt(exbo xp, int64_t time) {
     int result;
     if (xp != (exbo)0) {
         struct instance *p = (struct instance *)xp;
-        struct config *config = p->config;
-        if (config != (struct config *)0) {
-            int r;
-            if ((r = zConfigFinish(config)) <= 0) {
-                int warning = 0;
-                if (r < 0) {
-                    // Accumulate the warning
-                    warning = r;
-                }
-                int64_t T_in = p->T;
-                int64_t T_out = time;
-                if (T_out >= T_in) {
-                    int64_t D_in = p->D;
-                    int64_t I_in = p->I;
-                    int64_t T_diff = T_out - T_in;
-                    int64_t D_prime;
-                    if (T_diff >= (int64_t)0) {
-                        // T_diff did not overflow
-                        if (T_diff < I_in) {
-                            // The user is being too aggressive.
-                            // Accumulate the warning
-                            // This warning overrides any previous warning.
-                            warning = ExboWarn_AttemptIsEarlierThanRecommended;
-                        }
-                        if (T_diff < D_in) {
-                            D_prime = D_in - T_diff;
-                        } else {
-                            D_prime = (int64_t)0;
-                        }
-                    } else {
-                        // T_diff overflowed - no warning is needed
-                        D_prime = (int64_t)0;
-                    }
-                    int64_t L = config->L;
-                    int64_t A = config->A;
-                    double X = config->X;
-                    int64_t D_out = D_prime + A;
-                    int64_t I_out;
-                    if (D_out >= A) {
-                        // D_out did not overflow
-                        if ((r = zInterval(L, A, X, D_out, &I_out)) <= 0) {
-                            if (r < 0) {
-                                // Accumulate the warning
-                                // This warning overrides any previous warning.
-                                warning = r;
-                            }
-                            result = 0;
-                        } else {
-                            // Report the error from zInterval().
-                            result = r;
-                        }
-                    } else {
-                        // D_out overflowed
-                        D_out = INT64_MAX;
-                        I_out = D_out - (L - A);
-                        // Accumulate the warning
-                        warning = ExboWarn_ExcessCostLimitBreachWithDebtOverflow;
-                        result = 0;
-                    }
-                    if (result == 0) {
-                        // There is no error so update the state
-                        p->T = T_out;
-                        p->I = I_out;
-                        p->D = D_out;
-                        if (warning == 0) {
-                            // record any warning that accumulated
-                            result = warning;
-                        }
-                    }
-                } else {
-                    // The attempts are being recorded out of order
-                    result = ExboErr_RecordingAPriorAttempt;
-                }
-            } else {
-                // Report the error from zConfigFinish()
-                result = r;
-            }
+        struct config *config = &p->config;
+        int r;
+        if ((r = zConfigFinish(config)) <= 0) {
+            result = zStateRecordAttempt(&p->state, config, time, zInstanceStream(p));
+            // The result is an error or else the warning.
+            zInstanceCount(p, (result > 0) ? result : 0, (result < 0) ? result : 0);
         } else {
-            // There is no config structure
-            result = ExboErr_NoConfig;
+            // Report the error from zConfigFinish()
+            result = r;
         }
     } else {
         // There is no instance structure
@@ -564,187 +887,1832 @@ int exboRecordAttempt(exbo xp, int64_t time) {
     return result;
 }
 
-/* To signal an error, this function returns a value that is less
- * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
- */
-int64_t exboGetPreviousAttemptTime(exbo xp) {
-    int64_t result;
+int exboRecordAttemptWeighted(exbo xp, int64_t time, int64_t cost) {
+    int result;
     if (xp != (exbo)0) {
         struct instance *p = (struct instance *)xp;
-        int64_t T = p->T;
-        if (T >= Exbo_MinimumTime) {
-            result = T;
+        struct config *config = &p->config;
+        int r;
+        if ((r = zConfigFinish(config)) <= 0) {
+            if (cost > (int64_t)0) {
+                int warning;
+                result = zStateRecordJittered(&p->state, config, time, cost, zInstanceStream(p), &warning);
+                Z_STATS(result, warning, p->state.D, p->state.I);
+                zInstanceCount(p, result, warning);
+                if (result == 0) {
+                    // Report any warning that accumulated
+                    result = warning;
+                }
+            } else {
+                result = ExboErr_InvalidCost;
+            }
         } else {
-            // silently mask the T underflow
-            result = Exbo_MinimumTime;
+            // Report the error from zConfigFinish()
+            result = r;
         }
     } else {
         // There is no instance structure
-        result = INT64_MIN + ExboErr_NoInstance;
+        result = ExboErr_NoInstance;
     }
     return result;
 }
 
-/* To signal an error, this function returns a value that is less
- * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
- */
-int64_t exboGetNextAttemptTime(exbo xp) {
-    int64_t result;
+int exboTryAttempt(exbo xp, int64_t now, int64_t *waitp) {
+    int result;
     if (xp != (exbo)0) {
         struct instance *p = (struct instance *)xp;
-        int64_t I = p->I;
-        if (I >= (int64_t)0) {
-            int64_t T = p->T;
-            int64_t T_plus_I = T + I;
-            if (T_plus_I >= T) {
-                if (T_plus_I >= Exbo_MinimumTime) {
-                    result = T_plus_I;
-                } else {
-                    // silently mask the T + I underflow
-                    result = Exbo_MinimumTime;
-                }
-            } else {
-                // T + I overflowed
-                result = INT64_MIN + ExboErr_NextTimeOverflow;
+        struct config *config = &p->config;
+        int r;
+        if ((r = zConfigFinish(config)) <= 0) {
+            int64_t wait;
+            int warning;
+            result = zStateTryAttempt(&p->state, config, now, zInstanceStream(p), &wait, &warning);
+            zInstanceCount(p, result, warning);
+            if (result == 0) {
+                // Report any warning that accumulated
+                result = warning;
+            }
+            if (waitp != (int64_t *)0) {
+                *waitp = wait;
             }
         } else {
-            // I should not be negative
-            result = INT64_MIN + ExboErr_StateWithNegativeI;
+            // Report the error from zConfigFinish()
+            result = r;
         }
     } else {
         // There is no instance structure
-        result = INT64_MIN + ExboErr_NoInstance;
+        result = ExboErr_NoInstance;
     }
     return result;
 }
 
-/* To signal an error, this function returns a value that is less
- * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
- */
-int64_t exboGetPayBackTime(exbo xp) {
-    int64_t result;
-    if (xp != (exbo)0) {
-        struct instance *p = (struct instance *)xp;
-        int64_t D = p->D;
-        if (D >= (int64_t)0) {
-            int64_t T = p->T;
-            int64_t T_plus_D = T + D;
-            if (T_plus_D >= T) {
-                if (T_plus_D >= Exbo_MinimumTime) {
-                    result = T_plus_D;
-                } else {
-                    // silently mask the T + D underflow
-                    result = Exbo_MinimumTime;
+int exboRecordAttemptLevels(const exbo *levels, size_t n, int64_t time, int64_t *nextp, size_t *bindingp) {
+    int result;
+    if ((levels != (const exbo *)0) && (n > (size_t)0)) {
+        if (n <= (size_t)Exbo_MaximumLevels) {
+            // First compute every level's new state, so that nothing is
+            // changed unless every level can record the attempt.
+            struct state next[Exbo_MaximumLevels];
+            int warnings[Exbo_MaximumLevels];
+            size_t k;
+            result = 0;
+            for (k = 0; (k < n) && (result == 0); k++) {
+                if (levels[k] != (exbo)0) {
+                    struct instance *p = (struct instance *)levels[k];
+                    int r;
+                    if ((r = zConfigFinish(&p->config)) <= 0) {
+                        next[k] = p->state;
+                        result = zStateRecordJittered(&next[k], &p->config, time, p->config.A, zInstanceStream(p),
+                                                      &warnings[k]);
+                        if (result != 0) {
+                            Z_STATS(result, warnings[k], next[k].D, next[k].I);
+                            zInstanceCount(p, result, warnings[k]);
+                        }
+                    } else {
+                        // Report the error from zConfigFinish()
+                        result = r;
+                    }
+                } else {
+                    // There is no instance structure
+                    result = ExboErr_NoInstance;
+                }
+            }
+            if (result == 0) {
+                int64_t governing = INT64_MIN;
+                size_t binding = (size_t)0;
+                for (k = 0; k < n; k++) {
+                    struct instance *p = (struct instance *)levels[k];
+                    int64_t t;
+                    p->state = next[k];
+                    Z_STATS(0, warnings[k], next[k].D, next[k].I);
+                    zInstanceCount(p, 0, warnings[k]);
+                    if (result == 0) {
+                        // Report the first warning of any level
+                        result = warnings[k];
+                    }
+                    t = zStateGetNextAttemptTime(&next[k]);
+                    // The first error governs over any time.
+                    if ((k == (size_t)0)
+                        || ((governing >= Exbo_MinimumTime) && ((t < Exbo_MinimumTime) || (t > governing)))) {
+                        governing = t;
+                        binding = k;
+                    }
+                }
+                if (nextp != (int64_t *)0) {
+                    *nextp = governing;
+                }
+                if (bindingp != (size_t *)0) {
+                    *bindingp = binding;
+                }
+            }
+        } else {
+            result = ExboErr_TooManyLevels;
+        }
+    } else {
+        // There are no instance structures
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboGetPreviousAttemptTime(exbo xp) {
+    int64_t result;
+    if (xp != (exbo)0) {
+        result = zStateGetPreviousAttemptTime(&((struct instance *)xp)->state);
+    } else {
+        // There is no instance structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboGetNextAttemptTime(exbo xp) {
+    int64_t result;
+    if (xp != (exbo)0) {
+        result = zStateGetNextAttemptTime(&((struct instance *)xp)->state);
+    } else {
+        // There is no instance structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboGetPayBackTime(exbo xp) {
+    int64_t result;
+    if (xp != (exbo)0) {
+        result = zStateGetPayBackTime(&((struct instance *)xp)->state);
+    } else {
+        // There is no instance structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+exboConfig exboConfigCreate(double X, int64_t A, int64_t L) {
+    return (exboConfig)zConfigCreate(X, A, L, (int64_t)0);
+}
+
+exboConfig exboConfigCreateTabulated(double X, int64_t A, int64_t L, int64_t tableSize) {
+    return (exboConfig)zConfigCreate(X, A, L, tableSize);
+}
+
+exboConfig exboConfigCreateFrom(exbo xp) {
+    exboConfig result;
+    if (xp != (exbo)0) {
+        struct config *config = &((struct instance *)xp)->config;
+        if (zConfigFinish(config) == 0) {
+            struct config *p = (struct config *)zBlockGet();
+            if (p != (struct config *)0) {
+                *p = *config;
+                p->table = (struct table *)0;
+                if (config->table != (struct table *)0) {
+                    size_t bytes = Z_TABLE_BYTES(config->table->size);
+                    if ((p->table = (struct table *)zAllocate(bytes)) != (struct table *)0) {
+                        memcpy((void *)p->table, (const void *)config->table, bytes);
+                        result = (exboConfig)p;
+                    } else {
+                        zBlockPut((void *)p);
+                        result = (exboConfig)0;
+                    }
+                } else {
+                    result = (exboConfig)p;
+                }
+            } else {
+                result = (exboConfig)0;
+            }
+        } else {
+            result = (exboConfig)0;
+        }
+    } else {
+        result = (exboConfig)0;
+    }
+    return result;
+}
+
+void exboConfigDestroy(exboConfig cp) {
+    struct config *p = (struct config *)cp;
+    if (p != (struct config *)0) {
+        zConfigFini(p);
+        zBlockPut((void *)p);
+    }
+    return;
+}
+
+int64_t exboConfigGetTableErrorBound(exboConfig cp) {
+    int64_t result;
+    if (cp != (exboConfig)0) {
+        const struct table *table = ((const struct config *)cp)->table;
+        if ((table != (const struct table *)0)
+                && (((const struct config *)cp)->engine == ExboEngine_Double)) {
+            result = (int64_t)0;
+        } else {
+            result = INT64_MIN + ExboErr_ConfigValueNotSet;
+        }
+    } else {
+        result = INT64_MIN + ExboErr_NoConfig;
+    }
+    return result;
+}
+
+double exboConfigGet_X(exboConfig cp) {
+    double result;
+    if (cp != (exboConfig)0) {
+        result = ((const struct config *)cp)->X;
+    } else {
+        result = nan(NanTag_ExboErr_NoConfig);
+    }
+    return result;
+}
+
+int64_t exboConfigGet_A(exboConfig cp) {
+    int64_t result;
+    if (cp != (exboConfig)0) {
+        result = ((const struct config *)cp)->A;
+    } else {
+        result = INT64_MIN + ExboErr_NoConfig;
+    }
+    return result;
+}
+
+int64_t exboConfigGet_L(exboConfig cp) {
+    int64_t result;
+    if (cp != (exboConfig)0) {
+        result = ((const struct config *)cp)->L;
+    } else {
+        result = INT64_MIN + ExboErr_NoConfig;
+    }
+    return result;
+}
+
+int exboStateInit(exboState *sp) {
+    int result;
+    if (sp != (exboState *)0) {
+        zStateInit((struct state *)(void *)sp);
+        result = 0;
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStateRecordAttempt(exboConfig cp, exboState *sp, int64_t time) {
+    int result;
+    if (sp != (exboState *)0) {
+        if (cp != (exboConfig)0) {
+            // A shared config is finished when it is created.
+            result = zStateRecordAttempt((struct state *)(void *)sp, (const struct config *)cp, time,
+                                         (uint64_t)(uintptr_t)sp);
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStateRecordAttemptStream(exboConfig cp, exboState *sp, int64_t time, uint64_t stream) {
+    int result;
+    if (sp != (exboState *)0) {
+        if (cp != (exboConfig)0) {
+            result = zStateRecordAttempt((struct state *)(void *)sp, (const struct config *)cp, time, stream);
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStateRecordAttemptWeighted(exboConfig cp, exboState *sp, int64_t time, int64_t cost) {
+    int result;
+    if (sp != (exboState *)0) {
+        if (cp != (exboConfig)0) {
+            if (cost > (int64_t)0) {
+                struct state *p = (struct state *)(void *)sp;
+                int warning;
+                result = zStateRecordJittered(p, (const struct config *)cp, time, cost, (uint64_t)(uintptr_t)p,
+                                              &warning);
+                Z_STATS(result, warning, p->D, p->I);
+                if (result == 0) {
+                    // Report any warning that accumulated
+                    result = warning;
+                }
+            } else {
+                result = ExboErr_InvalidCost;
+            }
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStateTryAttempt(exboConfig cp, exboState *sp, int64_t now, int64_t *waitp) {
+    int result;
+    if (sp != (exboState *)0) {
+        if (cp != (exboConfig)0) {
+            int64_t wait;
+            int warning;
+            result = zStateTryAttempt((struct state *)(void *)sp, (const struct config *)cp, now, (uint64_t)(uintptr_t)sp,
+                                      &wait, &warning);
+            if (result == 0) {
+                // Report any warning that accumulated
+                result = warning;
+            }
+            if (waitp != (int64_t *)0) {
+                *waitp = wait;
+            }
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboStateGetPreviousAttemptTime(const exboState *sp) {
+    int64_t result;
+    if (sp != (const exboState *)0) {
+        result = zStateGetPreviousAttemptTime((const struct state *)(const void *)sp);
+    } else {
+        // There is no state structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboStateGetNextAttemptTime(const exboState *sp) {
+    int64_t result;
+    if (sp != (const exboState *)0) {
+        result = zStateGetNextAttemptTime((const struct state *)(const void *)sp);
+    } else {
+        // There is no state structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboStateGetPayBackTime(const exboState *sp) {
+    int64_t result;
+    if (sp != (const exboState *)0) {
+        result = zStateGetPayBackTime((const struct state *)(const void *)sp);
+    } else {
+        // There is no state structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboRecordAttemptBatch(exboConfig cp, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                           const int64_t *time, int *results) {
+    int result;
+    if ((T != (int64_t *)0) && (D != (int64_t *)0) && (I != (int64_t *)0)
+            && (time != (const int64_t *)0) && (results != (int *)0)) {
+        if (cp != (exboConfig)0) {
+            // A shared config is finished when it is created.
+            const struct config *config = (const struct config *)cp;
+#if Z_BATCH_X86
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+                zBatchAvx512(config, n, T, D, I, time, results);
+            } else if (__builtin_cpu_supports("avx2")) {
+                zBatchAvx2(config, n, T, D, I, time, results);
+            } else {
+                zBatchScalar(config, n, T, D, I, time, results);
+            }
+#else
+            zBatchScalar(config, n, T, D, I, time, results);
+#endif
+            result = 0;
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There are no state arrays
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboAtomicStateInit(exboAtomicState *sp) {
+    int result;
+    if (sp != (exboAtomicState *)0) {
+        struct atomicState *p = (struct atomicState *)(void *)sp;
+        p->T = INT64_MIN;
+        p->D = (int64_t)0;
+        result = 0;
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboAtomicStateRecordAttempt(exboConfig cp, exboAtomicState *sp, int64_t time) {
+    int result;
+    if (sp != (exboAtomicState *)0) {
+        if (cp != (exboConfig)0) {
+            int warning;
+            result = zAtomicRecordAttempt((struct atomicState *)(void *)sp, (const struct config *)cp, time,
+                                          (int64_t *)0, &warning);
+            if (result == 0) {
+                // Report the warning of the write that won.
+                result = warning;
+            }
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboAtomicStateTryAttempt(exboConfig cp, exboAtomicState *sp, int64_t now, int64_t *waitp) {
+    int result;
+    if (sp != (exboAtomicState *)0) {
+        if (cp != (exboConfig)0) {
+            int64_t wait;
+            int warning;
+            result = zAtomicRecordAttempt((struct atomicState *)(void *)sp, (const struct config *)cp, now,
+                                          &wait, &warning);
+            if (result == 0) {
+                // Report the warning of the write that won.
+                result = warning;
+            }
+            if (waitp != (int64_t *)0) {
+                *waitp = wait;
+            }
+        } else {
+            // There is no config structure
+            result = ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboAtomicStateGetPreviousAttemptTime(exboAtomicState *sp) {
+    int64_t result;
+    if (sp != (exboAtomicState *)0) {
+        struct state state;
+        int r;
+        if ((r = zAtomicLoad((struct atomicState *)(void *)sp, (const struct config *)0, &state)) == 0) {
+            result = zStateGetPreviousAttemptTime(&state);
+        } else {
+            result = INT64_MIN + r;
+        }
+    } else {
+        // There is no state structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboAtomicStateGetNextAttemptTime(exboConfig cp, exboAtomicState *sp) {
+    int64_t result;
+    if (sp != (exboAtomicState *)0) {
+        if (cp != (exboConfig)0) {
+            struct state state;
+            int r;
+            if ((r = zAtomicLoad((struct atomicState *)(void *)sp, (const struct config *)cp, &state)) == 0) {
+                result = zStateGetNextAttemptTime(&state);
+            } else {
+                result = INT64_MIN + r;
+            }
+        } else {
+            // There is no config structure
+            result = INT64_MIN + ExboErr_NoConfig;
+        }
+    } else {
+        // There is no state structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboAtomicStateGetPayBackTime(exboAtomicState *sp) {
+    int64_t result;
+    if (sp != (exboAtomicState *)0) {
+        struct state state;
+        int r;
+        if ((r = zAtomicLoad((struct atomicState *)(void *)sp, (const struct config *)0, &state)) == 0) {
+            result = zStateGetPayBackTime(&state);
+        } else {
+            result = INT64_MIN + r;
+        }
+    } else {
+        // There is no state structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboSerialize(exbo xp, unsigned char *buffer, size_t size) {
+    int result;
+    if ((xp != (exbo)0) && (buffer != (unsigned char *)0)) {
+        if (size >= (size_t)Exbo_SnapshotSize) {
+            zSnapshotWrite((const struct instance *)xp, buffer);
+            result = 0;
+        } else {
+            result = ExboErr_SnapshotTooSmall;
+        }
+    } else {
+        // There is no instance structure or buffer
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboDeserialize(exbo xp, const unsigned char *buffer, size_t size) {
+    int result;
+    if ((xp != (exbo)0) && (buffer != (const unsigned char *)0)) {
+        if (size >= (size_t)Exbo_SnapshotSize) {
+            result = zSnapshotRead((struct instance *)xp, buffer);
+        } else {
+            result = ExboErr_SnapshotTooSmall;
+        }
+    } else {
+        // There is no instance structure or buffer
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboSerializeBatch(const exbo *xps, size_t n, unsigned char *buffer, size_t size, int *results) {
+    int result;
+    if ((xps != (const exbo *)0) && (buffer != (unsigned char *)0) && (results != (int *)0)) {
+        if (size / (size_t)Exbo_SnapshotSize >= n) {
+            size_t k;
+            for (k = 0; k < n; k++) {
+                if (xps[k] != (exbo)0) {
+                    zSnapshotWrite((const struct instance *)xps[k], &buffer[k * (size_t)Exbo_SnapshotSize]);
+                    results[k] = 0;
+                } else {
+                    results[k] = ExboErr_NoInstance;
+                }
+            }
+            result = 0;
+        } else {
+            result = ExboErr_SnapshotTooSmall;
+        }
+    } else {
+        // There is no instance array, buffer or results array
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboDeserializeBatch(const exbo *xps, size_t n, const unsigned char *buffer, size_t size, int *results) {
+    int result;
+    if ((xps != (const exbo *)0) && (buffer != (const unsigned char *)0) && (results != (int *)0)) {
+        if (size / (size_t)Exbo_SnapshotSize >= n) {
+            size_t k;
+            for (k = 0; k < n; k++) {
+                if (xps[k] != (exbo)0) {
+                    results[k] = zSnapshotRead((struct instance *)xps[k], &buffer[k * (size_t)Exbo_SnapshotSize]);
+                } else {
+                    results[k] = ExboErr_NoInstance;
+                }
+            }
+            result = 0;
+        } else {
+            result = ExboErr_SnapshotTooSmall;
+        }
+    } else {
+        // There is no instance array, buffer or results array
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboGetStats(exboStats *statsp) {
+    int result;
+    if (statsp != (exboStats *)0) {
+        memset((void *)statsp, 0, sizeof(*statsp));
+#if EXBO_STATS
+        const struct statsBlock *block;
+        for (block = __atomic_load_n(&zStatsBlocks, __ATOMIC_ACQUIRE); block != (const struct statsBlock *)0;
+             block = block->next) {
+            zStatsMerge(statsp, &block->stats);
+        }
+        result = 0;
+#else
+        result = ExboErr_StatsDisabled;
+#endif
+    } else {
+        // There is no stats structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboSetStatsSink(exbo xp, exboStats *statsp) {
+    int result;
+    if (xp != (exbo)0) {
+        ((struct instance *)xp)->stats = statsp;
+        result = 0;
+    } else {
+        // There is no instance structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+const char *exboGetNanErrorMessage(double nanErrorNumber) {
+    const char *result;
+    if (isnan(nanErrorNumber)) {
+        // extract the error number from the NaN
+        uint64_t nanErrorNumberHex;
+        memcpy((void *)&nanErrorNumberHex, (const void *)&nanErrorNumber, sizeof(nanErrorNumberHex));
+        int errorNumber = (int)(0x7ffffff & nanErrorNumberHex);
+        result = zErrMessages[errorNumber];
+    } else {
+        result = zErrMessageNotError;
+    }
+    return result;
+}
+
+const char *exboGetTimeErrorMessage(int64_t timeErrorNumber) {
+    const char *result;
+    if (timeErrorNumber < Exbo_MinimumTime) {
+        int errorNumber = (int)(timeErrorNumber - INT64_MIN);
+        result = zErrMessages[errorNumber];
+    } else {
+        result = zErrMessageNotError;
+    }
+    return result;
+}
+
+const char *exboGetErrorMessage(int errorNumber) {
+    const char *result;
+    if (errorNumber >= 0) {
+        if (errorNumber < ExboErr_MAXIMUM) {
+            result = zErrMessages[errorNumber];
+        } else {
+            result = zErrMessageMaximum;
+        }
+    } else if (errorNumber > -ExboWarn_COUNT) {
+        result = zWarnMessages[-errorNumber];
+    } else {
+        result = zErrMessageNegative;
+    }
+    return result;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+
+/********************
+* Allocating memory *
+********************/
+static void *zAllocate(size_t size) {
+    // Count the allocation before it is made, so that exboSetAllocator()
+    // cannot change the hooks under it.
+    struct allocator hooks;
+    void *p;
+#if Z_ALLOCATOR_LOCK
+    (void)pthread_mutex_lock(&zAllocatorMutex);
+#endif
+    zHeldAdd((int64_t)1);
+    hooks = zAllocator;
+#if Z_ALLOCATOR_LOCK
+    (void)pthread_mutex_unlock(&zAllocatorMutex);
+#endif
+    p = hooks.allocate(size, hooks.context);
+    if (p == (void *)0) {
+        zHeldAdd((int64_t)-1);
+    }
+    return p;
+}
+
+static void zFree(void *p, size_t size) {
+    // Assert: p came from zAllocate(size), so the hooks it came from are
+    // still in place
+    zAllocator.release(p, size, zAllocator.context);
+    zHeldAdd((int64_t)-1);
+    return;
+}
+
+static void zHeldAdd(int64_t delta) {
+#if defined(__GNUC__)
+    (void)__atomic_add_fetch(&zAllocatorHeld, delta, __ATOMIC_RELEASE);
+#else
+    zAllocatorHeld += delta;
+#endif
+    return;
+}
+
+static void *zDefaultAllocate(size_t size, void *context) {
+    (void)context;
+    return malloc(size);
+}
+
+static void zDefaultFree(void *p, size_t size, void *context) {
+    (void)size;
+    (void)context;
+    free(p);
+    return;
+}
+
+static void *zBlockGet(void) {
+    // Get a block of Z_BLOCK_SIZE bytes for an instance or a config.
+#if Z_POOL
+    struct block *b = zPoolFree;
+    if (b == (struct block *)0) {
+        b = zPoolRefill();
+    }
+    if (b != (struct block *)0) {
+        zPoolFree = b->next;
+    }
+    return (void *)b;
+#else
+    return zAllocate(Z_BLOCK_SIZE);
+#endif
+}
+
+static void zBlockPut(void *p) {
+    // Assert: p came from zBlockGet(), perhaps on another thread
+#if Z_POOL
+    struct block *b = (struct block *)p;
+    zPoolRegister();
+    b->next = zPoolFree;
+    zPoolFree = b;
+#else
+    zFree(p, Z_BLOCK_SIZE);
+#endif
+    return;
+}
+
+#if Z_POOL
+static struct block *zPoolRefill(void) {
+    // Take the blocks that exited threads left, or else carve a new slab
+    // into a list of blocks, each on a cache line of its own.  Slabs are
+    // never freed, so once one is carved the allocator stays as it is.
+    struct block *result;
+    zPoolRegister();
+    result = __atomic_exchange_n(&zPoolShared, (struct block *)0, __ATOMIC_ACQUIRE);
+    if (result == (struct block *)0) {
+        unsigned char *slab = (unsigned char *)zAllocate((Z_SLAB_BLOCKS + (size_t)1) * Z_BLOCK_SIZE);
+        if (slab != (unsigned char *)0) {
+            unsigned char *first = slab + (Z_BLOCK_SIZE - (size_t)((uintptr_t)slab % Z_BLOCK_SIZE));
+            size_t k;
+            for (k = 0; k < Z_SLAB_BLOCKS; k++) {
+                struct block *b = (struct block *)(void *)&first[k * Z_BLOCK_SIZE];
+                b->next = (k + (size_t)1 < Z_SLAB_BLOCKS) ? (struct block *)(void *)&first[(k + (size_t)1) * Z_BLOCK_SIZE]
+                                                            : (struct block *)0;
+            }
+            result = (struct block *)(void *)first;
+        }
+    }
+    return result;
+}
+
+static void zPoolRegister(void) {
+    // Arrange for the free blocks of this thread to be handed on when it
+    // exits.
+    if (!zPoolHasThread) {
+        (void)pthread_once(&zPoolOnce, zPoolCreateKey);
+        if (zPoolHasKey) {
+            // The destructor only runs for a value that is not null.
+            (void)pthread_setspecific(zPoolKey, (const void *)&zPoolKey);
+        }
+        zPoolHasThread = 1;
+    }
+    return;
+}
+
+static void zPoolCreateKey(void) {
+    zPoolHasKey = (pthread_key_create(&zPoolKey, zPoolRelease) == 0);
+    return;
+}
+
+static void zPoolRelease(void *unused) {
+    // Assert: this thread is exiting
+    struct block *first = zPoolFree;
+    (void)unused;
+    if (first != (struct block *)0) {
+        struct block *last = first;
+        while (last->next != (struct block *)0) {
+            last = last->next;
+        }
+        last->next = __atomic_load_n(&zPoolShared, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&zPoolShared, &last->next, first, 0, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED)) {
+            // last->next now holds the newer head
+        }
+        zPoolFree = (struct block *)0;
+    }
+    zPoolHasThread = 0;
+    return;
+}
+#endif
+
+/***********************
+* Managing an instance *
+***********************/
+static struct instance *zInstanceCreate(void) {
+    struct instance *p = (struct instance *)zBlockGet();
+    if (p != (struct instance *)0) {
+        zInstanceInit(p);
+    }
+    return p;
+}
+
+static void zInstanceDestroy(struct instance *p) {
+    if (p != (struct instance *)0) {
+        zInstanceFini(p);
+        zBlockPut((void *)p);
+    }
+    return;
+}
+
+static void zInstanceInit(struct instance *p) {
+    // Assert: p != (struct instance *)0
+    zStateInit(&p->state);
+    zConfigInit(&p->config);
+    p->stats = (exboStats *)0;
+    return;
+}
+
+static void zInstanceFini(struct instance *p) {
+    // Assert: p != (struct instance *)0
+    zConfigFini(&p->config);
+    p->state.D = (int64_t)0;
+    p->state.I = (int64_t)0;
+    p->state.T = (int64_t)0;
+    p->stats = (exboStats *)0;
+    return;
+}
+
+static int zInstanceConfigure(struct instance *p, double X, int64_t A, int64_t L) {
+    // Assert: p != (struct instance *)0
+    int result;
+    int r;
+    if ((r = exboConfigure_X((exbo)p, X)) == 0) {
+        if ((r = exboConfigure_A((exbo)p, A)) == 0) {
+            if ((r = exboConfigure_L((exbo)p, L)) == 0) {
+                result = zConfigFinish(&p->config);
+            } else {
+                result = r;
+            }
+        } else {
+            result = r;
+        }
+    } else {
+        result = r;
+    }
+    return result;
+}
+
+/*******************
+* Managing a state *
+*******************/
+static void zStateInit(struct state *p) {
+    // Assert: p != (struct state *)0
+    p->T = INT64_MIN;
+    p->D = (int64_t)0;
+    p->I = (int64_t)0;
+    return;
+}
+
+static int zStateRecordAttempt(struct state *p, const struct config *config, int64_t time, uint64_t stream) {
+    // Assert: p != (struct state *)0
+    // Assert: config != (struct config *)0
+    // Assert: config->isFinished
+    int warning;
+    int result = zStateRecordJittered(p, config, time, config->A, stream, &warning);
+    Z_STATS(result, warning, p->D, p->I);
+    if (result == 0) {
+        // Report any warning that accumulated
+        result = warning;
+    }
+    return result;
+}
+
+static int zStateRecordAttemptWarning(struct state *p, const struct config *config, int64_t time, int *warningp) {
+    // Assert: p != (struct state *)0
+    // Assert: config != (struct config *)0
+    // Assert: config->isFinished
+    // Assert: warningp != (int *)0
+    // An attempt costs A.
+    return zStateRecordCost(p, config, time, config->A, warningp);
+}
+
+static int zStateRecordCost(struct state *p, const struct config *config, int64_t time, int64_t cost,
+                            int *warningp) {
+    // Assert: p != (struct state *)0
+    // Assert: config != (struct config *)0
+    // Assert: config->isFinished
+    // Assert: cost > 0
+    // Assert: warningp != (int *)0
+    int result;
+    int r;
+    int warning = 0;
+    int64_t T_in = p->T;
+    int64_t T_out = time;
+    if (T_out >= T_in) {
+        int64_t D_in = p->D;
+        int64_t I_in = p->I;
+        // The sums and differences here wrap, as the checks on them expect,
+        // rather than overflow, which the optimizer may assume never happens.
+        int64_t T_diff = (int64_t)((uint64_t)T_out - (uint64_t)T_in);
+        int64_t D_prime;
+        if (T_diff >= (int64_t)0) {
+            // T_diff did not overflow
+            if (T_diff < I_in) {
+                // The user is being too aggressive.
+                // Accumulate the warning
+                // This warning overrides any previous warning.
+                warning = ExboWarn_AttemptIsEarlierThanRecommended;
+            }
+            if (T_diff < D_in) {
+                D_prime = D_in - T_diff;
+            } else {
+                D_prime = (int64_t)0;
+            }
+        } else {
+            // T_diff overflowed - no warning is needed
+            D_prime = (int64_t)0;
+        }
+        int64_t L = config->L;
+        int64_t A = config->A;
+        int64_t D_out = (int64_t)((uint64_t)D_prime + (uint64_t)cost);
+        int64_t I_out;
+        if (D_out >= cost) {
+            // D_out did not overflow
+            // A debt below A, left by a cost below A, has the interval of A.
+            r = zStateInterval(config, (D_out >= A) ? D_out : A, &I_out);
+            if (r <= 0) {
+                if (r < 0) {
+                    // Accumulate the warning
+                    // This warning overrides any previous warning.
+                    warning = r;
+                }
+                result = 0;
+            } else {
+                // Report the error from zInterval().
+                result = r;
+            }
+        } else {
+            // D_out overflowed
+            D_out = INT64_MAX;
+            I_out = D_out - (L - A);
+            // Accumulate the warning
+            warning = ExboWarn_ExcessCostLimitBreachWithDebtOverflow;
+            result = 0;
+        }
+        if (result == 0) {
+            // There is no error so update the state
+            p->T = T_out;
+            p->I = I_out;
+            p->D = D_out;
+        }
+    } else {
+        // The attempts are being recorded out of order
+        result = ExboErr_RecordingAPriorAttempt;
+    }
+    *warningp = warning;
+    return result;
+}
+
+static int zStateRecordJittered(struct state *p, const struct config *config, int64_t time, int64_t cost,
+                                uint64_t stream, int *warningp) {
+    // Assert: as for zStateRecordCost()
+    // Assert: stream identifies the state, of which p may be a copy
+    int64_t I_in = p->I;
+    int result = zStateRecordCost(p, config, time, cost, warningp);
+    if ((result == 0) && (config->jitter != ExboJitter_None)) {
+        zJitter(p, config, stream, I_in);
+    }
+    return result;
+}
+
+static void zInstanceCount(const struct instance *p, int result, int warning) {
+    // Assert: p != (struct instance *)0
+    // Count a record or try in the instance's own sink, if it has one.
+    if (p->stats != (exboStats *)0) {
+        zStatsCountInto(p->stats, result, warning, p->state.D, p->state.I);
+    }
+    return;
+}
+
+static uint64_t zInstanceStream(const struct instance *p) {
+    // An instance owns its config, so a seed identifies it; an unseeded
+    // one is told apart by its address.
+    return p->config.hasSeed ? UINT64_C(0) : (uint64_t)(uintptr_t)p;
+}
+
+static void zJitter(struct state *p, const struct config *config, uint64_t stream, int64_t I_in) {
+    // Assert: p->I >= 1, as computed by zStateRecordCost()
+    // Draw I uniformly from [1, bound] by multiplying a 64-bit hash of
+    // (seed, stream, T, D) by bound and keeping the high word.  Nothing
+    // else goes in, so the same seed, stream and history draw the same
+    // wherever the state is held.
+    int64_t bound = p->I;
+    uint64_t k = zMix(stream);
+    if (config->hasSeed) {
+        k ^= zMix(config->seed ^ UINT64_C(0x9e3779b97f4a7c15));
+    }
+    uint64_t draw = zMix(zMix(k) ^ zMix((uint64_t)p->T ^ zMix((uint64_t)p->D)));
+    uint64_t hi;
+    uint64_t lo;
+    if ((config->jitter == ExboJitter_Decorrelated) && (I_in > (int64_t)0) && (I_in <= bound / (int64_t)3)) {
+        // Grow from the previous interval, as in decorrelated jitter
+        bound = I_in * (int64_t)3;
+    }
+    zMul64(draw, (uint64_t)bound, &hi, &lo);
+    p->I = (int64_t)hi + (int64_t)1;
+    return;
+}
+
+static uint64_t zMix(uint64_t z) {
+    // The SplitMix64 finalizer
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+static int zStateInterval(const struct config *config, int64_t D, int64_t *Ip) {
+    // Assert: D >= config->A
+    // The interval is a function of the debt alone.
+    int result;
+    int64_t L = config->L;
+    int64_t A = config->A;
+    if (config->engine == ExboEngine_Integer) {
+        // No floating point arithmetic is done on this path.
+        result = zIntervalInteger(L, A, &config->X, D, Ip);
+    } else if ((D < L) && (config->table != (struct table *)0)) {
+        // The excess cost limit is under-saturated.
+        result = zIntervalTabulated(config->table, L, A, config->X, D, Ip);
+    } else {
+        result = zInterval(L, A, config->X, D, Ip);
+    }
+    return result;
+}
+
+static int zStateTryAttempt(struct state *p, const struct config *config, int64_t now, uint64_t stream, int64_t *waitp,
+                            int *warningp) {
+    // Assert: p != (struct state *)0
+    // Assert: config != (struct config *)0
+    // Assert: config->isFinished
+    // Assert: waitp != (int64_t *)0
+    // Assert: warningp != (int *)0
+    int result;
+    int64_t next = zStateGetNextAttemptTime(p);
+    *warningp = 0;
+    *waitp = (int64_t)0;
+    if (next >= Exbo_MinimumTime) {
+        if (zReady(next, now, waitp)) {
+            result = zStateRecordJittered(p, config, now, config->A, stream, warningp);
+        } else {
+            // The state is left unchanged
+            result = ExboErr_AttemptNotReady;
+        }
+    } else {
+        // Report the error from zStateGetNextAttemptTime()
+        result = (int)(next - INT64_MIN);
+    }
+    Z_STATS(result, *warningp, p->D, p->I);
+    return result;
+}
+
+static int zReady(int64_t next, int64_t now, int64_t *waitp) {
+    // Returns 1 if now is at or after next; otherwise sets *waitp to the
+    // time remaining, clamped to INT64_MAX, and returns 0.
+    int result;
+    if (now >= next) {
+        *waitp = (int64_t)0;
+        result = 1;
+    } else {
+        uint64_t wait = (uint64_t)next - (uint64_t)now;
+        *waitp = (wait <= (uint64_t)INT64_MAX) ? (int64_t)wait : INT64_MAX;
+        result = 0;
+    }
+    return result;
+}
+
+static int64_t zStateGetPreviousAttemptTime(const struct state *p) {
+    // Assert: p != (struct state *)0
+    // The state has the layout of exbo_inline.h.
+    return exboInlineLayoutGetPreviousAttemptTime((const exboStateLayout *)(const void *)p);
+}
+
+static int64_t zStateGetNextAttemptTime(const struct state *p) {
+    // Assert: p != (struct state *)0
+    return exboInlineLayoutGetNextAttemptTime((const exboStateLayout *)(const void *)p);
+}
+
+static int64_t zStateGetPayBackTime(const struct state *p) {
+    // Assert: p != (struct state *)0
+    return exboInlineLayoutGetPayBackTime((const exboStateLayout *)(const void *)p);
+}
+
+/********************
+* Recording a batch *
+********************/
+static void zBatchScalar(const struct config *config, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                         const int64_t *time, int *results) {
+    size_t k;
+    for (k = 0; k < n; k++) {
+        results[k] = zBatchElement(config, &T[k], &D[k], &I[k], time[k]);
+    }
+    return;
+}
+
+static int zBatchElement(const struct config *config, int64_t *T, int64_t *D, int64_t *I, int64_t time) {
+    // Record one element, reporting its warning if it has no error.
+    struct state state;
+    int warning;
+    int result;
+    state.T = *T;
+    state.D = *D;
+    state.I = *I;
+    result = zStateRecordAttemptWarning(&state, config, time, &warning);
+    Z_STATS(result, warning, state.D, state.I);
+    if (result == 0) {
+        *T = state.T;
+        *D = state.D;
+        *I = state.I;
+        result = warning;
+    }
+    return result;
+}
+
+#if Z_BATCH_X86
+/* The vector kernels follow zStateRecordAttemptWarning() lane by lane,
+ * with wrapping arithmetic standing in for its overflow checks.  With a
+ * double engine table, an under-saturated lane whose J is tabulated is
+ * computed with the same search and arithmetic as zIntervalTabulated().
+ * A lane that records a prior attempt, or whose interval must be solved
+ * for, is left unchanged by the kernel and then recorded by
+ * zBatchElement().  AVX2 has no conversion between 64-bit integers and
+ * doubles, so this kernel converts by way of 2^52, which is exact below
+ * it, and uses the table only if L is below it too.
+ */
+__attribute__((target("avx2")))
+static void zBatchAvx2(const struct config *config, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                       const int64_t *time, int *results) {
+    int64_t A = config->A;
+    int64_t L = config->L;
+    const struct table *table = config->table;
+    int tabulated = (table != (const struct table *)0) && (config->engine == ExboEngine_Double)
+                    && (table->last > (int64_t)0) && (L < ((int64_t)1 << 52));
+    // With X == 1.0, an under-saturated interval is simply A.
+    int64_t solve = (config->X == 1.0) ? (int64_t)0 : (int64_t)-1;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vA = _mm256_set1_epi64x(A);
+    const __m256i vL = _mm256_set1_epi64x(L);
+    const __m256i vLminusA = _mm256_set1_epi64x(L - A);
+    const __m256i vMax = _mm256_set1_epi64x(INT64_MAX);
+    const __m256i vSolve = _mm256_set1_epi64x(solve);
+    const __m256i vEarly = _mm256_set1_epi64x(ExboWarn_AttemptIsEarlierThanRecommended);
+    const __m256i vBreach = _mm256_set1_epi64x(ExboWarn_ExcessCostLimitBreach);
+    const __m256i vOverflow = _mm256_set1_epi64x(ExboWarn_ExcessCostLimitBreachWithDebtOverflow);
+    // x + 2^52 holds x in its low bits for 0 <= x < 2^52.
+    const __m256i vMagicBits = _mm256_set1_epi64x((int64_t)0x4330000000000000);
+    const __m256d vMagic = _mm256_castsi256_pd(vMagicBits);
+    const __m256i one = _mm256_set1_epi64x((int64_t)1);
+    const __m256d zeroReal = _mm256_setzero_pd();
+    const __m256d vAReal = _mm256_set1_pd((double)A);
+    const __m256d vC = _mm256_set1_pd(tabulated ? table->c : 0.0);
+    const __m256d vLast = _mm256_set1_pd(tabulated ? (double)table->last : 0.0);
+    const __m256d vLastM = _mm256_set1_pd(tabulated ? table->values[table->last] : 0.0);
+    const double *m = tabulated ? table->values : (const double *)0;
+    const double *factor = tabulated ? (table->values + table->size) : (const double *)0;
+    int64_t warnings[4];
+    size_t k;
+    for (k = 0; k + 4 <= n; k += 4) {
+        __m256i T_in = _mm256_loadu_si256((const __m256i *)(const void *)&T[k]);
+        __m256i D_in = _mm256_loadu_si256((const __m256i *)(const void *)&D[k]);
+        __m256i I_in = _mm256_loadu_si256((const __m256i *)(const void *)&I[k]);
+        __m256i T_out = _mm256_loadu_si256((const __m256i *)(const void *)&time[k]);
+        __m256i prior = _mm256_cmpgt_epi64(T_in, T_out);
+        __m256i T_diff = _mm256_sub_epi64(T_out, T_in);
+        __m256i T_overflow = _mm256_cmpgt_epi64(zero, T_diff);
+        __m256i early = _mm256_andnot_si256(T_overflow, _mm256_cmpgt_epi64(I_in, T_diff));
+        __m256i owing = _mm256_andnot_si256(T_overflow, _mm256_cmpgt_epi64(D_in, T_diff));
+        __m256i D_out = _mm256_add_epi64(_mm256_and_si256(owing, _mm256_sub_epi64(D_in, T_diff)), vA);
+        __m256i D_overflow = _mm256_cmpgt_epi64(vA, D_out);
+        D_out = _mm256_blendv_epi8(D_out, vMax, D_overflow);
+        __m256i breach = _mm256_or_si256(_mm256_cmpgt_epi64(D_out, vL), D_overflow);
+        __m256i under = _mm256_cmpgt_epi64(vL, D_out);
+        __m256i I_out = _mm256_blendv_epi8(vA, _mm256_sub_epi64(D_out, vLminusA), breach);
+        __m256i lookup = zero;
+        if (tabulated && !_mm256_testz_si256(under, under)) {
+            // Bracket J as z_J() does, within the table, and bisect all
+            // lanes together.  Lanes whose J is not tabulated are left to
+            // zBatchElement().
+            __m256i excessBits = _mm256_and_si256(under, _mm256_sub_epi64(vL, D_out));
+            __m256d excess = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(excessBits, vMagicBits)), vMagic);
+            __m256d l = _mm256_div_pd(excess, vAReal);
+            lookup = _mm256_and_si256(under, _mm256_castpd_si256(_mm256_cmp_pd(vLastM, l, _CMP_GE_OQ)));
+            __m256d J_lowReal = _mm256_sub_pd(_mm256_ceil_pd(l), _mm256_set1_pd(1.0));
+            J_lowReal = _mm256_min_pd(_mm256_max_pd(J_lowReal, zeroReal), vLast);
+            __m256d J_highReal = _mm256_min_pd(_mm256_ceil_pd(_mm256_add_pd(l, vC)), vLast);
+            __m256i J_low = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(J_lowReal, vMagic)), vMagicBits);
+            __m256i J_high = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(J_highReal, vMagic)), vMagicBits);
+            __m256i active = _mm256_and_si256(lookup, _mm256_cmpgt_epi64(J_high, J_low));
+            while (!_mm256_testz_si256(active, active)) {
+                __m256i J_try = _mm256_add_epi64(J_low, _mm256_srli_epi64(_mm256_sub_epi64(J_high, J_low), 1));
+                __m256d m_J = _mm256_mask_i64gather_pd(zeroReal, m, J_try, _mm256_castsi256_pd(active), 8);
+                __m256i below = _mm256_and_si256(active, _mm256_castpd_si256(_mm256_cmp_pd(m_J, l, _CMP_LE_OQ)));
+                __m256i above = _mm256_and_si256(active, _mm256_castpd_si256(_mm256_cmp_pd(m_J, l, _CMP_GE_OQ)));
+                J_low = _mm256_blendv_epi8(J_low, _mm256_add_epi64(J_try, one), below);
+                J_high = _mm256_blendv_epi8(J_high, J_try, above);
+                active = _mm256_and_si256(lookup, _mm256_cmpgt_epi64(J_high, J_low));
+            }
+            __m256d f = _mm256_mask_i64gather_pd(zeroReal, factor, J_high, _mm256_castsi256_pd(lookup), 8);
+            __m256d J = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(J_high, vMagicBits)), vMagic);
+            __m256d v = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(J, vAReal), excess), f);
+            // The interval is at most about A, so below 2^52.
+            __m256d ceiling = _mm256_ceil_pd(v);
+            __m256i I_lookup = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(ceiling, vMagic)), vMagicBits);
+            I_lookup = _mm256_blendv_epi8(one, I_lookup, _mm256_castpd_si256(_mm256_cmp_pd(v, zeroReal, _CMP_GT_OQ)));
+            I_out = _mm256_blendv_epi8(I_out, I_lookup, lookup);
+        }
+        __m256i warning = _mm256_and_si256(early, vEarly);
+        warning = _mm256_blendv_epi8(warning, vBreach, breach);
+        warning = _mm256_blendv_epi8(warning, vOverflow, D_overflow);
+        __m256i scalar = _mm256_or_si256(prior, _mm256_andnot_si256(lookup, _mm256_and_si256(under, vSolve)));
+        _mm256_storeu_si256((__m256i *)(void *)&T[k], _mm256_blendv_epi8(T_out, T_in, scalar));
+        _mm256_storeu_si256((__m256i *)(void *)&D[k], _mm256_blendv_epi8(D_out, D_in, scalar));
+        _mm256_storeu_si256((__m256i *)(void *)&I[k], _mm256_blendv_epi8(I_out, I_in, scalar));
+        _mm256_storeu_si256((__m256i *)(void *)warnings, warning);
+        int lanes = _mm256_movemask_pd(_mm256_castsi256_pd(scalar));
+        int j;
+        for (j = 0; j < 4; j++) {
+            if (lanes & (1 << j)) {
+                results[k + (size_t)j] = zBatchElement(config, &T[k + (size_t)j], &D[k + (size_t)j],
+                                                       &I[k + (size_t)j], time[k + (size_t)j]);
+            } else {
+                results[k + (size_t)j] = (int)warnings[j];
+                Z_STATS(0, (int)warnings[j], D[k + (size_t)j], I[k + (size_t)j]);
+            }
+        }
+    }
+    zBatchScalar(config, n - k, &T[k], &D[k], &I[k], &time[k], &results[k]);
+    return;
+}
+
+/* As zBatchAvx2(), 8 lanes at a time, converting directly and so using
+ * the table for any L.
+ */
+__attribute__((target("avx512f,avx512dq")))
+static void zBatchAvx512(const struct config *config, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                         const int64_t *time, int *results) {
+    int64_t A = config->A;
+    int64_t L = config->L;
+    const struct table *table = config->table;
+    int tabulated = (table != (const struct table *)0) && (config->engine == ExboEngine_Double)
+                    && (table->last > (int64_t)0);
+    // With X == 1.0, an under-saturated interval is simply A.
+    __mmask8 solve = (config->X == 1.0) ? (__mmask8)0 : (__mmask8)0xff;
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i vA = _mm512_set1_epi64(A);
+    const __m512i vL = _mm512_set1_epi64(L);
+    const __m512i vLminusA = _mm512_set1_epi64(L - A);
+    const __m512i vMax = _mm512_set1_epi64(INT64_MAX);
+    const __m512i vEarly = _mm512_set1_epi64(ExboWarn_AttemptIsEarlierThanRecommended);
+    const __m512i vBreach = _mm512_set1_epi64(ExboWarn_ExcessCostLimitBreach);
+    const __m512i vOverflow = _mm512_set1_epi64(ExboWarn_ExcessCostLimitBreachWithDebtOverflow);
+    const __m512i one = _mm512_set1_epi64((int64_t)1);
+    const __m512d zeroReal = _mm512_setzero_pd();
+    const __m512d vAReal = _mm512_set1_pd((double)A);
+    const __m512d vC = _mm512_set1_pd(tabulated ? table->c : 0.0);
+    const __m512d vLast = _mm512_set1_pd(tabulated ? (double)table->last : 0.0);
+    const __m512d vLastM = _mm512_set1_pd(tabulated ? table->values[table->last] : 0.0);
+    const double *m = tabulated ? table->values : (const double *)0;
+    const double *factor = tabulated ? (table->values + table->size) : (const double *)0;
+    int64_t warnings[8];
+    size_t k;
+    for (k = 0; k + 8 <= n; k += 8) {
+        __m512i T_in = _mm512_loadu_si512((const void *)&T[k]);
+        __m512i D_in = _mm512_loadu_si512((const void *)&D[k]);
+        __m512i I_in = _mm512_loadu_si512((const void *)&I[k]);
+        __m512i T_out = _mm512_loadu_si512((const void *)&time[k]);
+        __mmask8 prior = _mm512_cmpgt_epi64_mask(T_in, T_out);
+        __m512i T_diff = _mm512_sub_epi64(T_out, T_in);
+        __mmask8 T_ok = _mm512_cmpge_epi64_mask(T_diff, zero);
+        __mmask8 early = T_ok & _mm512_cmpgt_epi64_mask(I_in, T_diff);
+        __mmask8 owing = T_ok & _mm512_cmpgt_epi64_mask(D_in, T_diff);
+        __m512i D_out = _mm512_add_epi64(_mm512_maskz_sub_epi64(owing, D_in, T_diff), vA);
+        __mmask8 D_overflow = _mm512_cmpgt_epi64_mask(vA, D_out);
+        D_out = _mm512_mask_blend_epi64(D_overflow, D_out, vMax);
+        __mmask8 breach = _mm512_cmpgt_epi64_mask(D_out, vL) | D_overflow;
+        __mmask8 under = _mm512_cmpgt_epi64_mask(vL, D_out);
+        __m512i I_out = _mm512_mask_blend_epi64(breach, vA, _mm512_sub_epi64(D_out, vLminusA));
+        __mmask8 lookup = (__mmask8)0;
+        if (tabulated && (under != (__mmask8)0)) {
+            // Bracket J as z_J() does, within the table, and bisect all
+            // lanes together.  Lanes whose J is not tabulated are left to
+            // zBatchElement().
+            __m512d excess = _mm512_cvtepi64_pd(_mm512_sub_epi64(vL, D_out));
+            __m512d l = _mm512_div_pd(excess, vAReal);
+            lookup = under & _mm512_cmp_pd_mask(vLastM, l, _CMP_GE_OQ);
+            __m512d J_lowReal = _mm512_sub_pd(_mm512_ceil_pd(l), _mm512_set1_pd(1.0));
+            __m512i J_low = _mm512_cvttpd_epi64(_mm512_min_pd(_mm512_max_pd(J_lowReal, zeroReal), vLast));
+            __m512d J_highReal = _mm512_ceil_pd(_mm512_add_pd(l, vC));
+            __m512i J_high = _mm512_cvttpd_epi64(_mm512_min_pd(_mm512_max_pd(J_highReal, zeroReal), vLast));
+            __mmask8 active = lookup & _mm512_cmplt_epi64_mask(J_low, J_high);
+            // Without optimization, GCC's gather macros narrow their mask.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+            while (active != (__mmask8)0) {
+                __m512i J_try = _mm512_add_epi64(J_low, _mm512_srli_epi64(_mm512_sub_epi64(J_high, J_low), 1));
+                __m512d m_J = _mm512_mask_i64gather_pd(zeroReal, active, J_try, m, 8);
+                __mmask8 below = active & _mm512_cmp_pd_mask(m_J, l, _CMP_LE_OQ);
+                __mmask8 above = active & _mm512_cmp_pd_mask(m_J, l, _CMP_GE_OQ);
+                J_low = _mm512_mask_add_epi64(J_low, below, J_try, one);
+                J_high = _mm512_mask_mov_epi64(J_high, above, J_try);
+                active = lookup & _mm512_cmplt_epi64_mask(J_low, J_high);
+            }
+            __m512d f = _mm512_mask_i64gather_pd(zeroReal, lookup, J_high, factor, 8);
+#pragma GCC diagnostic pop
+            __m512d v = _mm512_mul_pd(_mm512_sub_pd(_mm512_mul_pd(_mm512_cvtepi64_pd(J_high), vAReal), excess), f);
+            __mmask8 positive = _mm512_cmp_pd_mask(v, zeroReal, _CMP_GT_OQ);
+            __m512i I_lookup = _mm512_mask_blend_epi64(positive, one, _mm512_cvttpd_epi64(_mm512_ceil_pd(v)));
+            I_out = _mm512_mask_blend_epi64(lookup, I_out, I_lookup);
+        }
+        __m512i warning = _mm512_maskz_mov_epi64(early, vEarly);
+        warning = _mm512_mask_blend_epi64(breach, warning, vBreach);
+        warning = _mm512_mask_blend_epi64(D_overflow, warning, vOverflow);
+        __mmask8 scalar = prior | (under & solve & (__mmask8)~lookup);
+        _mm512_storeu_si512((void *)&T[k], _mm512_mask_blend_epi64(scalar, T_out, T_in));
+        _mm512_storeu_si512((void *)&D[k], _mm512_mask_blend_epi64(scalar, D_out, D_in));
+        _mm512_storeu_si512((void *)&I[k], _mm512_mask_blend_epi64(scalar, I_out, I_in));
+        _mm512_storeu_si512((void *)warnings, warning);
+        int j;
+        for (j = 0; j < 8; j++) {
+            if (scalar & (1u << j)) {
+                results[k + (size_t)j] = zBatchElement(config, &T[k + (size_t)j], &D[k + (size_t)j],
+                                                       &I[k + (size_t)j], time[k + (size_t)j]);
+            } else {
+                results[k + (size_t)j] = (int)warnings[j];
+                Z_STATS(0, (int)warnings[j], D[k + (size_t)j], I[k + (size_t)j]);
+            }
+        }
+    }
+    zBatchScalar(config, n - k, &T[k], &D[k], &I[k], &time[k], &results[k]);
+    return;
+}
+#endif
+
+/***********************
+* Recording atomically *
+***********************/
+static int zAtomicRecordAttempt(struct atomicState *p, const struct config *config, int64_t time, int64_t *waitp,
+                                int *warningp) {
+    // Assert: p != (struct atomicState *)0
+    // Assert: config != (struct config *)0
+    // Assert: config->isFinished
+    // Record on a private copy of the state, then swap it in if no other
+    // writer got there first; otherwise try again on what that writer left.
+    // If waitp is given, first check that the next attempt time is reached.
+    int result;
+    struct state expected;
+    struct state desired;
+    *warningp = 0;
+    desired.D = (int64_t)0;
+    desired.I = (int64_t)0;
+    if ((result = zAtomicLoad(p, (const struct config *)0, &expected)) == 0) {
+        for (;;) {
+            desired = expected;
+            // I only matters if T_diff < I, and I <= D.  Otherwise 0
+            // stands in for it.
+            if ((time < desired.T) || ((uint64_t)time - (uint64_t)desired.T < (uint64_t)desired.D)) {
+                if ((result = zStateInterval(config, desired.D, &desired.I)) > 0) {
+                    break;
+                }
+            }
+            if (waitp != (int64_t *)0) {
+                int64_t next = zStateGetNextAttemptTime(&desired);
+                if (next < Exbo_MinimumTime) {
+                    // Report the error from zStateGetNextAttemptTime()
+                    result = (int)(next - INT64_MIN);
+                    break;
+                }
+                if (!zReady(next, time, waitp)) {
+                    // The state is left unchanged
+                    result = ExboErr_AttemptNotReady;
+                    break;
+                }
+            }
+            if ((result = zStateRecordAttemptWarning(&desired, config, time, warningp)) != 0) {
+                // The error is reported against the state as it was loaded.
+                break;
+            }
+            if (zAtomicCompareExchange(p, &expected, &desired)) {
+                break;
+            }
+        }
+    }
+    // Only the attempt that was swapped in is counted.
+    Z_STATS(result, *warningp, desired.D, desired.I);
+    return result;
+}
+
+static int zAtomicLoad(struct atomicState *p, const struct config *config, struct state *statep) {
+    // Load T and D together, and also compute I if a config is given.
+    int result;
+    struct state expected;
+    expected.T = (int64_t)0;
+    expected.D = (int64_t)0;
+    expected.I = (int64_t)0;
+#if Z_ATOMIC != 0
+    // Swapping zero for zero returns the current state without changing it.
+    (void)zAtomicCompareExchange(p, &expected, &expected);
+    result = 0;
+#else
+    result = ExboErr_AtomicUnsupported;
+#endif
+    if ((result == 0) && (config != (const struct config *)0) && (expected.D >= config->A)) {
+        int r = zStateInterval(config, expected.D, &expected.I);
+        if (r > 0) {
+            result = r;
+        }
+    }
+    *statep = expected;
+    return result;
+}
+
+#if Z_ATOMIC == 1
+__attribute__((target("cx16")))
+#endif
+static int zAtomicCompareExchange(struct atomicState *p, struct state *expectedp, const struct state *desiredp) {
+    // Swap desired T and D into *p if it holds the expected T and D.
+    // Otherwise, load what it does hold into the expected state.
+    int result;
+#if Z_ATOMIC == 1
+    zAtomicWord expected = ((zAtomicWord)(uint64_t)expectedp->D << 64) | (zAtomicWord)(uint64_t)expectedp->T;
+    zAtomicWord desired = ((zAtomicWord)(uint64_t)desiredp->D << 64) | (zAtomicWord)(uint64_t)desiredp->T;
+    zAtomicWord actual = __sync_val_compare_and_swap((zAtomicWord *)(void *)p, expected, desired);
+    result = (actual == expected);
+    if (!result) {
+        expectedp->T = (int64_t)(uint64_t)actual;
+        expectedp->D = (int64_t)(uint64_t)(actual >> 64);
+    }
+#elif Z_ATOMIC == 2
+    struct atomicState expected;
+    struct atomicState desired;
+    expected.T = expectedp->T;
+    expected.D = expectedp->D;
+    desired.T = desiredp->T;
+    desired.D = desiredp->D;
+    result = __atomic_compare_exchange(p, &expected, &desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    if (!result) {
+        expectedp->T = expected.T;
+        expectedp->D = expected.D;
+    }
+#else
+    // Not reached: zAtomicLoad() reports ExboErr_AtomicUnsupported.
+    (void)p;
+    (void)expectedp;
+    (void)desiredp;
+    result = 1;
+#endif
+    return result;
+}
+
+/**********************
+* Counting statistics *
+**********************/
+static void zStatsCountInto(exboStats *sp, int result, int warning, int64_t D, int64_t I) {
+    // Assert: sp != (exboStats *)0
+    // Assert: warning is 0 or an ExboWarn_*
+    // Assert: if result == 0, D >= 0 and I >= 0
+    if (result == 0) {
+        zStatsAdd(&sp->records);
+        zStatsAdd(&sp->warnings[-warning]);
+        zStatsAdd(&sp->intervals[zStatsBucket(I)]);
+        zStatsAdd(&sp->debts[zStatsBucket(D)]);
+    } else if (result == ExboErr_AttemptNotReady) {
+        zStatsAdd(&sp->notReady);
+    } else {
+        zStatsAdd(&sp->errors);
+    }
+    return;
+}
+
+static void zStatsAdd(int64_t *counter) {
+    // Only one thread writes a counter at a time, so it need not be
+    // locked; the relaxed atomics only keep a concurrent reader from
+    // tearing it.
+#ifdef __GNUC__
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+#else
+    *counter += (int64_t)1;
+#endif
+    return;
+}
+
+static int zStatsBucket(int64_t value) {
+    // Assert: value >= 0
+    int result;
+#ifdef __GNUC__
+    result = (value > 0) ? 64 - __builtin_clzll((unsigned long long)value) : 0;
+#else
+    for (result = 0; value > 0; result++) {
+        value >>= 1;
+    }
+#endif
+    return result;
+}
+
+#if EXBO_STATS
+static void zStatsCount(int result, int warning, int64_t D, int64_t I) {
+    struct statsBlock *block = zStatsMine;
+    if (block == (struct statsBlock *)0) {
+        block = zStatsClaim();
+    }
+    if (block != (struct statsBlock *)0) {
+        zStatsCountInto(&block->stats, result, warning, D, I);
+    }
+    return;
+}
+
+static struct statsBlock *zStatsClaim(void) {
+    // Claim a block released by a thread that exited, or else a new one.
+    struct statsBlock *block;
+    (void)pthread_once(&zStatsOnce, zStatsCreateKey);
+    for (block = __atomic_load_n(&zStatsBlocks, __ATOMIC_ACQUIRE); block != (struct statsBlock *)0;
+         block = block->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&block->inUse, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (block == (struct statsBlock *)0) {
+        block = (struct statsBlock *)calloc((size_t)1, sizeof(*block));
+        if (block != (struct statsBlock *)0) {
+            block->inUse = 1;
+            block->next = __atomic_load_n(&zStatsBlocks, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&zStatsBlocks, &block->next, block, 0, __ATOMIC_RELEASE,
+                                                __ATOMIC_RELAXED)) {
+                // block->next now holds the newer head
+            }
+        }
+    }
+    if (block != (struct statsBlock *)0) {
+        // Without a key, the block stays claimed after the thread exits.
+        if (zStatsHasKey) {
+            (void)pthread_setspecific(zStatsKey, (const void *)block);
+        }
+        zStatsMine = block;
+    }
+    return block;
+}
+
+static void zStatsCreateKey(void) {
+    zStatsHasKey = (pthread_key_create(&zStatsKey, zStatsRelease) == 0);
+    return;
+}
+
+static void zStatsRelease(void *block) {
+    // Assert: block was claimed by this thread, which is exiting
+    zStatsMine = (struct statsBlock *)0;
+    __atomic_store_n(&((struct statsBlock *)block)->inUse, 0, __ATOMIC_RELEASE);
+    return;
+}
+
+static void zStatsMerge(exboStats *sp, const exboStats *from) {
+    int b;
+    sp->records += __atomic_load_n(&from->records, __ATOMIC_RELAXED);
+    sp->errors += __atomic_load_n(&from->errors, __ATOMIC_RELAXED);
+    sp->notReady += __atomic_load_n(&from->notReady, __ATOMIC_RELAXED);
+    for (b = 0; b < ExboWarn_COUNT; b++) {
+        sp->warnings[b] += __atomic_load_n(&from->warnings[b], __ATOMIC_RELAXED);
+    }
+    for (b = 0; b < Exbo_StatsBuckets; b++) {
+        sp->intervals[b] += __atomic_load_n(&from->intervals[b], __ATOMIC_RELAXED);
+        sp->debts[b] += __atomic_load_n(&from->debts[b], __ATOMIC_RELAXED);
+    }
+    return;
+}
+#endif
+
+/********************
+* Taking a snapshot *
+********************/
+static void zSnapshotWrite(const struct instance *p, unsigned char *bytes) {
+    // Assert: p != (struct instance *)0
+    // Assert: bytes holds Exbo_SnapshotSize bytes
+    const struct config *config = &p->config;
+    uint64_t X;
+    uint32_t flags = (uint32_t)config->isFinished | ((uint32_t)config->isValid << 1)
+                     | ((uint32_t)config->has_X << 2) | ((uint32_t)config->has_A << 3)
+                     | ((uint32_t)config->has_L << 4) | ((uint32_t)config->engine << 5)
+                     | ((uint32_t)config->jitter << 6) | ((uint32_t)config->hasSeed << 8);
+    memcpy((void *)&X, (const void *)&config->X, sizeof(X));
+    zPut32(bytes, Z_SNAPSHOT_MAGIC);
+    zPut32(&bytes[Z_SNAPSHOT_VERSION_AT], Z_SNAPSHOT_VERSION);
+    zPut32(&bytes[Z_SNAPSHOT_FLAGS], flags);
+    zPut64(&bytes[Z_SNAPSHOT_X], X);
+    zPut64(&bytes[Z_SNAPSHOT_A], (uint64_t)config->A);
+    zPut64(&bytes[Z_SNAPSHOT_L], (uint64_t)config->L);
+    zPut64(&bytes[Z_SNAPSHOT_T], (uint64_t)p->state.T);
+    zPut64(&bytes[Z_SNAPSHOT_D], (uint64_t)p->state.D);
+    zPut64(&bytes[Z_SNAPSHOT_I], (uint64_t)p->state.I);
+    zPut32(&bytes[Z_SNAPSHOT_TABLE_SIZE],
+           (config->table != (struct table *)0) ? (uint32_t)config->table->size : UINT32_C(0));
+    zPut64(&bytes[Z_SNAPSHOT_SEED], config->seed);
+    zPut32(&bytes[Z_SNAPSHOT_RESERVED], UINT32_C(0));
+    zPut32(&bytes[Z_SNAPSHOT_CHECKSUM], zChecksum(bytes, (size_t)Z_SNAPSHOT_CHECKSUM));
+    return;
+}
+
+static int zSnapshotRead(struct instance *p, const unsigned char *bytes) {
+    // Assert: p != (struct instance *)0
+    // Assert: bytes holds Exbo_SnapshotSize bytes
+    // The checksum vouches for the config, which was valid when it was
+    // written, so it is not validated again in full; only the invariants
+    // the engines rely on are checked, and a table is rebuilt.
+    int result;
+    uint32_t flags = zGet32(&bytes[Z_SNAPSHOT_FLAGS]);
+    if ((zGet32(bytes) == Z_SNAPSHOT_MAGIC) && (zGet32(&bytes[Z_SNAPSHOT_VERSION_AT]) == Z_SNAPSHOT_VERSION)
+            && ((flags & ~Z_SNAPSHOT_FLAGS_KNOWN) == UINT32_C(0)) && (zGet32(&bytes[Z_SNAPSHOT_RESERVED]) == UINT32_C(0))
+            && (zGet32(&bytes[Z_SNAPSHOT_CHECKSUM]) == zChecksum(bytes, (size_t)Z_SNAPSHOT_CHECKSUM))) {
+        struct config config;
+        uint64_t X = zGet64(&bytes[Z_SNAPSHOT_X]);
+        int64_t tableSize = (int64_t)zGet32(&bytes[Z_SNAPSHOT_TABLE_SIZE]);
+        int64_t D = (int64_t)zGet64(&bytes[Z_SNAPSHOT_D]);
+        int64_t I = (int64_t)zGet64(&bytes[Z_SNAPSHOT_I]);
+        zConfigInit(&config);
+        config.isFinished = flags & 1u;
+        config.isValid = (flags >> 1) & 1u;
+        config.has_X = (flags >> 2) & 1u;
+        config.has_A = (flags >> 3) & 1u;
+        config.has_L = (flags >> 4) & 1u;
+        config.engine = (flags >> 5) & 1u;
+        config.jitter = (flags >> 6) & 3u;
+        config.hasSeed = (flags >> 8) & 1u;
+        config.seed = zGet64(&bytes[Z_SNAPSHOT_SEED]);
+        memcpy((void *)&config.X, (const void *)&X, sizeof(X));
+        config.A = (int64_t)zGet64(&bytes[Z_SNAPSHOT_A]);
+        config.L = (int64_t)zGet64(&bytes[Z_SNAPSHOT_L]);
+        if (zSnapshotPlausible(&config, D, I)) {
+            if ((result = zConfigSetTableSize(&config, tableSize)) == 0) {
+                if (config.isFinished) {
+                    result = zTableBuild(&config);
                 }
-            } else {
-                // T + D overflowed
-                result = INT64_MIN + ExboErr_PayBackTimeOverflow;
             }
         } else {
-            // D should not be negative
-            result = INT64_MIN + ExboErr_StateWithNegativeD;
+            result = ExboErr_SnapshotCorrupt;
+        }
+        if (result == 0) {
+            zConfigFini(&p->config);
+            p->config = config;
+            p->state.T = (int64_t)zGet64(&bytes[Z_SNAPSHOT_T]);
+            p->state.D = D;
+            p->state.I = I;
+        } else {
+            // The instance is left as it was.
+            zConfigFini(&config);
         }
     } else {
-        // There is no instance structure
-        result = INT64_MIN + ExboErr_NoInstance;
+        result = ExboErr_SnapshotCorrupt;
     }
     return result;
 }
 
-const char *exboGetNanErrorMessage(double nanErrorNumber) {
-    const char *result;
-    if (isnan(nanErrorNumber)) {
-        // extract the error number from the NaN
-        uint64_t nanErrorNumberHex = *((uint64_t *)(&nanErrorNumber));
-        int errorNumber = (int)(0x7ffffff & nanErrorNumberHex);
-        result = zErrMessages[errorNumber];
+static int zSnapshotPlausible(const struct config *config, int64_t D, int64_t I) {
+    // Assert: config != (struct config *)0
+    // The cheap invariants of a finished or validated config, whose
+    // breach would have the engines divide by zero or search forever,
+    // and the signs of the state.
+    int result;
+    if ((config->jitter <= (unsigned int)ExboJitter_Decorrelated) && (D >= (int64_t)0) && (I >= (int64_t)0)) {
+        if (config->isFinished && !(config->has_X && config->has_A && config->has_L)) {
+            result = 0;
+        } else if (config->isFinished || config->isValid) {
+            result = (!config->has_X || (isfinite(config->X) && (config->X >= 1.0)))
+                     && (!config->has_A || (config->A > (int64_t)0)) && (!config->has_L || (config->L > (int64_t)0))
+                     && (!(config->has_A && config->has_L) || (config->L >= config->A));
+        } else {
+            result = 1;
+        }
     } else {
-        result = zErrMessageNotError;
+        result = 0;
     }
     return result;
 }
 
-const char *exboGetTimeErrorMessage(int64_t timeErrorNumber) {
-    const char *result;
-    if (timeErrorNumber < Exbo_MinimumTime) {
-        int errorNumber = (int)(timeErrorNumber - INT64_MIN);
-        result = zErrMessages[errorNumber];
-    } else {
-        result = zErrMessageNotError;
+static uint32_t zChecksum(const unsigned char *bytes, size_t length) {
+    // FNV-1a
+    uint32_t hash = UINT32_C(0x811c9dc5);
+    size_t i;
+    for (i = 0; i < length; i++) {
+        hash ^= (uint32_t)bytes[i];
+        hash *= UINT32_C(0x01000193);
     }
-    return result;
+    return hash;
 }
 
-const char *exboGetErrorMessage(int errorNumber) {
-    const char *result;
-    if (errorNumber >= 0) {
-        if (errorNumber < ExboErr_MAXIMUM) {
-            result = zErrMessages[errorNumber];
-        } else {
-            result = zErrMessageMaximum;
-        }
-    } else {
-        result = zErrMessageNegative;
+static void zPut32(unsigned char *bytes, uint32_t value) {
+    int i;
+    for (i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
     }
-    return result;
+    return;
 }
 
-/*********************************
- * internal function definitions
- *********************************/
+static void zPut64(unsigned char *bytes, uint64_t value) {
+    int i;
+    for (i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return;
+}
 
-/***********************
-* Managing an instance *
-***********************/
-static struct instance *zInstanceCreate(void) {
-    struct instance *result;
-    struct instance *p = (struct instance *)malloc(sizeof(*p));
-    if (p != (struct instance *)0) {
-        p->T = INT64_MIN;
-        p->D = (int64_t)0;
-        p->I = (int64_t)0;
-        p->config = zConfigCreate();
-        if (p->config != (struct config *)0) {
-            result = p;
-        } else {
-            zInstanceDestroy(p);
-            result = (struct instance *)0;
-        }
-    } else {
-        result = (struct instance *)0;
+static uint32_t zGet32(const unsigned char *bytes) {
+    uint32_t result = UINT32_C(0);
+    int i;
+    for (i = 3; i >= 0; i--) {
+        result = (result << 8) | (uint32_t)bytes[i];
     }
     return result;
 }
 
-static void zInstanceDestroy(struct instance *p) {
-    if (p != (struct instance *)0) {
-        zConfigDestroy(p->config);
-        p->config = (struct config *)0;
-        p->D = (int64_t)0;
-        p->I = (int64_t)0;
-        p->T = (int64_t)0;
-        free((void *)p);
+static uint64_t zGet64(const unsigned char *bytes) {
+    uint64_t result = UINT64_C(0);
+    int i;
+    for (i = 7; i >= 0; i--) {
+        result = (result << 8) | (uint64_t)bytes[i];
     }
-    return;
+    return result;
 }
 
 /***************************
 * Managing a configuration *
 ***************************/
-static struct config *zConfigCreate() {
-    struct config *p = (struct config *)malloc(sizeof(*p));
-    if (p != (struct config *)0) {
-        zConfigInit(p);
-    }
-    return p;
-}
-
-static void zConfigDestroy(struct config *p) {
+static struct config *zConfigCreate(double X, int64_t A, int64_t L, int64_t tableSize) {
+    struct config *result;
+    struct config *p = (struct config *)zBlockGet();
     if (p != (struct config *)0) {
         zConfigInit(p);
-        free((void *)p);
+        p->has_X = 1;
+        p->X = X;
+        p->has_A = 1;
+        p->A = A;
+        p->has_L = 1;
+        p->L = L;
+        if ((zConfigSetTableSize(p, tableSize) == 0) && (zConfigFinish(p) == 0)) {
+            result = p;
+        } else {
+            zConfigFini(p);
+            zBlockPut((void *)p);
+            result = (struct config *)0;
+        }
+    } else {
+        result = (struct config *)0;
     }
-    return;
+    return result;
 }
 
 static void zConfigInit(struct config *p) {
@@ -754,12 +2722,62 @@ static void zConfigInit(struct config *p) {
     p->has_X = 0;
     p->has_A = 0;
     p->has_L = 0;
+    p->engine = EXBO_DEFAULT_ENGINE;
+    p->jitter = ExboJitter_None;
+    p->hasSeed = 0;
+    p->seed = UINT64_C(0);
     p->X = (double)0.0;
     p->A = (int64_t)0;
     p->L = (int64_t)0;
+    p->table = (struct table *)0;
+    return;
+}
+
+static void zConfigFini(struct config *p) {
+    // Assert: p != (struct config *)0
+    if (p->table != (struct table *)0) {
+        zFree((void *)p->table, Z_TABLE_BYTES(p->table->size));
+    }
+    zConfigInit(p);
     return;
 }
 
+static int zConfigSetTableSize(struct config *p, int64_t tableSize) {
+    // Assert: p != (struct config *)0
+    // Assert: p->isFinished == 0
+    int result;
+    if (tableSize == (int64_t)0) {
+        // The table is disabled.
+        if (p->table != (struct table *)0) {
+            zFree((void *)p->table, Z_TABLE_BYTES(p->table->size));
+        }
+        p->table = (struct table *)0;
+        result = 0;
+    } else if ((tableSize >= (int64_t)2) && (tableSize <= Exbo_MaximumTableSize)) {
+        // A table of the same size is reused; its values are rebuilt anyway.
+        struct table *table = p->table;
+        if ((table == (struct table *)0) || (table->size != tableSize)) {
+            table = (struct table *)zAllocate(Z_TABLE_BYTES(tableSize));
+            if ((table != (struct table *)0) && (p->table != (struct table *)0)) {
+                zFree((void *)p->table, Z_TABLE_BYTES(p->table->size));
+            }
+        }
+        if (table != (struct table *)0) {
+            table->size = tableSize;
+            table->last = (int64_t)0;
+            table->c = (double)0.0;
+            p->table = table;
+            result = 0;
+        } else {
+            // The old table, if any, is left in place.
+            result = ExboErr_OutOfMemory;
+        }
+    } else {
+        result = ExboErr_InvalidConfig_T1;
+    }
+    return result;
+}
+
 /*****************************
 * Validating a configuration *
 *****************************/
@@ -875,7 +2893,7 @@ static int zConfigFinish(struct config *p) {
                 // Assert: p->has_X + p->has_A + p->has_L == 3
                 p->isFinished = 1;
                 if ((r = zValidateFinish(p)) == 0) {
-                    result = 0;
+                    result = zTableBuild(p);
                     // all is well
                 } else {
                     p->isFinished = 0;
@@ -929,7 +2947,7 @@ static int zSetDefault_A(struct config *p) {
     if (p->has_L) {
         // L is set.
         // Choose A so that A * DEFAULT_L_OVER_A near enough equals L
-        p->A = (int64_t)ceil((double)(p->L) / DEFAULT_L_OVER_A);
+        p->A = p->L / DEFAULT_L_OVER_A + (int64_t)(p->L % DEFAULT_L_OVER_A != (int64_t)0);
     } else {
         // L is not set.
         p->A = DEFAULT_A;
@@ -977,6 +2995,43 @@ static int zValidateFinish(struct config *p) {
     return result;
 }
 
+static int zTableBuild(struct config *p) {
+    // Assert: p != (struct config *)0
+    // Assert: p->isFinished
+    int result = 0;
+    struct table *table = p->table;
+    if ((table != (struct table *)0) && (p->engine == ExboEngine_Double)) {
+        double X = p->X;
+        int64_t size = table->size;
+        double *m = table->values;
+        double *factor = table->values + size;
+        int64_t J;
+        for (J = (int64_t)0; J < size; J++) {
+            m[J] = (double)0.0;
+            factor[J] = (double)0.0;
+        }
+        table->last = (int64_t)0;
+        table->c = (X > 1.0) ? (1.0/(X - 1.0)) : (double)0.0;
+        // Both are computed as z_J() and zIntervalReal() compute them, so
+        // a lookup finds the same J and the same interval.  The search for
+        // J needs m(J) to increase, which rounding can undo only for X very
+        // close to 1; the table stops short of any such J.
+        for (J = (int64_t)1; (X > 1.0) && (J < size); J++) {
+            double m_J;
+            if ((result = z_m((double)J, X, &m_J)) != 0) {
+                break;
+            }
+            if (!(m_J > m[J - 1])) {
+                break;
+            }
+            m[J] = m_J;
+            factor[J] = (X - 1.0) / (pow(X, (double)J) - 1.0);
+            table->last = J;
+        }
+    }
+    return result;
+}
+
 /*********************************
 * interval computation functions *
 *********************************/
@@ -991,12 +3046,12 @@ static int zInterval(int64_t L, int64_t A, double X, int64_t D, int64_t *Ip) {
         // The excess cost limit is under-saturated.
         if (X > 1.0) {
             // The relaxation factor exceed 1.0
-            double l = (double)(L - D) / (double)A;
-            double j;
-            int r = z_J(l, X, &j);
+            double v;
+            int r = zIntervalReal((double)(L - D), A, X, &v);
             if (r <= 0) {
-                // Assert j >= 0.0
-                *Ip = (int64_t)ceil((double)A * pow(X, -j));
+                // The interval is positive, but v underflows to 0 when
+                // X^J overflows.
+                *Ip = (v > 0.0) ? (int64_t)ceil(v) : (int64_t)1;
             }
             result = r;
         } else {
@@ -1021,10 +3076,69 @@ static int zInterval(int64_t L, int64_t A, double X, int64_t D, int64_t *Ip) {
     return result;
 }
 
-static int z_J(double l, double X, double *jp) {
+static int zIntervalReal(double excess, int64_t A, double X, double *vp) {
+    // Assert excess == L - D > 0.0
+    // Assert X > 1.0
+    // Assert vp != (double *)0
+    double l = excess / (double)A;
+    double J;
+    int r = z_J(l, X, &J);
+    if (r <= 0) {
+        // Assert J > l
+        // The interval is A * X^-j where X^j = (X^J - 1)/((X - 1)(J - l)),
+        // so neither j nor its logarithms need to be computed.  Forming
+        // A * (J - l) as J * A - (L - D) keeps it exact for J == 1.
+        *vp = (J * (double)A - excess) * ((X - 1.0) / (pow(X, J) - 1.0));
+    }
+    return r;
+}
+
+static int zIntervalTabulated(const struct table *table, int64_t L, int64_t A, double X, int64_t D, int64_t *Ip) {
+    // Assert A <= D < L
+    // Assert table->size >= 2
+    // Assert Ip != (int64_t *)0
+    // This is zInterval() with z_J() searching the table and the factor
+    // (X - 1)/(X^J - 1) looked up, so that the result is the same.
+    int result;
+    const double *m = table->values;
+    const double *factor = table->values + table->size;
+    int64_t last = table->last;
+    double excess = (double)(L - D);
+    double l = excess / (double)A;
+    if ((last > (int64_t)0) && (m[last] >= l)) {
+        // J is tabulated: bracket it as z_J() does, then bisect.
+        int64_t J_low = (int64_t)ceil(l) - (int64_t)1;
+        if (J_low < (int64_t)0) {
+            J_low = (int64_t)0;
+        }
+        int64_t J_high = (int64_t)ceil(l + table->c);
+        if (J_high > last) {
+            J_high = last;
+        }
+        while (J_low < J_high) {
+            int64_t J_try = J_low + (J_high - J_low)/((int64_t)2);
+            if (m[J_try] <= l) {
+                J_low = J_try + (int64_t)1;
+            }
+            if (m[J_try] >= l) {
+                J_high = J_try;
+            }
+        }
+        double v = ((double)J_high * (double)A - excess) * factor[J_high];
+        *Ip = (v > 0.0) ? (int64_t)ceil(v) : (int64_t)1;
+        result = 0;
+    } else {
+        // With X == 1.0, or J past the table
+        result = zInterval(L, A, X, D, Ip);
+    }
+    return result;
+}
+
+static int z_J(double l, double X, double *Jp) {
     // Assert l >= 0.0;
     // Assert X > 1.0;
-    // Asset jp != (double *)0;
+    // Asset Jp != (double *)0;
+    // Find the least integer J with m(J) >= l.
     int result;
     int64_t J_low = (int64_t)ceil(l) - (int64_t)1;
     if (J_low < (int64_t)0) {
@@ -1032,7 +3146,30 @@ static int z_J(double l, double X, double *jp) {
     }
     int64_t J_high = (int64_t)ceil(l + 1.0/(X - 1.0));
     int loop_r = 0;
-    while (J_low < J_high) {
+    if (J_high - J_low > Z_J_NEWTON_SPAN) {
+        // Narrow the bracket to the integers around the real root of
+        // m(j) = l.  The bisection below settles any rounding doubt.
+        double j;
+        if ((loop_r = z_jRoot(l, X, &j)) == 0) {
+            int64_t J_seed = (int64_t)ceil(j);
+            double m_J;
+            if ((J_seed > J_low) && (J_seed < J_high)) {
+                if ((loop_r = z_m((double)J_seed, X, &m_J)) == 0) {
+                    if (m_J >= l) {
+                        J_high = J_seed;
+                        if ((loop_r = z_m((double)(J_seed - (int64_t)1), X, &m_J)) == 0) {
+                            if (m_J < l) {
+                                J_low = J_seed;
+                            }
+                        }
+                    } else {
+                        J_low = J_seed + (int64_t)1;
+                    }
+                }
+            }
+        }
+    }
+    while ((loop_r == 0) && (J_low < J_high)) {
         int64_t J_try = J_low + (J_high - J_low)/((int64_t)2);
         double m_J;
         if ((loop_r = z_m((double)J_try, X, &m_J)) != 0) {
@@ -1046,9 +3183,7 @@ static int z_J(double l, double X, double *jp) {
         }
     }
     if (loop_r == 0) {
-        double J = (double)J_high;
-        double mu = (pow(X, J) - 1.0)/((X - 1.0)*(J - l));
-        *jp = log(mu)/log(X);
+        *Jp = (double)J_high;
         result = 0;
     } else {
         result = loop_r;
@@ -1056,12 +3191,393 @@ static int z_J(double l, double X, double *jp) {
     return result;
 }
 
+static int z_jRoot(double l, double X, double *jp) {
+    // Assert l >= 0.0;
+    // Assert X > 1.0;
+    // Assert jp != (double *)0;
+    // Solve m(j) = l for real j by Newton's method.  m(j) - l is convex
+    // and increasing for j > 0, so after the first step the iterates
+    // descend monotonically onto the root.  The seed is the lesser of
+    // l + 1/(X - 1), the root for large l, and l + sqrt(2l/(X - 1)),
+    // which comes from the quadratic behaviour of m(j) for small j.
+    double c = 1.0/(X - 1.0);
+    double lnX = log(X);
+    double j = fmin(l + c, l + sqrt(2.0 * l * c));
+    int i;
+    for (i = 0; i < Z_J_NEWTON_STEPS; i++) {
+        double e = exp(-j * lnX);
+        double g = j - c * (1.0 - e) - l;
+        double dg = 1.0 - c * lnX * e;
+        if (!(dg > 0.0)) {
+            break;
+        }
+        double step = g / dg;
+        j -= step;
+        if (!(fabs(step) >= 0.25)) {
+            break;
+        }
+    }
+    *jp = j;
+    return 0;
+}
+
 static int z_m(double j, double X, double *vp) {
     // Assert: vp != (double *)0
     *vp = j - (1.0 - pow(X, -j))/(X - 1.0);
     return 0;
 }
 
+/*****************************************
+* integer interval computation functions *
+*****************************************/
+static int zIntervalInteger(int64_t L, int64_t A, const double *Xp, int64_t D, int64_t *Ip) {
+    // Assert D >= A
+    // Assert A > 0
+    // Assert L >= A
+    // Assert *Xp >= 1.0
+    // Assert Ip != (int64_t *)0
+    // This follows zInterval() and z_J(), with every real number held as
+    // a struct fixed.  Powers of X are carried as X^J - 1 so that nothing
+    // cancels when X is close to 1.
+    int result;
+    uint64_t bits;
+    memcpy((void *)&bits, (const void *)Xp, sizeof(bits));
+    if (D < L) {
+        // The excess cost limit is under-saturated.
+        if (bits != Z_BITS_OF_ONE) {
+            // The relaxation factor exceed 1.0
+            struct fixed one = {UINT64_C(1) << 63, (int64_t)-63};
+            struct fixed d;
+            struct fixed c;
+            zFixedFromDouble(Xp, &d);
+            zFixedMinusOne(&d, &d);
+            zFixedDiv(&one, &d, &c);
+            int64_t excess = L - D;
+            // Bracket J as z_J() does, bounding ceil(l + 1/(X - 1))
+            // above by ceil(l) + ceil(1/(X - 1)).
+            int64_t ceil_l = excess / A + (int64_t)(excess % A != (int64_t)0);
+            int64_t ceil_c = zFixedCeil(&c);
+            int64_t J_low = ceil_l - (int64_t)1;
+            if (J_low < (int64_t)0) {
+                J_low = (int64_t)0;
+            }
+            int64_t J_high = (ceil_c <= INT64_MAX - ceil_l) ? (ceil_l + ceil_c) : INT64_MAX;
+            // Find the least J in [J_low, J_high] with m(J) >= l, else
+            // J_high, as the bisection in z_J() does.  Rather than raise X
+            // to each J tried, lift J up from J_low by the powers of two
+            // below J_high - J_low, most first, carrying X^J - 1 along:
+            // each power X^(2^k) - 1 is squared up once.
+            struct fixed e;
+            int sign = 0;
+            int loop_r = 0;
+            zFixedPowMinusOne(&d, J_low, &e);
+            if (J_low < J_high) {
+                loop_r = z_mInteger(J_low, excess, A, &d, &e, &sign);
+            }
+            if ((loop_r == 0) && (sign < 0)) {
+                // m(J) < l up to J, which ends at most at J_high - 1.
+                struct fixed steps[63];
+                int64_t J = J_low;
+                int k = 0;
+                steps[0] = d;
+                while ((k < 62) && (((int64_t)1 << (k + 1)) <= J_high - J_low - (int64_t)1)) {
+                    zFixedSquareCompound(&steps[k], &steps[k + 1]);
+                    k++;
+                }
+                for (; (k >= 0) && (loop_r == 0); k--) {
+                    if (((int64_t)1 << k) <= J_high - (int64_t)1 - J) {
+                        struct fixed e_try;
+                        zFixedCompound(&e, &steps[k], &e_try);
+                        if ((loop_r = z_mInteger(J + ((int64_t)1 << k), excess, A, &d, &e_try, &sign)) == 0) {
+                            if (sign < 0) {
+                                J += (int64_t)1 << k;
+                                e = e_try;
+                            }
+                        }
+                    }
+                }
+                J_high = J + (int64_t)1;
+                zFixedCompound(&e, &d, &e);
+            } else {
+                // m(J_low) >= l, or the bracket is J_low alone
+                J_high = J_low;
+            }
+            if (loop_r == 0) {
+                // N = A * J - (L - D) = A * (J - l), carried in 128 bits
+                uint64_t hi;
+                uint64_t lo;
+                struct fixed v;
+                zMul64((uint64_t)A, (uint64_t)J_high, &hi, &lo);
+                hi -= (uint64_t)(lo < (uint64_t)excess);
+                lo -= (uint64_t)excess;
+                zFixedNormalize(hi, lo, (int64_t)0, &v);
+                // v = N * (X - 1) / (X^J - 1)
+                zFixedMul(&v, &d, &v);
+                zFixedDiv(&v, &e, &v);
+                *Ip = zFixedCeil(&v);
+                result = 0;
+            } else {
+                result = loop_r;
+            }
+        } else {
+            // The relaxation factor is 1.0
+            *Ip = A;
+            result = 0;
+        }
+    } else {
+        if (D == L) {
+            // The excess cost limit is saturated.
+            *Ip = A;
+            result = 0;
+        } else {
+            // The excess cost limit is over-saturated.
+            *Ip = D - (L - A);
+            result = ExboWarn_ExcessCostLimitBreach;
+        }
+    }
+    return result;
+}
+
+static int z_mInteger(int64_t J, int64_t excess, int64_t A, const struct fixed *dp, const struct fixed *ep,
+                      int *vp) {
+    // Assert: *ep is X^J - 1
+    // Assert: vp != (int *)0
+    // Set *vp to the sign of m(J) - l, where l = excess / A and d = X - 1.
+    // With e = X^J - 1, that is the sign of N * d * (1 + e) - A * e,
+    // where N = A * J - excess = A * (J - l).
+    uint64_t hi;
+    uint64_t lo;
+    zMul64((uint64_t)A, (uint64_t)J, &hi, &lo);
+    if ((hi == UINT64_C(0)) && (lo <= (uint64_t)excess)) {
+        *vp = -1;
+    } else {
+        struct fixed one = {UINT64_C(1) << 63, (int64_t)-63};
+        struct fixed n;
+        struct fixed a;
+        struct fixed e1;
+        hi -= (uint64_t)(lo < (uint64_t)excess);
+        lo -= (uint64_t)excess;
+        zFixedNormalize(hi, lo, (int64_t)0, &n);
+        zFixedNormalize(UINT64_C(0), (uint64_t)A, (int64_t)0, &a);
+        zFixedAdd(&one, ep, &e1);
+        zFixedMul(&n, dp, &n);
+        zFixedMul(&n, &e1, &n);
+        zFixedMul(&a, ep, &a);
+        *vp = zFixedCompare(&n, &a);
+    }
+    return 0;
+}
+
+/*************************
+* fixed point arithmetic *
+*************************/
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 zUint128;
+#endif
+
+static void zMul64(uint64_t a, uint64_t b, uint64_t *hip, uint64_t *lop) {
+#if defined(__SIZEOF_INT128__)
+    zUint128 product = (zUint128)a * (zUint128)b;
+    *hip = (uint64_t)(product >> 64);
+    *lop = (uint64_t)product;
+#else
+    uint64_t a_lo = a & UINT64_C(0xffffffff);
+    uint64_t a_hi = a >> 32;
+    uint64_t b_lo = b & UINT64_C(0xffffffff);
+    uint64_t b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+    uint64_t middle = (lo_lo >> 32) + (hi_lo & UINT64_C(0xffffffff)) + lo_hi;
+    *hip = hi_hi + (hi_lo >> 32) + (middle >> 32);
+    *lop = (middle << 32) | (lo_lo & UINT64_C(0xffffffff));
+#endif
+    return;
+}
+
+static uint64_t zDiv128(uint64_t hi, uint64_t lo, uint64_t d) {
+    // Assert: hi < d, so that the quotient fits in 64 bits
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)((((zUint128)hi << 64) | (zUint128)lo) / (zUint128)d);
+#else
+    uint64_t q = UINT64_C(0);
+    int i;
+    for (i = 0; i < 64; i++) {
+        uint64_t carry = hi >> 63;
+        hi = (hi << 1) | (lo >> 63);
+        lo <<= 1;
+        q <<= 1;
+        if (carry || (hi >= d)) {
+            hi -= d;
+            q |= UINT64_C(1);
+        }
+    }
+    return q;
+#endif
+}
+
+static int zLeadingZeros(uint64_t x) {
+    // Assert: x != 0
+    int result;
+#ifdef __GNUC__
+    result = __builtin_clzll((unsigned long long)x);
+#else
+    for (result = 0; (x >> (63 - result)) == UINT64_C(0); result++) {
+    }
+#endif
+    return result;
+}
+
+static void zFixedNormalize(uint64_t hi, uint64_t lo, int64_t e, struct fixed *rp) {
+    // Set *rp to (hi * 2^64 + lo) * 2^e, truncated to 64 bits.
+    int shift;
+    if (hi != UINT64_C(0)) {
+        shift = zLeadingZeros(hi);
+        rp->m = (shift > 0) ? ((hi << shift) | (lo >> (64 - shift))) : hi;
+        rp->e = e + (int64_t)(64 - shift);
+    } else if (lo != UINT64_C(0)) {
+        shift = zLeadingZeros(lo);
+        rp->m = lo << shift;
+        rp->e = e - (int64_t)shift;
+    } else {
+        rp->m = UINT64_C(0);
+        rp->e = (int64_t)0;
+    }
+    if (rp->e < Z_FIXED_MINIMUM_EXPONENT) {
+        // Flush what is negligible to zero.
+        rp->m = UINT64_C(0);
+        rp->e = (int64_t)0;
+    }
+    return;
+}
+
+static void zFixedFromDouble(const double *xp, struct fixed *rp) {
+    // Assert: *xp is finite and positive
+    // Decode the IEEE 754 bit pattern without floating point arithmetic.
+    uint64_t bits;
+    memcpy((void *)&bits, (const void *)xp, sizeof(bits));
+    int64_t exponent = (int64_t)((bits >> 52) & UINT64_C(0x7ff));
+    uint64_t mantissa = bits & ((UINT64_C(1) << 52) - UINT64_C(1));
+    if (exponent != (int64_t)0) {
+        mantissa |= UINT64_C(1) << 52;
+    } else {
+        exponent = (int64_t)1;
+    }
+    zFixedNormalize(UINT64_C(0), mantissa, exponent - (int64_t)1075, rp);
+    return;
+}
+
+static void zFixedMul(const struct fixed *ap, const struct fixed *bp, struct fixed *rp) {
+    uint64_t hi;
+    uint64_t lo;
+    zMul64(ap->m, bp->m, &hi, &lo);
+    zFixedNormalize(hi, lo, ap->e + bp->e, rp);
+    return;
+}
+
+static void zFixedDiv(const struct fixed *ap, const struct fixed *bp, struct fixed *rp) {
+    // Assert: bp->m != 0
+    // (a.m / 2) * 2^64 / b.m is below 2^64 since a.m < 2 * b.m.
+    uint64_t q = zDiv128(ap->m >> 1, ap->m << 63, bp->m);
+    zFixedNormalize(UINT64_C(0), q, ap->e - bp->e - (int64_t)63, rp);
+    return;
+}
+
+static void zFixedAdd(const struct fixed *ap, const struct fixed *bp, struct fixed *rp) {
+    if (ap->m == UINT64_C(0)) {
+        *rp = *bp;
+    } else if (bp->m == UINT64_C(0)) {
+        *rp = *ap;
+    } else {
+        const struct fixed *bigp = (ap->e >= bp->e) ? ap : bp;
+        const struct fixed *smallp = (ap->e >= bp->e) ? bp : ap;
+        int64_t shift = bigp->e - smallp->e;
+        uint64_t sum = bigp->m + ((shift < (int64_t)64) ? (smallp->m >> shift) : UINT64_C(0));
+        zFixedNormalize((uint64_t)(sum < bigp->m), sum, bigp->e, rp);
+    }
+    return;
+}
+
+static void zFixedMinusOne(const struct fixed *ap, struct fixed *rp) {
+    // Assert: *ap > 1
+    if (ap->e >= (int64_t)0) {
+        // The value is at least 2^63, so 1 is lost to truncation.
+        *rp = *ap;
+    } else {
+        zFixedNormalize(UINT64_C(0), ap->m - (UINT64_C(1) << -ap->e), ap->e, rp);
+    }
+    return;
+}
+
+static void zFixedPowMinusOne(const struct fixed *dp, int64_t n, struct fixed *rp) {
+    // Assert: n >= 0
+    // Set *rp to (1 + d)^n - 1 by squaring, using
+    // (1 + a)(1 + b) - 1 = a + b + ab, which never subtracts.
+    struct fixed a = *dp;
+    rp->m = UINT64_C(0);
+    rp->e = (int64_t)0;
+    while (n > (int64_t)0) {
+        if (n & (int64_t)1) {
+            zFixedCompound(rp, &a, rp);
+        }
+        n >>= 1;
+        if (n > (int64_t)0) {
+            zFixedSquareCompound(&a, &a);
+        }
+    }
+    return;
+}
+
+static void zFixedCompound(const struct fixed *ap, const struct fixed *bp, struct fixed *rp) {
+    // Set *rp to (1 + a)(1 + b) - 1 = ab + a + b.  rp may be ap or bp.
+    struct fixed t;
+    zFixedMul(ap, bp, &t);
+    zFixedAdd(&t, ap, &t);
+    zFixedAdd(&t, bp, rp);
+    return;
+}
+
+static void zFixedSquareCompound(const struct fixed *ap, struct fixed *rp) {
+    // Set *rp to (1 + a)^2 - 1 = a^2 + 2a.  rp may be ap.
+    struct fixed t;
+    struct fixed twice = *ap;
+    zFixedMul(ap, ap, &t);
+    twice.e += (int64_t)1;
+    zFixedAdd(&t, &twice, rp);
+    return;
+}
+
+static int zFixedCompare(const struct fixed *ap, const struct fixed *bp) {
+    int result;
+    if ((ap->m == UINT64_C(0)) || (bp->m == UINT64_C(0))) {
+        result = (int)(ap->m != UINT64_C(0)) - (int)(bp->m != UINT64_C(0));
+    } else if (ap->e != bp->e) {
+        result = (ap->e > bp->e) ? 1 : -1;
+    } else {
+        result = (int)(ap->m > bp->m) - (int)(ap->m < bp->m);
+    }
+    return result;
+}
+
+static int64_t zFixedCeil(const struct fixed *ap) {
+    int64_t result;
+    if (ap->m == UINT64_C(0)) {
+        result = (int64_t)0;
+    } else if (ap->e >= (int64_t)-1) {
+        // The value is at least 2^63.
+        result = INT64_MAX;
+    } else if (ap->e <= (int64_t)-64) {
+        // The value is positive and less than 1.
+        result = (int64_t)1;
+    } else {
+        uint64_t whole = ap->m >> -ap->e;
+        uint64_t part = ap->m & ((UINT64_C(1) << -ap->e) - UINT64_C(1));
+        result = (int64_t)whole + (int64_t)(part != UINT64_C(0));
+    }
+    return result;
+}
+
 /*********************************
  * The End
  *********************************/
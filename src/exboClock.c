@@ -0,0 +1,351 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The clocks need POSIX clock_gettime() and nanosleep(), beyond C99. */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <time.h>
+#include <exbo.h>
+
+/* The time stamp counter is read only where GCC can read it and ask the
+ * CPU whether it is invariant.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define Z_TSC 1
+#else
+#define Z_TSC 0
+#endif
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+#define Z_NANOSECONDS ((int64_t)1000000000)
+
+/* The default units: milliseconds, as for the default A */
+#define Z_DEFAULT_UNITS ((int64_t)1000)
+
+/* How long the time stamp counter is calibrated, in nanoseconds */
+#define Z_CALIBRATION ((int64_t)10000000)
+
+/* Bits of fraction in the clock units per counter tick */
+#define Z_TSC_SHIFT 32
+
+/* The coarse clock falls back to the precise one where there is none. */
+#if defined(CLOCK_MONOTONIC_COARSE)
+#define Z_CLOCK_COARSE CLOCK_MONOTONIC_COARSE
+#else
+#define Z_CLOCK_COARSE CLOCK_MONOTONIC
+#endif
+
+/*********************************
+ * internal struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* Everything exboClockNow() reads but the manual time.  The counter
+ * gives the time as base + ((tsc - tscBase) * perTick >> Z_TSC_SHIFT).
+ */
+struct clock {
+    int source;
+    int64_t units;
+    int64_t base;
+    uint64_t tscBase;
+    uint64_t perTick;
+};
+
+#if Z_TSC
+__extension__ typedef unsigned __int128 zUint128;
+#endif
+
+/*********************************
+ * internal data declarations
+ *********************************/
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static int64_t zRead(clockid_t id, int64_t units);
+static int zNow(const struct clock *p, int64_t *nowp);
+#if Z_TSC
+static int zTscIsInvariant(void);
+static uint64_t zTscRead(void);
+static int zTscCalibrate(struct clock *p);
+#endif
+
+/*********************************
+ * external data definitions
+ *********************************/
+
+/*********************************
+ * internal data definitions
+ *********************************/
+static struct clock zClock = {ExboClock_Monotonic, Z_DEFAULT_UNITS, (int64_t)0, UINT64_C(0), UINT64_C(0)};
+static int64_t zManualTime = (int64_t)0;
+
+/*********************************
+ * external function definitions
+ *********************************/
+int exboClockConfigure(int source, int64_t unitsPerSecond) {
+    int result;
+    if ((unitsPerSecond > (int64_t)0) && (unitsPerSecond <= Exbo_MaximumClockUnits)) {
+        struct clock clock = {0, (int64_t)0, (int64_t)0, UINT64_C(0), UINT64_C(0)};
+        clock.source = source;
+        clock.units = unitsPerSecond;
+        switch (source) {
+        case ExboClock_Monotonic:
+        case ExboClock_Coarse:
+        case ExboClock_Manual:
+            result = 0;
+            break;
+        case ExboClock_Tsc:
+#if Z_TSC
+            result = zTscCalibrate(&clock);
+#else
+            result = ExboErr_ClockUnsupported;
+#endif
+            break;
+        default:
+            result = ExboErr_InvalidClockSource;
+            break;
+        }
+        if (result == 0) {
+            zClock = clock;
+        }
+    } else {
+        result = ExboErr_InvalidClockUnits;
+    }
+    return result;
+}
+
+int exboClockGetSource(void) {
+    return zClock.source;
+}
+
+int64_t exboClockGetUnitsPerSecond(void) {
+    return zClock.units;
+}
+
+int64_t exboClockNow(void) {
+    int64_t now;
+    int r;
+    if ((r = zNow(&zClock, &now)) != 0) {
+        now = INT64_MIN + (int64_t)r;
+    }
+    return now;
+}
+
+int exboClockSet(int64_t now) {
+    int result;
+    if (now >= Exbo_MinimumTime) {
+#if defined(__GNUC__)
+        __atomic_store_n(&zManualTime, now, __ATOMIC_RELAXED);
+#else
+        zManualTime = now;
+#endif
+        result = 0;
+    } else {
+        // Such a time would read as an error
+        result = ExboErr_InvalidClockTime;
+    }
+    return result;
+}
+
+int exboRecordAttemptNow(exbo xp) {
+    int64_t now;
+    int result;
+    if ((result = zNow(&zClock, &now)) == 0) {
+        result = exboRecordAttempt(xp, now);
+    }
+    return result;
+}
+
+int exboTryAttemptNow(exbo xp, int64_t *waitp) {
+    int64_t now;
+    int result;
+    if ((result = zNow(&zClock, &now)) == 0) {
+        result = exboTryAttempt(xp, now, waitp);
+    }
+    return result;
+}
+
+int exboStateRecordAttemptNow(exboConfig cp, exboState *sp) {
+    int64_t now;
+    int result;
+    if ((result = zNow(&zClock, &now)) == 0) {
+        result = exboStateRecordAttempt(cp, sp, now);
+    }
+    return result;
+}
+
+int exboStateTryAttemptNow(exboConfig cp, exboState *sp, int64_t *waitp) {
+    int64_t now;
+    int result;
+    if ((result = zNow(&zClock, &now)) == 0) {
+        result = exboStateTryAttempt(cp, sp, now, waitp);
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboGetWaitNow(exbo xp) {
+    int64_t result = exboGetNextAttemptTime(xp);
+    if (result >= Exbo_MinimumTime) {
+        int64_t now;
+        int r;
+        if ((r = zNow(&zClock, &now)) == 0) {
+            // The difference may not fit; it is clamped to INT64_MAX.
+            uint64_t remaining = (uint64_t)result - (uint64_t)now;
+            if (result <= now) {
+                result = (int64_t)0;
+            } else if (remaining > (uint64_t)INT64_MAX) {
+                result = INT64_MAX;
+            } else {
+                result = (int64_t)remaining;
+            }
+        } else {
+            // Report the error from zNow()
+            result = INT64_MIN + (int64_t)r;
+        }
+    }
+    return result;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static int64_t zRead(clockid_t id, int64_t units) {
+    // Returns the time of clock id in units per second, or INT64_MIN.
+    // units * tv_nsec is at most 10^18, which fits.
+    struct timespec ts;
+    int64_t result;
+    if (clock_gettime(id, &ts) == 0) {
+        result = (int64_t)ts.tv_sec * units + (int64_t)ts.tv_nsec * units / Z_NANOSECONDS;
+    } else {
+        result = INT64_MIN;
+    }
+    return result;
+}
+
+static int zNow(const struct clock *p, int64_t *nowp) {
+    // Assert: p != (const struct clock *)0
+    // Assert: nowp != (int64_t *)0
+    int result;
+    int64_t now;
+    switch (p->source) {
+    case ExboClock_Coarse:
+        now = zRead(Z_CLOCK_COARSE, p->units);
+        break;
+#if Z_TSC
+    case ExboClock_Tsc:
+        now = p->base
+              + (int64_t)(((zUint128)(zTscRead() - p->tscBase) * (zUint128)p->perTick) >> Z_TSC_SHIFT);
+        break;
+#endif
+    case ExboClock_Manual:
+#if defined(__GNUC__)
+        now = __atomic_load_n(&zManualTime, __ATOMIC_RELAXED);
+#else
+        now = zManualTime;
+#endif
+        break;
+    default:
+        now = zRead(CLOCK_MONOTONIC, p->units);
+        break;
+    }
+    if (now >= Exbo_MinimumTime) {
+        *nowp = now;
+        result = 0;
+    } else {
+        // clock_gettime() failed
+        result = ExboErr_ClockUnsupported;
+    }
+    return result;
+}
+
+#if Z_TSC
+static int zTscIsInvariant(void) {
+    // CPUID leaf 0x80000007 reports an invariant counter in bit 8 of EDX.
+    unsigned int a;
+    unsigned int b;
+    unsigned int c;
+    unsigned int d;
+    int result = 0;
+    if (__get_cpuid(0x80000000u, &a, &b, &c, &d) && (a >= 0x80000007u)) {
+        if (__get_cpuid(0x80000007u, &a, &b, &c, &d)) {
+            result = ((d & (1u << 8)) != 0u);
+        }
+    }
+    return result;
+}
+
+static uint64_t zTscRead(void) {
+    return (uint64_t)__builtin_ia32_rdtsc();
+}
+
+static int zTscCalibrate(struct clock *p) {
+    // Assert: p->units is in range
+    // Count the ticks over Z_CALIBRATION nanoseconds of CLOCK_MONOTONIC,
+    // and start the counter's time where CLOCK_MONOTONIC's is.
+    int result;
+    if (zTscIsInvariant()) {
+        struct timespec pause = {0, (long)Z_CALIBRATION};
+        int64_t ns0 = zRead(CLOCK_MONOTONIC, Z_NANOSECONDS);
+        uint64_t tsc0 = zTscRead();
+        int64_t ns1;
+        uint64_t tsc1;
+        (void)nanosleep(&pause, (struct timespec *)0);
+        ns1 = zRead(CLOCK_MONOTONIC, Z_NANOSECONDS);
+        tsc1 = zTscRead();
+        if ((ns0 != INT64_MIN) && (ns1 > ns0) && (tsc1 > tsc0)) {
+            double unitsPerTick = (double)(ns1 - ns0) / (double)(tsc1 - tsc0) * (double)p->units
+                                  / (double)Z_NANOSECONDS;
+            p->perTick = (uint64_t)(unitsPerTick * (double)(UINT64_C(1) << Z_TSC_SHIFT) + 0.5);
+            p->tscBase = tsc1;
+            p->base = zRead(CLOCK_MONOTONIC, p->units);
+            result = (p->perTick != UINT64_C(0)) ? 0 : ExboErr_ClockUnsupported;
+        } else {
+            result = ExboErr_ClockUnsupported;
+        }
+    } else {
+        result = ExboErr_ClockUnsupported;
+    }
+    return result;
+}
+#endif
+
+/*********************************
+ * The End
+ *********************************/
@@ -0,0 +1,442 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <exbo.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+/* Keys are kept below 7/8 of the slots */
+#define Z_LOAD_NUMERATOR ((int64_t)7)
+#define Z_LOAD_DENOMINATOR ((int64_t)8)
+
+/* Largest byte-string key */
+#define Z_MAXIMUM_KEY_SIZE ((size_t)255)
+
+/* A control byte with its top bit set holds a key; 0 is an empty slot */
+#define Z_CONTROL_EMPTY ((unsigned char)0)
+#define Z_CONTROL_FULL ((unsigned char)0x80)
+
+/* Slots the reclaiming hand passes on each record */
+#define Z_SWEEP_STEP UINT64_C(2)
+
+/*********************************
+ * internal struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* For a registry of byte-string keys, key holds the hash of the bytes,
+ * which are kept at the same index in the registry's key arena.
+ */
+struct slot {
+    uint64_t key;
+    exboState state;
+};
+
+/* Slots are probed linearly from the hash, and removal shifts the rest
+ * of the probe run back, so there are no tombstones.  The control bytes
+ * hold 7 bits of the hash, so that a probe seldom touches a slot whose
+ * key does not match.
+ *
+ * A key whose debt is paid back by the latest time recorded is no
+ * different from a fresh one, so a clock hand sweeps a few slots on each
+ * record and removes such keys, and a full registry is swept whole
+ * before an insert gives up.
+ */
+struct registry {
+    exboConfig config;
+    uint64_t mask;          // number of slots - 1
+    int64_t count;
+    int64_t limit;          // largest count
+    int64_t now;            // latest time recorded
+    uint64_t hand;          // next slot to sweep
+    size_t keySize;         // 0 for 64-bit keys
+    unsigned char *control;
+    struct slot *slots;
+    unsigned char *keys;    // (1 + keySize) bytes per slot: length, bytes
+};
+
+/*********************************
+ * internal data declarations
+ *********************************/
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static uint64_t zHash64(uint64_t key);
+static uint64_t zHashBytes(const void *key, size_t length);
+static int64_t zLookup(const struct registry *p, uint64_t hash, uint64_t key, const void *bytes, size_t length);
+static int64_t zInsert(struct registry *p, uint64_t hash, uint64_t key, const void *bytes, size_t length);
+static int zRecord(struct registry *p, uint64_t hash, uint64_t key, const void *bytes, size_t length, int64_t now);
+static int zRemove(struct registry *p, int64_t index);
+static int64_t zSweep(struct registry *p, uint64_t steps);
+static int zKeyMatches(const struct registry *p, int64_t index, uint64_t key, const void *bytes, size_t length);
+static unsigned char zControl(uint64_t hash);
+
+/*********************************
+ * external data definitions
+ *********************************/
+
+/*********************************
+ * internal data definitions
+ *********************************/
+
+/*********************************
+ * external function definitions
+ *********************************/
+exboRegistry exboRegistryCreate(exboConfig cp, int64_t capacity, size_t keySize) {
+    exboRegistry result = (exboRegistry)0;
+    if ((cp != (exboConfig)0) && (capacity > (int64_t)0) && (keySize <= Z_MAXIMUM_KEY_SIZE)
+            && (capacity <= INT64_MAX / Z_LOAD_DENOMINATOR)) {
+        struct registry *p = (struct registry *)malloc(sizeof(*p));
+        if (p != (struct registry *)0) {
+            // Round the slots up to a power of two above capacity / load.
+            uint64_t slots = UINT64_C(8);
+            uint64_t needed = (uint64_t)((capacity * Z_LOAD_DENOMINATOR + Z_LOAD_NUMERATOR - (int64_t)1)
+                                         / Z_LOAD_NUMERATOR);
+            while (slots < needed) {
+                slots <<= 1;
+            }
+            p->config = cp;
+            p->mask = slots - UINT64_C(1);
+            p->count = (int64_t)0;
+            p->limit = (int64_t)slots / Z_LOAD_DENOMINATOR * Z_LOAD_NUMERATOR;
+            p->now = INT64_MIN;
+            p->hand = UINT64_C(0);
+            p->keySize = keySize;
+            p->control = (unsigned char *)calloc((size_t)slots, sizeof(unsigned char));
+            p->slots = (struct slot *)malloc((size_t)slots * sizeof(struct slot));
+            if (keySize != (size_t)0) {
+                p->keys = (unsigned char *)malloc((size_t)slots * ((size_t)1 + keySize));
+            } else {
+                p->keys = (unsigned char *)0;
+            }
+            if ((p->control != (unsigned char *)0) && (p->slots != (struct slot *)0)
+                    && ((keySize == (size_t)0) || (p->keys != (unsigned char *)0))) {
+                result = (exboRegistry)p;
+            } else {
+                exboRegistryDestroy((exboRegistry)p);
+            }
+        }
+    }
+    return result;
+}
+
+void exboRegistryDestroy(exboRegistry rp) {
+    struct registry *p = (struct registry *)rp;
+    if (p != (struct registry *)0) {
+        free((void *)p->keys);
+        free((void *)p->slots);
+        free((void *)p->control);
+        free((void *)p);
+    }
+    return;
+}
+
+int exboRegistryRecord(exboRegistry rp, uint64_t key, int64_t now) {
+    int result;
+    struct registry *p = (struct registry *)rp;
+    if (p != (struct registry *)0) {
+        if (p->keySize == (size_t)0) {
+            result = zRecord(p, zHash64(key), key, (const void *)0, (size_t)0, now);
+        } else {
+            // This registry holds byte-string keys
+            result = ExboErr_RegistryKeyType;
+        }
+    } else {
+        // There is no registry structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboRegistryRecordBytes(exboRegistry rp, const void *key, size_t length, int64_t now) {
+    int result;
+    struct registry *p = (struct registry *)rp;
+    if (p != (struct registry *)0) {
+        if ((p->keySize != (size_t)0) && ((key != (const void *)0) || (length == (size_t)0))) {
+            if (length <= p->keySize) {
+                uint64_t hash = zHashBytes(key, length);
+                result = zRecord(p, hash, hash, key, length, now);
+            } else {
+                result = ExboErr_RegistryKeyTooLong;
+            }
+        } else {
+            // This registry holds 64-bit keys
+            result = ExboErr_RegistryKeyType;
+        }
+    } else {
+        // There is no registry structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+const exboState *exboRegistryFind(exboRegistry rp, uint64_t key) {
+    const exboState *result = (const exboState *)0;
+    const struct registry *p = (const struct registry *)rp;
+    if ((p != (const struct registry *)0) && (p->keySize == (size_t)0)) {
+        int64_t index = zLookup(p, zHash64(key), key, (const void *)0, (size_t)0);
+        if (index >= (int64_t)0) {
+            result = &p->slots[index].state;
+        }
+    }
+    return result;
+}
+
+const exboState *exboRegistryFindBytes(exboRegistry rp, const void *key, size_t length) {
+    const exboState *result = (const exboState *)0;
+    const struct registry *p = (const struct registry *)rp;
+    if ((p != (const struct registry *)0) && (p->keySize != (size_t)0) && (length <= p->keySize)
+            && ((key != (const void *)0) || (length == (size_t)0))) {
+        uint64_t hash = zHashBytes(key, length);
+        int64_t index = zLookup(p, hash, hash, key, length);
+        if (index >= (int64_t)0) {
+            result = &p->slots[index].state;
+        }
+    }
+    return result;
+}
+
+int exboRegistryRemove(exboRegistry rp, uint64_t key) {
+    int result = 0;
+    struct registry *p = (struct registry *)rp;
+    if ((p != (struct registry *)0) && (p->keySize == (size_t)0)) {
+        result = zRemove(p, zLookup(p, zHash64(key), key, (const void *)0, (size_t)0));
+    }
+    return result;
+}
+
+int exboRegistryRemoveBytes(exboRegistry rp, const void *key, size_t length) {
+    int result = 0;
+    struct registry *p = (struct registry *)rp;
+    if ((p != (struct registry *)0) && (p->keySize != (size_t)0) && (length <= p->keySize)
+            && ((key != (const void *)0) || (length == (size_t)0))) {
+        uint64_t hash = zHashBytes(key, length);
+        result = zRemove(p, zLookup(p, hash, hash, key, length));
+    }
+    return result;
+}
+
+int64_t exboRegistryReclaim(exboRegistry rp, int64_t now) {
+    int64_t result;
+    struct registry *p = (struct registry *)rp;
+    if (p != (struct registry *)0) {
+        if (now > p->now) {
+            p->now = now;
+        }
+        result = zSweep(p, p->mask + UINT64_C(1));
+    } else {
+        // There is no registry structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int64_t exboRegistryGetCount(exboRegistry rp) {
+    int64_t result;
+    const struct registry *p = (const struct registry *)rp;
+    if (p != (const struct registry *)0) {
+        result = p->count;
+    } else {
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static uint64_t zHash64(uint64_t key) {
+    // The splitmix64 finalizer
+    key ^= key >> 30;
+    key *= UINT64_C(0xbf58476d1ce4e5b9);
+    key ^= key >> 27;
+    key *= UINT64_C(0x94d049bb133111eb);
+    key ^= key >> 31;
+    return key;
+}
+
+static uint64_t zHashBytes(const void *key, size_t length) {
+    // FNV-1a, finished with zHash64() to spread the low bits
+    const unsigned char *bytes = (const unsigned char *)key;
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    size_t i;
+    for (i = 0; i < length; i++) {
+        hash ^= (uint64_t)bytes[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return zHash64(hash ^ (uint64_t)length);
+}
+
+static unsigned char zControl(uint64_t hash) {
+    return (unsigned char)(Z_CONTROL_FULL | (unsigned char)(hash >> 57));
+}
+
+static int zKeyMatches(const struct registry *p, int64_t index, uint64_t key, const void *bytes, size_t length) {
+    int result;
+    if (p->slots[index].key != key) {
+        result = 0;
+    } else if (p->keySize == (size_t)0) {
+        result = 1;
+    } else {
+        const unsigned char *stored = &p->keys[(size_t)index * ((size_t)1 + p->keySize)];
+        result = ((size_t)stored[0] == length) && (memcmp((const void *)&stored[1], bytes, length) == 0);
+    }
+    return result;
+}
+
+static int64_t zLookup(const struct registry *p, uint64_t hash, uint64_t key, const void *bytes, size_t length) {
+    // Returns the index of the key's slot, or -1 if it is absent.
+    unsigned char control = zControl(hash);
+    uint64_t i = hash & p->mask;
+    int64_t result = (int64_t)-1;
+    while (p->control[i] != Z_CONTROL_EMPTY) {
+        if ((p->control[i] == control) && zKeyMatches(p, (int64_t)i, key, bytes, length)) {
+            result = (int64_t)i;
+            break;
+        }
+        i = (i + UINT64_C(1)) & p->mask;
+    }
+    return result;
+}
+
+static int64_t zInsert(struct registry *p, uint64_t hash, uint64_t key, const void *bytes, size_t length) {
+    // Assert: the key is absent
+    // Returns the index of the new slot, or -1 if the registry is full.
+    int64_t result;
+    if (p->count < p->limit) {
+        uint64_t i = hash & p->mask;
+        while (p->control[i] != Z_CONTROL_EMPTY) {
+            i = (i + UINT64_C(1)) & p->mask;
+        }
+        p->control[i] = zControl(hash);
+        p->slots[i].key = key;
+        exboStateInit(&p->slots[i].state);
+        if (p->keySize != (size_t)0) {
+            unsigned char *stored = &p->keys[(size_t)i * ((size_t)1 + p->keySize)];
+            stored[0] = (unsigned char)length;
+            if (length != (size_t)0) {
+                memcpy((void *)&stored[1], bytes, length);
+            }
+        }
+        p->count++;
+        result = (int64_t)i;
+    } else {
+        result = (int64_t)-1;
+    }
+    return result;
+}
+
+static int zRecord(struct registry *p, uint64_t hash, uint64_t key, const void *bytes, size_t length, int64_t now) {
+    int result;
+    int64_t index = zLookup(p, hash, key, bytes, length);
+    if (now > p->now) {
+        p->now = now;
+    }
+    if (index < (int64_t)0) {
+        if (p->count >= p->limit) {
+            // Make room from the keys that are paid back.
+            (void)zSweep(p, p->mask + UINT64_C(1));
+        }
+        index = zInsert(p, hash, key, bytes, length);
+    }
+    if (index >= (int64_t)0) {
+        // The key identifies the state to jitter, wherever its slot is.
+        result = exboStateRecordAttemptStream(p->config, &p->slots[index].state, now, hash);
+        // The key just recorded is in debt, so the sweep leaves it be.
+        (void)zSweep(p, Z_SWEEP_STEP);
+    } else {
+        result = ExboErr_RegistryFull;
+    }
+    return result;
+}
+
+static int zRemove(struct registry *p, int64_t index) {
+    // Empty the slot at index, then shift back any later slot of the
+    // probe run that may move closer to its home slot.
+    int result;
+    if (index >= (int64_t)0) {
+        uint64_t hole = (uint64_t)index;
+        uint64_t i = (hole + UINT64_C(1)) & p->mask;
+        size_t keyBytes = (size_t)1 + p->keySize;
+        while (p->control[i] != Z_CONTROL_EMPTY) {
+            uint64_t home = ((p->keySize == (size_t)0) ? zHash64(p->slots[i].key) : p->slots[i].key) & p->mask;
+            // Move the slot unless its home lies cyclically in (hole, i].
+            if (((i - home) & p->mask) >= ((i - hole) & p->mask)) {
+                p->control[hole] = p->control[i];
+                p->slots[hole] = p->slots[i];
+                if (p->keySize != (size_t)0) {
+                    memcpy((void *)&p->keys[(size_t)hole * keyBytes], (const void *)&p->keys[(size_t)i * keyBytes],
+                           keyBytes);
+                }
+                hole = i;
+            }
+            i = (i + UINT64_C(1)) & p->mask;
+        }
+        p->control[hole] = Z_CONTROL_EMPTY;
+        p->count--;
+        result = 1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+static int64_t zSweep(struct registry *p, uint64_t steps) {
+    // Move the hand over steps slots, removing the keys paid back by
+    // p->now, and return how many were removed.  A removal may shift
+    // the next key of the probe run under the hand, so the hand only
+    // moves on from a slot that it keeps.
+    int64_t result = (int64_t)0;
+    while (steps != UINT64_C(0)) {
+        uint64_t i = p->hand;
+        int64_t payBack;
+        if ((p->control[i] != Z_CONTROL_EMPTY)
+                && ((payBack = exboStateGetPayBackTime(&p->slots[i].state)) >= Exbo_MinimumTime)
+                && (payBack <= p->now)) {
+            result += (int64_t)zRemove(p, (int64_t)i);
+        } else {
+            p->hand = (i + UINT64_C(1)) & p->mask;
+            steps--;
+        }
+    }
+    return result;
+}
+
+/*********************************
+ * The End
+ *********************************/
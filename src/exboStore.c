@@ -0,0 +1,516 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+/* The store needs POSIX file mapping, beyond C99. */
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L
+#define Z_STORE_MMAP 1
+#else
+#define Z_STORE_MMAP 0
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <exbo.h>
+#if Z_STORE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+/* Bump the version whenever the file layout changes */
+#define Z_STORE_VERSION UINT32_C(2)
+#define Z_STORE_MAGIC "exbostor"
+#define Z_STORE_BYTE_ORDER UINT32_C(0x01020304)
+
+/* Keys are kept below 7/8 of the records */
+#define Z_LOAD_NUMERATOR ((int64_t)7)
+#define Z_LOAD_DENOMINATOR ((int64_t)8)
+
+/* The config id of an empty record, and of a removed one; a real config
+ * id is odd.
+ */
+#define Z_EMPTY UINT64_C(0)
+#define Z_REMOVED UINT64_C(2)
+
+/*********************************
+ * internal struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* The file starts with a header padded to 128 bytes.  The magic is
+ * written last when the file is created, so a file cut short while
+ * being created is rejected when reopened.
+ */
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint64_t slots;         // a power of two
+    uint64_t configId;
+    uint64_t X;             // the bits of X
+    int64_t A;
+    int64_t L;
+    int64_t count;
+    int64_t removed;        // records marked Z_REMOVED
+    unsigned char reserved[48];
+};
+
+/* The state is kept in its exboState layout, T, D and I, so that it is
+ * recorded in place.  Records are probed linearly from the hash of the
+ * key.  Unlike the registry, removal does not shift the probe run back,
+ * which a crash could interrupt halfway; it marks the record removed,
+ * and the mark is reused or, at the end of a run, emptied.  The config
+ * id of a record is written last, so a record is either whole or not
+ * there at all.
+ */
+struct record {
+    uint64_t key;
+    uint64_t configId;      // Z_EMPTY if the record is empty
+    exboState state;
+};
+
+struct store {
+    int fd;                 // held open, and locked, while mapped
+    exboConfig config;
+    uint64_t configId;
+    uint64_t mask;          // number of records - 1
+    int64_t limit;          // largest count
+    size_t size;            // of the mapping
+    struct header *header;
+    struct record *records;
+};
+
+/* Compile-time checks of the file layout */
+typedef char zHeaderIs128Bytes[(sizeof(struct header) == (size_t)128) ? 1 : -1];
+typedef char zRecordIs40Bytes[(sizeof(struct record) == (size_t)40) ? 1 : -1];
+
+/*********************************
+ * internal data declarations
+ *********************************/
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static uint64_t zHash64(uint64_t key);
+static uint64_t zConfigId(exboConfig cp, uint64_t *Xp);
+static int zCheckHeader(const struct header *h, size_t size, exboConfig cp);
+static void zFillHeader(struct header *h, uint64_t slots, exboConfig cp);
+static int64_t zLookup(const struct store *p, uint64_t key);
+static int64_t zInsert(struct store *p, uint64_t key);
+static void zCompact(struct store *p);
+static int zRemove(struct store *p, int64_t index);
+static void zSetConfigId(struct record *r, uint64_t configId);
+
+/*********************************
+ * external data definitions
+ *********************************/
+
+/*********************************
+ * internal data definitions
+ *********************************/
+
+/*********************************
+ * external function definitions
+ *********************************/
+int exboStoreOpen(exboStore *storep, const char *path, exboConfig cp, int64_t capacity) {
+    int result;
+    if ((storep != (exboStore *)0) && (path != (const char *)0) && (cp != (exboConfig)0)) {
+        *storep = (exboStore)0;
+#if Z_STORE_MMAP
+        struct store *p = (struct store *)malloc(sizeof(*p));
+        if (p != (struct store *)0) {
+            int fd = open(path, O_RDWR | O_CREAT, 0666);
+            struct stat info;
+            if ((fd >= 0) && (flock(fd, LOCK_EX | LOCK_NB) != 0)) {
+                // Another store has the file, or it cannot be locked.
+                result = (errno == EWOULDBLOCK) ? ExboErr_StoreBusy : ExboErr_StoreIo;
+            } else if ((fd >= 0) && (fstat(fd, &info) == 0)) {
+                uint64_t slots = UINT64_C(0);
+                size_t size = (size_t)info.st_size;
+                result = 0;
+                if (info.st_size == (off_t)0) {
+                    // A new file: size it for capacity keys.
+                    if ((capacity > (int64_t)0) && (capacity <= INT64_MAX / Z_LOAD_DENOMINATOR / (int64_t)64)) {
+                        uint64_t needed = (uint64_t)((capacity * Z_LOAD_DENOMINATOR + Z_LOAD_NUMERATOR
+                                                      - (int64_t)1) / Z_LOAD_NUMERATOR);
+                        slots = UINT64_C(8);
+                        while (slots < needed) {
+                            slots <<= 1;
+                        }
+                        size = sizeof(struct header) + (size_t)slots * sizeof(struct record);
+                        if (ftruncate(fd, (off_t)size) != 0) {
+                            result = ExboErr_StoreIo;
+                        }
+                    } else {
+                        // There is no capacity to size the file for
+                        result = ExboErr_StoreIo;
+                    }
+                } else if (size < sizeof(struct header)) {
+                    result = ExboErr_StoreFormat;
+                }
+                if (result == 0) {
+                    void *map = mmap((void *)0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)0);
+                    if (map != MAP_FAILED) {
+                        p->fd = fd;
+                        p->header = (struct header *)map;
+                        p->records = (struct record *)(void *)((unsigned char *)map + sizeof(struct header));
+                        p->size = size;
+                        p->config = cp;
+                        if (slots != UINT64_C(0)) {
+                            // The new records are zero, so empty.
+                            zFillHeader(p->header, slots, cp);
+                        }
+                        if ((result = zCheckHeader(p->header, size, cp)) == 0) {
+                            p->configId = p->header->configId;
+                            p->mask = p->header->slots - UINT64_C(1);
+                            p->limit = (int64_t)p->header->slots / Z_LOAD_DENOMINATOR * Z_LOAD_NUMERATOR;
+                            *storep = (exboStore)p;
+                        } else {
+                            (void)munmap(map, size);
+                        }
+                    } else {
+                        result = ExboErr_StoreIo;
+                    }
+                }
+            } else {
+                result = ExboErr_StoreIo;
+            }
+            if (result != 0) {
+                if (fd >= 0) {
+                    // Closing it also drops any lock.
+                    (void)close(fd);
+                }
+                free((void *)p);
+            }
+        } else {
+            result = ExboErr_OutOfMemory;
+        }
+#else
+        (void)capacity;
+        result = ExboErr_StoreIo;
+#endif
+    } else {
+        // There is no store handle, path or config
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStoreClose(exboStore stp) {
+    int result;
+    struct store *p = (struct store *)stp;
+    if (p != (struct store *)0) {
+#if Z_STORE_MMAP
+        result = (munmap((void *)p->header, p->size) == 0) ? 0 : ExboErr_StoreIo;
+        // Closing the file drops the lock.
+        if (close(p->fd) != 0) {
+            result = ExboErr_StoreIo;
+        }
+#else
+        result = ExboErr_StoreIo;
+#endif
+        free((void *)p);
+    } else {
+        // There is no store structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStoreSync(exboStore stp) {
+    int result;
+    struct store *p = (struct store *)stp;
+    if (p != (struct store *)0) {
+#if Z_STORE_MMAP
+        result = (msync((void *)p->header, p->size, MS_SYNC) == 0) ? 0 : ExboErr_StoreIo;
+#else
+        result = ExboErr_StoreIo;
+#endif
+    } else {
+        // There is no store structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboStoreRecord(exboStore stp, uint64_t key, int64_t now) {
+    int result;
+    struct store *p = (struct store *)stp;
+    if (p != (struct store *)0) {
+        int64_t index = zLookup(p, key);
+        if ((index < (int64_t)0) && (p->header->count < p->limit)) {
+            index = zInsert(p, key);
+            if ((index < (int64_t)0) && (p->header->removed > (int64_t)0)) {
+                // Removed records fill the store.
+                zCompact(p);
+                index = zInsert(p, key);
+            }
+        }
+        if (index >= (int64_t)0) {
+            // The key identifies the state to jitter, wherever its record is.
+            result = exboStateRecordAttemptStream(p->config, &p->records[index].state, now, key);
+        } else {
+            result = ExboErr_StoreFull;
+        }
+    } else {
+        // There is no store structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+const exboState *exboStoreFind(exboStore stp, uint64_t key) {
+    const exboState *result = (const exboState *)0;
+    const struct store *p = (const struct store *)stp;
+    if (p != (const struct store *)0) {
+        int64_t index = zLookup(p, key);
+        if (index >= (int64_t)0) {
+            result = &p->records[index].state;
+        }
+    }
+    return result;
+}
+
+int exboStoreRemove(exboStore stp, uint64_t key) {
+    int result = 0;
+    struct store *p = (struct store *)stp;
+    if (p != (struct store *)0) {
+        int64_t index;
+        result = zRemove(p, zLookup(p, key));
+        // A crash while compacting may have left a stale second copy.
+        while ((index = zLookup(p, key)) >= (int64_t)0) {
+            zSetConfigId(&p->records[index], Z_REMOVED);
+        }
+    }
+    return result;
+}
+
+int64_t exboStoreGetCount(exboStore stp) {
+    int64_t result;
+    const struct store *p = (const struct store *)stp;
+    if (p != (const struct store *)0) {
+        result = p->header->count;
+    } else {
+        // There is no store structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static uint64_t zHash64(uint64_t key) {
+    // The splitmix64 finalizer
+    key ^= key >> 30;
+    key *= UINT64_C(0xbf58476d1ce4e5b9);
+    key ^= key >> 27;
+    key *= UINT64_C(0x94d049bb133111eb);
+    key ^= key >> 31;
+    return key;
+}
+
+static uint64_t zConfigId(exboConfig cp, uint64_t *Xp) {
+    // A nonzero digest of X, A and L; *Xp receives the bits of X.
+    double X = exboConfigGet_X(cp);
+    uint64_t id;
+    memcpy((void *)Xp, (const void *)&X, sizeof(*Xp));
+    id = zHash64(*Xp);
+    id = zHash64(id ^ (uint64_t)exboConfigGet_A(cp));
+    id = zHash64(id ^ (uint64_t)exboConfigGet_L(cp));
+    return id | UINT64_C(1);
+}
+
+static void zFillHeader(struct header *h, uint64_t slots, exboConfig cp) {
+    // Assert: the header is zero
+    h->version = Z_STORE_VERSION;
+    h->byteOrder = Z_STORE_BYTE_ORDER;
+    h->headerSize = (uint32_t)sizeof(struct header);
+    h->recordSize = (uint32_t)sizeof(struct record);
+    h->slots = slots;
+    h->configId = zConfigId(cp, &h->X);
+    h->A = exboConfigGet_A(cp);
+    h->L = exboConfigGet_L(cp);
+    h->count = (int64_t)0;
+    memcpy((void *)h->magic, (const void *)Z_STORE_MAGIC, sizeof(h->magic));
+    return;
+}
+
+static int zCheckHeader(const struct header *h, size_t size, exboConfig cp) {
+    int result;
+    uint64_t X;
+    if ((memcmp((const void *)h->magic, (const void *)Z_STORE_MAGIC, sizeof(h->magic)) != 0)
+            || (h->version != Z_STORE_VERSION) || (h->byteOrder != Z_STORE_BYTE_ORDER)
+            || (h->headerSize != (uint32_t)sizeof(struct header))
+            || (h->recordSize != (uint32_t)sizeof(struct record))
+            || (h->slots < UINT64_C(8)) || ((h->slots & (h->slots - UINT64_C(1))) != UINT64_C(0))
+            || (h->slots > (uint64_t)(size - sizeof(struct header)) / sizeof(struct record))
+            || (size != sizeof(struct header) + (size_t)h->slots * sizeof(struct record))) {
+        result = ExboErr_StoreFormat;
+    } else if ((h->configId != zConfigId(cp, &X)) || (h->X != X) || (h->A != exboConfigGet_A(cp))
+            || (h->L != exboConfigGet_L(cp))) {
+        result = ExboErr_StoreConfigMismatch;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+static int64_t zLookup(const struct store *p, uint64_t key) {
+    // Returns the index of the key's record, or -1 if it is absent.
+    uint64_t i = zHash64(key) & p->mask;
+    int64_t result = (int64_t)-1;
+    while (p->records[i].configId != Z_EMPTY) {
+        if ((p->records[i].key == key) && (p->records[i].configId != Z_REMOVED)) {
+            result = (int64_t)i;
+            break;
+        }
+        i = (i + UINT64_C(1)) & p->mask;
+    }
+    return result;
+}
+
+static int64_t zInsert(struct store *p, uint64_t key) {
+    // Assert: key is absent
+    // Take the first removed record of the key's probe run, or else the
+    // empty one that ends it, as long as the removed and present records
+    // leave some empty.  Returns the index taken, or -1.
+    int64_t result = (int64_t)-1;
+    uint64_t i = zHash64(key) & p->mask;
+    int reuse;
+    while ((p->records[i].configId != Z_EMPTY) && (p->records[i].configId != Z_REMOVED)) {
+        i = (i + UINT64_C(1)) & p->mask;
+    }
+    reuse = (p->records[i].configId == Z_REMOVED);
+    if (reuse || (p->header->count + p->header->removed < p->limit)) {
+        // The counts are raised before and lowered after the record
+        // changes, so a crash leaves them too high, never too low.
+        p->header->count++;
+        p->records[i].key = key;
+        exboStateInit(&p->records[i].state);
+        zSetConfigId(&p->records[i], p->configId);
+        if (reuse) {
+            p->header->removed--;
+        }
+        result = (int64_t)i;
+    }
+    return result;
+}
+
+static void zCompact(struct store *p) {
+    // Empty every removed record.  One that a present record's probe
+    // run passes through is first filled by moving that record back,
+    // which leaves a removed record where it was, and so on to the end
+    // of the probe run.  A present record at k with home h is reached
+    // through every record cyclically in [h, k).  A record is moved by
+    // copying it, then marking the old place removed, so a crash between
+    // the two leaves the key twice, the first copy current, which
+    // exboStoreRemove() also clears.
+    uint64_t j;
+    for (j = UINT64_C(0); j <= p->mask; j++) {
+        uint64_t hole = j;
+        while (p->records[hole].configId == Z_REMOVED) {
+            uint64_t k = (hole + UINT64_C(1)) & p->mask;
+            while ((p->records[k].configId != Z_EMPTY)
+                   && ((p->records[k].configId == Z_REMOVED)
+                       || (((hole - (zHash64(p->records[k].key) & p->mask)) & p->mask)
+                           >= ((k - (zHash64(p->records[k].key) & p->mask)) & p->mask)))) {
+                k = (k + UINT64_C(1)) & p->mask;
+            }
+            if (p->records[k].configId != Z_EMPTY) {
+                p->records[hole].key = p->records[k].key;
+                p->records[hole].state = p->records[k].state;
+                zSetConfigId(&p->records[hole], p->records[k].configId);
+                zSetConfigId(&p->records[k], Z_REMOVED);
+                hole = k;
+            } else {
+                zSetConfigId(&p->records[hole], Z_EMPTY);
+                p->header->removed--;
+            }
+        }
+    }
+    return;
+}
+
+static int zRemove(struct store *p, int64_t index) {
+    // Mark the record at index removed, each step a single store that
+    // leaves every other key findable.  At the end of a probe run, where
+    // no lookup goes further, the record and any removed ones before it
+    // are emptied instead.
+    int result;
+    if (index >= (int64_t)0) {
+        uint64_t i = (uint64_t)index;
+        if (p->records[(i + UINT64_C(1)) & p->mask].configId == Z_EMPTY) {
+            zSetConfigId(&p->records[i], Z_EMPTY);
+            p->header->count--;
+            i = (i - UINT64_C(1)) & p->mask;
+            while (p->records[i].configId == Z_REMOVED) {
+                zSetConfigId(&p->records[i], Z_EMPTY);
+                p->header->removed--;
+                i = (i - UINT64_C(1)) & p->mask;
+            }
+        } else {
+            p->header->removed++;
+            zSetConfigId(&p->records[i], Z_REMOVED);
+            p->header->count--;
+        }
+        result = 1;
+    } else {
+        result = 0;
+    }
+    return result;
+}
+
+static void zSetConfigId(struct record *r, uint64_t configId) {
+    // The config id is written after the rest of the record, and in one
+    // store, so that a crash leaves the record whole or absent.
+#if defined(__GNUC__)
+    __atomic_store_n(&r->configId, configId, __ATOMIC_RELEASE);
+#else
+    r->configId = configId;
+#endif
+    return;
+}
+
+/*********************************
+ * The End
+ *********************************/
@@ -0,0 +1,434 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright (c) 2016,2018 Daniel F. Fisher                              ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <exbo.h>
+
+/*********************************
+ * internal macro declarations
+ *********************************/
+/* Each level of the wheel has 2^Z_LEVEL_BITS slots */
+#define Z_LEVEL_BITS 6
+#define Z_SLOTS (1 << Z_LEVEL_BITS)
+#define Z_SLOT_MASK ((uint64_t)(Z_SLOTS - 1))
+
+/* Enough levels to cover every 64-bit tick */
+#define Z_LEVELS ((64 + Z_LEVEL_BITS - 1) / Z_LEVEL_BITS)
+
+/* The slot of an entry that is not in the wheel */
+#define Z_UNSCHEDULED ((int64_t)-1)
+
+/* The slot of an entry that is due but not yet handed back */
+#define Z_EXPIRED ((int64_t)(Z_LEVELS * Z_SLOTS))
+
+/*********************************
+ * internal struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* The list links follow the hlist idiom: pprev points at whichever
+ * pointer points at the entry, so that unlinking needs no head.
+ */
+struct entry {
+    struct entry *next;
+    struct entry **pprev;
+    void *userData;
+    uint64_t tick;
+    int64_t when;
+    int64_t slot;           // level * Z_SLOTS + index, or Z_UNSCHEDULED or Z_EXPIRED
+};
+
+/* An entry with tick e sits at the level of the highest Z_LEVEL_BITS
+ * group in which e differs from the current tick, in the slot given by
+ * that group of e.  Every occupied slot therefore starts after the
+ * current tick, and the occupied bitmaps find the next one to cascade.
+ */
+struct wheel {
+    int64_t origin;
+    int64_t resolution;
+    uint64_t current;       // ticks since origin
+    int64_t count;
+    uint64_t occupied[Z_LEVELS];
+    struct entry *slots[Z_LEVELS][Z_SLOTS];
+    struct entry *expired;
+};
+
+/* Compile-time check that an entry is an exboWheelEntry */
+typedef char zEntryIsExboWheelEntry[(sizeof(struct entry) == sizeof(exboWheelEntry)) ? 1 : -1];
+
+/*********************************
+ * internal data declarations
+ *********************************/
+
+/*********************************
+ * internal function declarations
+ *********************************/
+static uint64_t zTickCeil(const struct wheel *p, int64_t when);
+static uint64_t zTickFloor(const struct wheel *p, int64_t now);
+static void zPlace(struct wheel *p, struct entry *e);
+static void zUnlink(struct wheel *p, struct entry *e);
+static void zCascade(struct wheel *p, int level, int index);
+static int zHighestBit(uint64_t x);
+static int zLowestBit(uint64_t x);
+
+/*********************************
+ * external data definitions
+ *********************************/
+
+/*********************************
+ * internal data definitions
+ *********************************/
+
+/*********************************
+ * external function definitions
+ *********************************/
+exboWheel exboWheelCreate(int64_t now, int64_t resolution) {
+    exboWheel result = (exboWheel)0;
+    if (resolution > (int64_t)0) {
+        struct wheel *p = (struct wheel *)calloc((size_t)1, sizeof(*p));
+        if (p != (struct wheel *)0) {
+            p->origin = now;
+            p->resolution = resolution;
+            p->current = UINT64_C(0);
+            p->count = (int64_t)0;
+            p->expired = (struct entry *)0;
+            result = (exboWheel)p;
+        }
+    }
+    return result;
+}
+
+void exboWheelDestroy(exboWheel wp) {
+    free(wp);
+    return;
+}
+
+int exboWheelEntryInit(exboWheelEntry *ep) {
+    int result;
+    if (ep != (exboWheelEntry *)0) {
+        struct entry *e = (struct entry *)(void *)ep;
+        e->next = (struct entry *)0;
+        e->pprev = (struct entry **)0;
+        e->userData = (void *)0;
+        e->tick = UINT64_C(0);
+        e->when = (int64_t)0;
+        e->slot = Z_UNSCHEDULED;
+        result = 0;
+    } else {
+        // There is no entry structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboWheelSchedule(exboWheel wp, exboWheelEntry *ep, int64_t when, void *userData) {
+    int result;
+    struct wheel *p = (struct wheel *)wp;
+    if ((p != (struct wheel *)0) && (ep != (exboWheelEntry *)0)) {
+        struct entry *e = (struct entry *)(void *)ep;
+        if (e->slot != Z_UNSCHEDULED) {
+            zUnlink(p, e);
+        }
+        e->userData = userData;
+        e->when = when;
+        e->tick = zTickCeil(p, when);
+        zPlace(p, e);
+        p->count++;
+        result = 0;
+    } else {
+        // There is no wheel or entry structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboWheelCancel(exboWheel wp, exboWheelEntry *ep) {
+    int result = 0;
+    struct wheel *p = (struct wheel *)wp;
+    if ((p != (struct wheel *)0) && (ep != (exboWheelEntry *)0)) {
+        struct entry *e = (struct entry *)(void *)ep;
+        if (e->slot != Z_UNSCHEDULED) {
+            zUnlink(p, e);
+            result = 1;
+        }
+    }
+    return result;
+}
+
+int exboWheelRecordAttempt(exboWheel wp, exboWheelEntry *ep, exbo xp, int64_t time) {
+    int result;
+    if ((wp != (exboWheel)0) && (ep != (exboWheelEntry *)0)) {
+        if ((result = exboRecordAttempt(xp, time)) <= 0) {
+            int64_t next = exboGetNextAttemptTime(xp);
+            if (next >= Exbo_MinimumTime) {
+                (void)exboWheelSchedule(wp, ep, next, (void *)xp);
+            } else {
+                // Report the error from exboGetNextAttemptTime()
+                result = (int)(next - INT64_MIN);
+            }
+        }
+    } else {
+        // There is no wheel or entry structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int exboWheelStateRecordAttempt(exboWheel wp, exboWheelEntry *ep, exboConfig cp, exboState *sp,
+                                int64_t time) {
+    int result;
+    if ((wp != (exboWheel)0) && (ep != (exboWheelEntry *)0)) {
+        if ((result = exboStateRecordAttempt(cp, sp, time)) <= 0) {
+            int64_t next = exboStateGetNextAttemptTime(sp);
+            if (next >= Exbo_MinimumTime) {
+                (void)exboWheelSchedule(wp, ep, next, (void *)sp);
+            } else {
+                // Report the error from exboStateGetNextAttemptTime()
+                result = (int)(next - INT64_MIN);
+            }
+        }
+    } else {
+        // There is no wheel or entry structure
+        result = ExboErr_NoInstance;
+    }
+    return result;
+}
+
+exboWheelEntry *exboWheelAdvance(exboWheel wp, int64_t now) {
+    struct entry *result = (struct entry *)0;
+    struct wheel *p = (struct wheel *)wp;
+    if (p != (struct wheel *)0) {
+        uint64_t target = zTickFloor(p, now);
+        while (p->current < target) {
+            // Find the occupied slot that starts soonest.
+            uint64_t next = UINT64_MAX;
+            uint64_t starts[Z_LEVELS];
+            int indexes[Z_LEVELS];
+            int level;
+            for (level = 0; level < Z_LEVELS; level++) {
+                int shift = level * Z_LEVEL_BITS;
+                int current = (int)((p->current >> shift) & Z_SLOT_MASK);
+                uint64_t later = (current < Z_SLOTS - 1) ? (~UINT64_C(0) << (current + 1)) : UINT64_C(0);
+                uint64_t bits = p->occupied[level] & later;
+                starts[level] = UINT64_MAX;
+                if (bits != UINT64_C(0)) {
+                    int high = shift + Z_LEVEL_BITS;
+                    uint64_t above = (high < 64) ? (p->current & (~UINT64_C(0) << high)) : UINT64_C(0);
+                    indexes[level] = zLowestBit(bits);
+                    starts[level] = above | ((uint64_t)indexes[level] << shift);
+                    if (starts[level] < next) {
+                        next = starts[level];
+                    }
+                }
+            }
+            if (next > target) {
+                // Nothing is due before the target; no entry changes level.
+                p->current = target;
+            } else {
+                // Move to the slot start and spread the slots that start
+                // there over the lower levels, or into the expired list.
+                p->current = next;
+                for (level = Z_LEVELS - 1; level >= 0; level--) {
+                    if (starts[level] == next) {
+                        zCascade(p, level, indexes[level]);
+                    }
+                }
+            }
+        }
+        // Hand back the expired list.
+        result = p->expired;
+        p->expired = (struct entry *)0;
+        struct entry *e;
+        for (e = result; e != (struct entry *)0; e = e->next) {
+            e->pprev = (struct entry **)0;
+            e->slot = Z_UNSCHEDULED;
+            p->count--;
+        }
+    }
+    return (exboWheelEntry *)(void *)result;
+}
+
+exboWheelEntry *exboWheelEntryGetNext(const exboWheelEntry *ep) {
+    exboWheelEntry *result = (exboWheelEntry *)0;
+    if (ep != (const exboWheelEntry *)0) {
+        result = (exboWheelEntry *)(void *)((const struct entry *)(const void *)ep)->next;
+    }
+    return result;
+}
+
+void *exboWheelEntryGetUserData(const exboWheelEntry *ep) {
+    void *result = (void *)0;
+    if (ep != (const exboWheelEntry *)0) {
+        result = ((const struct entry *)(const void *)ep)->userData;
+    }
+    return result;
+}
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+int64_t exboWheelEntryGetTime(const exboWheelEntry *ep) {
+    int64_t result;
+    if (ep != (const exboWheelEntry *)0) {
+        result = ((const struct entry *)(const void *)ep)->when;
+    } else {
+        // There is no entry structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+int64_t exboWheelGetCount(exboWheel wp) {
+    int64_t result;
+    const struct wheel *p = (const struct wheel *)wp;
+    if (p != (const struct wheel *)0) {
+        result = p->count;
+    } else {
+        // There is no wheel structure
+        result = INT64_MIN + ExboErr_NoInstance;
+    }
+    return result;
+}
+
+/*********************************
+ * internal function definitions
+ *********************************/
+static uint64_t zTickCeil(const struct wheel *p, int64_t when) {
+    // The first tick at or after when; times before the origin are tick 0.
+    uint64_t result;
+    if (when > p->origin) {
+        uint64_t elapsed = (uint64_t)when - (uint64_t)p->origin;
+        uint64_t resolution = (uint64_t)p->resolution;
+        result = elapsed / resolution + (uint64_t)(elapsed % resolution != UINT64_C(0));
+    } else {
+        result = UINT64_C(0);
+    }
+    return result;
+}
+
+static uint64_t zTickFloor(const struct wheel *p, int64_t now) {
+    // The last tick at or before now
+    uint64_t result;
+    if (now > p->origin) {
+        result = ((uint64_t)now - (uint64_t)p->origin) / (uint64_t)p->resolution;
+    } else {
+        result = UINT64_C(0);
+    }
+    return result;
+}
+
+static void zPlace(struct wheel *p, struct entry *e) {
+    // Link e into its slot for the current tick, or into the expired list.
+    struct entry **headp;
+    if (e->tick <= p->current) {
+        headp = &p->expired;
+        e->slot = Z_EXPIRED;
+    } else {
+        int level = zHighestBit(e->tick ^ p->current) / Z_LEVEL_BITS;
+        int index = (int)((e->tick >> (level * Z_LEVEL_BITS)) & Z_SLOT_MASK);
+        headp = &p->slots[level][index];
+        e->slot = (int64_t)(level * Z_SLOTS + index);
+        p->occupied[level] |= UINT64_C(1) << index;
+    }
+    e->next = *headp;
+    if (e->next != (struct entry *)0) {
+        e->next->pprev = &e->next;
+    }
+    e->pprev = headp;
+    *headp = e;
+    return;
+}
+
+static void zUnlink(struct wheel *p, struct entry *e) {
+    // Assert: e->slot != Z_UNSCHEDULED
+    *e->pprev = e->next;
+    if (e->next != (struct entry *)0) {
+        e->next->pprev = e->pprev;
+    }
+    if (e->slot != Z_EXPIRED) {
+        int level = (int)(e->slot / Z_SLOTS);
+        int index = (int)(e->slot % Z_SLOTS);
+        if (p->slots[level][index] == (struct entry *)0) {
+            p->occupied[level] &= ~(UINT64_C(1) << index);
+        }
+    }
+    e->next = (struct entry *)0;
+    e->pprev = (struct entry **)0;
+    e->slot = Z_UNSCHEDULED;
+    p->count--;
+    return;
+}
+
+static void zCascade(struct wheel *p, int level, int index) {
+    // Empty a slot, placing its entries again for the current tick.
+    struct entry *e = p->slots[level][index];
+    p->slots[level][index] = (struct entry *)0;
+    p->occupied[level] &= ~(UINT64_C(1) << index);
+    while (e != (struct entry *)0) {
+        struct entry *next = e->next;
+        zPlace(p, e);
+        e = next;
+    }
+    return;
+}
+
+static int zHighestBit(uint64_t x) {
+    // Assert: x != 0
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll((unsigned long long)x);
+#else
+    int result = 0;
+    while ((x >>= 1) != UINT64_C(0)) {
+        result++;
+    }
+    return result;
+#endif
+}
+
+static int zLowestBit(uint64_t x) {
+    // Assert: x != 0
+#if defined(__GNUC__)
+    return __builtin_ctzll((unsigned long long)x);
+#else
+    int result = 0;
+    while ((x & UINT64_C(1)) == UINT64_C(0)) {
+        x >>= 1;
+        result++;
+    }
+    return result;
+#endif
+}
+
+/*********************************
+ * The End
+ *********************************/
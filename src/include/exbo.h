@@ -65,6 +65,31 @@ extern "C" {
 #define ExboErr_InternalError_1         (14) // "BUG: the finished config is not marked as finished"
 #define ExboErr_InternalError_2         (15) // "BUG: the finished config has missing parts"
 #define ExboErr_InternalError_3         (16) // "BUG: the finished config is invalid"
+#define ExboErr_InvalidConfig_T1        (17) // "The given table size is out of range"
+#define ExboErr_OutOfMemory             (18) // "Memory could not be allocated"
+#define ExboErr_InvalidConfig_E1        (19) // "The given engine is undefined"
+#define ExboErr_RegistryFull            (20) // "The registry is full"
+#define ExboErr_RegistryKeyType         (21) // "The key is not of the registry's key type"
+#define ExboErr_RegistryKeyTooLong      (22) // "The given key is too long"
+#define ExboErr_AtomicUnsupported       (23) // "Atomic recording is not supported by this build"
+#define ExboErr_AttemptNotReady         (24) // "The next attempt time has not been reached"
+#define ExboErr_StoreIo                 (25) // "The store file could not be opened, sized or mapped"
+#define ExboErr_StoreFormat             (26) // "The store file is not a store of this version"
+#define ExboErr_StoreConfigMismatch     (27) // "The store file was created with a different configuration"
+#define ExboErr_StoreFull               (28) // "The store is full"
+#define ExboErr_SnapshotTooSmall        (29) // "The buffer is too small for the snapshot"
+#define ExboErr_SnapshotCorrupt         (30) // "The snapshot is of another version or is corrupt"
+#define ExboErr_StatsDisabled           (31) // "Statistics are not compiled into this build"
+#define ExboErr_AllocatorInUse          (32) // "Memory is still held from the current allocator"
+#define ExboErr_AllocatorIncomplete     (33) // "Only one of the allocator functions was given"
+#define ExboErr_TooManyLevels           (34) // "More levels were given than Exbo_MaximumLevels"
+#define ExboErr_InvalidCost             (35) // "The given cost is not positive"
+#define ExboErr_InvalidClockSource      (36) // "The given clock source is not defined"
+#define ExboErr_InvalidClockUnits       (37) // "The given clock units per second are out of range"
+#define ExboErr_ClockUnsupported        (38) // "The clock source is not supported on this machine"
+#define ExboErr_InvalidClockTime        (39) // "The given time is less than Exbo_MinimumTime"
+#define ExboErr_InvalidConfig_J1        (40) // "The given jitter mode is undefined"
+#define ExboErr_StoreBusy               (41) // "The store file is already open"
 #define ExboErr_MAXIMUM                 (64)
 
 /* Minimum Time Value */
@@ -76,12 +101,127 @@ extern "C" {
 #define ExboWarn_ExcessCostLimitBreachWithDebtOverflow   (-3) // "Excess cost limit breach with debt accumulator overflow"
 #define ExboWarn_COUNT                                    (4)
 
+/* Jitter Modes */
+#define ExboJitter_None          (0) // I is the computed interval
+#define ExboJitter_Full          (1) // I is drawn from [1, I]
+#define ExboJitter_Decorrelated  (2) // I is drawn from [1, 3 * the previous I], and at most I
+
+/* Clock Sources */
+#define ExboClock_Monotonic  (0) // clock_gettime(CLOCK_MONOTONIC) on every call
+#define ExboClock_Coarse     (1) // CLOCK_MONOTONIC_COARSE: the kernel's cached time, a tick stale
+#define ExboClock_Tsc        (2) // the invariant x86 time stamp counter, calibrated at configuration
+#define ExboClock_Manual     (3) // the time last given to exboClockSet()
+
+/* Largest number of clock units per second: nanoseconds */
+#define Exbo_MaximumClockUnits ((int64_t)1000000000)
+
+/* Interval Engines */
+#define ExboEngine_Double    (0) // double precision, using libm
+#define ExboEngine_Integer   (1) // 64-bit integer arithmetic only
+
+/* Largest number of entries in an interval table */
+#define Exbo_MaximumTableSize ((int64_t)1 << 24)
+
+/* Size of the snapshot of an instance */
+#define Exbo_SnapshotSize (80)
+
+/* Largest number of levels recorded by exboRecordAttemptLevels() */
+#define Exbo_MaximumLevels (16)
+
+/* Buckets of each exboStats histogram */
+#define Exbo_StatsBuckets (64)
+
+/* Size of the caller-provided storage for an instance */
+#define Exbo_StorageSize (128)
+
+/* Alignment that starts an exboStorage on a cache line */
+#if defined(__GNUC__)
+#define Exbo_CacheAligned __attribute__((aligned(64)))
+#else
+#define Exbo_CacheAligned
+#endif
+
+/* Alignment required for a 16-byte compare-and-swap */
+#if defined(__GNUC__)
+#define Exbo_AtomicAligned __attribute__((aligned(16)))
+#else
+#define Exbo_AtomicAligned
+#endif
+
 /*********************************
  * external struct, union,
  * typedef and enum declarations
  *********************************/
 typedef void *exbo;
 
+/* Caller-provided storage for an instance.  An instance initialized in
+ * it with exboInit() keeps its state and configuration inline, so that
+ * creating and destroying it does no heap allocation.  Everything but
+ * the jitter seed lies in the first cache line.
+ */
+typedef union Exbo_CacheAligned exboStorage {
+    unsigned char bytes[Exbo_StorageSize];
+    int64_t alignInt64;
+    double alignDouble;
+    void *alignPointer;
+} exboStorage;
+
+/* A finished, immutable configuration that can be shared by any number
+ * of exboState instances.  It must outlive every state recorded with it.
+ */
+typedef void *exboConfig;
+
+/* The state of an instance whose configuration is a shared exboConfig */
+typedef struct exboState {
+    int64_t opaque[3];
+} exboState;
+
+/* The state of an instance that many threads record attempts on at
+ * once.  It holds T and D, which are updated together by one 16-byte
+ * compare-and-swap; I is recomputed from D, on which alone it depends.
+ */
+typedef struct Exbo_AtomicAligned exboAtomicState {
+    int64_t opaque[2];
+} exboAtomicState;
+
+/* A fixed-capacity hash table from resource key to exboState */
+typedef void *exboRegistry;
+
+/* A hierarchical timing wheel of caller-owned entries */
+typedef void *exboWheel;
+
+/* A file-backed table from 64-bit key to exboState */
+typedef void *exboStore;
+
+/* Memory hooks for exboSetAllocator().  Memory must be aligned as
+ * malloc() aligns it.  The free function is told the size that was
+ * allocated, and both are passed the context given with them.
+ */
+typedef void *(*exboAllocateFunction)(size_t size, void *context);
+typedef void (*exboFreeFunction)(void *p, size_t size, void *context);
+
+/* An entry that can be scheduled in an exboWheel.  The caller owns it;
+ * it must stay in place while it is scheduled.
+ */
+typedef struct exboWheelEntry {
+    void *opaque[3];
+    int64_t opaque64[3];
+} exboWheelEntry;
+
+/* Counts of the attempts recorded by this process, as exboGetStats()
+ * reports them, or through one instance, as exboSetStatsSink() counts
+ * them.  Bucket 0 of a histogram counts the value 0, and bucket
+ * b > 0 counts the values in [2^(b-1), 2^b).
+ */
+typedef struct exboStats {
+    int64_t records;                        // attempts recorded
+    int64_t errors;                         // records that failed, other than attempts not ready
+    int64_t notReady;                       // tries that returned ExboErr_AttemptNotReady
+    int64_t warnings[ExboWarn_COUNT];       // warnings[-w] counts warning w; warnings[0] counts none
+    int64_t intervals[Exbo_StatsBuckets];   // I after each record
+    int64_t debts[Exbo_StatsBuckets];       // D after each record
+} exboStats;
+
 /*********************************
  * external data declarations
  *********************************/
@@ -89,12 +229,37 @@ typedef void *exbo;
 /*********************************
  * external function declarations
  *********************************/
+/* Routes the memory of instances, configs and interval tables through
+ * allocate and release instead of malloc() and free(); passing 0 for
+ * both restores those.  It fails with ExboErr_AllocatorInUse while any
+ * memory from the current allocator is held, and is safe to call while
+ * other threads allocate.  Instances and configs are handed out from
+ * 128-byte blocks, carved from slabs and kept on per-thread free lists,
+ * so creating and destroying one is a few pointer operations.  The
+ * slabs are held for the life of the process, so the allocator can be
+ * set only before the first instance or config is created; after that
+ * every call fails with ExboErr_AllocatorInUse, even once all of them
+ * are destroyed.  Building with -DEXBO_NO_POOL allocates each block
+ * separately instead, and the allocator can be set again whenever
+ * nothing is held.
+ */
+extern int exboSetAllocator(exboAllocateFunction allocate, exboFreeFunction release, void *context);
+
 extern exbo exboCreate(void);
 
 extern exbo exboCreateConfigured(double X, int64_t A, int64_t L);
 
 extern void exboDestroy(exbo xp);
 
+/* The returned handle points into the given storage, which must outlive
+ * it.  Release the instance with exboFini(), not exboDestroy().
+ */
+extern exbo exboInit(exboStorage *storage);
+
+extern exbo exboInitConfigured(exboStorage *storage, double X, int64_t A, int64_t L);
+
+extern void exboFini(exbo xp);
+
 extern int exboClearConfig(exbo xp);
 
 extern int exboConfigure_X(exbo xp, double X);
@@ -103,12 +268,94 @@ extern int exboConfigure_A(exbo xp, int64_t A);
 
 extern int exboConfigure_L(exbo xp, int64_t L);
 
+/* A tableSize of 2 or more makes exboFinishConfig() tabulate, for each
+ * J below tableSize, the excess L - D at which the under-saturated
+ * interval steps to J and the factor (X - 1)/(X^J - 1).  For a given J
+ * the interval is linear in L - D, so recording an attempt finds J in
+ * the table and computes the same interval as without it, instead of
+ * evaluating pow().  J is about (L - D)/A + 1/(X - 1), and debts whose
+ * J is past the table are computed as without one; a tableSize above
+ * L/A + 1/(X - 1) + 2 covers every debt.  exboGetTableErrorBound()
+ * reports 0.  A tableSize of 0 disables the table.
+ */
+extern int exboConfigure_TableSize(exbo xp, int64_t tableSize);
+
+/* The integer engine computes the interval with 64-bit integer
+ * arithmetic alone: X is decoded from its bit pattern and every real
+ * quantity is held as a 64-bit mantissa and an exponent.  Recording an
+ * attempt with it does no floating point arithmetic.  Powers of X are
+ * carried as X^J - 1, so it keeps full precision when X is close to 1,
+ * where the double engine can be off by a relative 2^-30.  It ignores
+ * any interval table.  Building with
+ * -DEXBO_DEFAULT_ENGINE=ExboEngine_Integer makes it the default.
+ */
+extern int exboConfigure_Engine(exbo xp, int engine);
+
+/* Jitter spreads out clients driven by the same schedule, so that they
+ * do not all become ready at the same T + I.  The interval computed for
+ * an attempt bounds the interval drawn in its place, and the debt is not
+ * affected.  Each draw hashes the attempt time and the new debt with the
+ * identity of the state, so it needs no state of its own and takes no
+ * lock.  Without a seed, that identity is the address of the state, so
+ * states draw apart but not reproducibly.  With a seed, from
+ * exboConfigure_JitterSeed(), the draws depend on the seed, a stream and
+ * the history alone, and so repeat across processes and for a state
+ * restored or moved elsewhere.  An instance is its own stream, so give
+ * instances that should draw apart different seeds.  States that share a
+ * seeded config are told apart by the stream given to
+ * exboStateRecordAttemptStream(), or by their key in a registry or a
+ * store; the other exboState functions use their address.  The batch
+ * and atomic functions, whose states have no stable address or do not
+ * hold I, ignore jitter.
+ */
+extern int exboConfigure_Jitter(exbo xp, int jitter);
+
+extern int exboConfigure_JitterSeed(exbo xp, uint64_t seed);
+
 extern int exboValidateConfig(exbo xp);
 
 extern int exboFinishConfig(exbo xp);
 
+/* Returns the error number of the attempt, or, if it was recorded, its
+ * warning (ExboWarn_*), or 0.  Every function that records an attempt,
+ * alone or in a batch, reports its result this way.  Earlier versions
+ * returned 0 for any recorded attempt, dropping its warning, so a caller
+ * that tests for failure should test for a result greater than 0.
+ */
 extern int exboRecordAttempt(exbo xp, int64_t time);
 
+/* As exboRecordAttempt(), but the attempt adds cost, rather than A, to
+ * the debt, as for a batch of cost / A attempts; the interval is computed
+ * once, from the resulting debt.  Recording cost k * A leaves the same
+ * debt and interval as recording k attempts at time.  A debt less than A
+ * is given the interval of a debt of A.  Debt overflow is handled as by
+ * exboRecordAttempt(): the debt sticks at INT64_MAX with the warning
+ * ExboWarn_ExcessCostLimitBreachWithDebtOverflow.  cost must be positive.
+ */
+extern int exboRecordAttemptWeighted(exbo xp, int64_t time, int64_t cost);
+
+/* Records an attempt at time now if now is at or after the next attempt
+ * time, setting *waitp to 0.  Otherwise it leaves the state unchanged,
+ * sets *waitp to the time remaining and returns ExboErr_AttemptNotReady.
+ * The readiness check does no floating point arithmetic.  waitp may be 0.
+ */
+extern int exboTryAttempt(exbo xp, int64_t now, int64_t *waitp);
+
+/* Records one attempt at time against each of the n distinct instances
+ * levels[0..n-1], such as a tenant, a backend shard and a global pool,
+ * each with its own config.  It is all or nothing: if any level cannot
+ * record the attempt, for instance with ExboErr_RecordingAPriorAttempt,
+ * no level is changed and that level's error is returned.  Otherwise
+ * it returns the first level's warning, if any level has one, and
+ * *nextp receives the latest of the levels' next attempt times, the one
+ * that governs, and *bindingp the index of the first level with that
+ * time.  If a level's next attempt time is an error, as returned by
+ * exboGetNextAttemptTime(), that level governs and *nextp receives its
+ * error value.  n may be at most Exbo_MaximumLevels.  nextp and bindingp
+ * may be 0.
+ */
+extern int exboRecordAttemptLevels(const exbo *levels, size_t n, int64_t time, int64_t *nextp, size_t *bindingp);
+
 /* To signal an error, this function returns a value that is less
  * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
  */
@@ -140,6 +387,370 @@ extern int64_t exboGetConfig_A(exbo xp);
 
 extern int64_t exboGetConfig_L(exbo xp); 
 
+/* To signal an error, this function returns the negated error number.
+ */
+extern int exboGetConfig_Engine(exbo xp);
+
+/* To signal an error, this function returns the negated error number.
+ */
+extern int exboGetConfig_Jitter(exbo xp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboGetTableErrorBound(exbo xp);
+
+/* Returns 0 if the configuration is invalid or memory is exhausted. */
+extern exboConfig exboConfigCreate(double X, int64_t A, int64_t L);
+
+/* As exboConfigCreate(), with an interval table as described for
+ * exboConfigure_TableSize().
+ */
+extern exboConfig exboConfigCreateTabulated(double X, int64_t A, int64_t L, int64_t tableSize);
+
+/* Finishes the configuration of the given instance and returns a shared
+ * copy of it.  Returns 0 if the configuration is invalid or memory is
+ * exhausted.
+ */
+extern exboConfig exboConfigCreateFrom(exbo xp);
+
+extern void exboConfigDestroy(exboConfig cp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboConfigGetTableErrorBound(exboConfig cp);
+
+extern double exboConfigGet_X(exboConfig cp);
+
+extern int64_t exboConfigGet_A(exboConfig cp);
+
+extern int64_t exboConfigGet_L(exboConfig cp);
+
+extern int exboStateInit(exboState *sp);
+
+extern int exboStateRecordAttempt(exboConfig cp, exboState *sp, int64_t time);
+
+/* As exboStateRecordAttempt(), jittering by stream rather than by the
+ * address of sp, so that a seeded config draws the same for the same
+ * stream wherever the state is held.
+ */
+extern int exboStateRecordAttemptStream(exboConfig cp, exboState *sp, int64_t time, uint64_t stream);
+
+/* As exboRecordAttemptWeighted(), for a state with a shared config */
+extern int exboStateRecordAttemptWeighted(exboConfig cp, exboState *sp, int64_t time, int64_t cost);
+
+/* As exboTryAttempt(), for a state with a shared config */
+extern int exboStateTryAttempt(exboConfig cp, exboState *sp, int64_t now, int64_t *waitp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboStateGetPreviousAttemptTime(const exboState *sp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboStateGetNextAttemptTime(const exboState *sp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboStateGetPayBackTime(const exboState *sp);
+
+/* Records an attempt for each of n states held as a structure of arrays:
+ * element k has previous attempt time T[k], debt D[k], interval I[k] and
+ * attempt time time[k], and all share the config cp.  A fresh element
+ * has T[k] == INT64_MIN and D[k] == I[k] == 0.  Each element is updated
+ * as exboStateRecordAttempt() would update it, and results[k] receives
+ * its error number, or its warning (ExboWarn_*) if it has no error.
+ * Where the CPU supports them, AVX-512 or AVX2 kernels handle 8 or 4
+ * elements at a time.  An under-saturated element with X != 1 is solved
+ * for on the scalar path unless cp has an interval table (see
+ * exboConfigure_TableSize()) that covers its J, in which case the
+ * kernels look it up with gathers; the AVX2 kernel does so only for
+ * L < 2^52.  Returns an error only if an argument is missing, in which
+ * case nothing is recorded.
+ */
+extern int exboRecordAttemptBatch(exboConfig cp, size_t n, int64_t *T, int64_t *D, int64_t *I,
+                                  const int64_t *time, int *results);
+
+/* Initializes an atomic state.  This is not itself atomic: call it
+ * before the state is shared.
+ */
+extern int exboAtomicStateInit(exboAtomicState *sp);
+
+/* As exboStateRecordAttempt(), but safe to call from many threads at
+ * once on the same state.  It is lock-free: a racing writer retries on
+ * the state it lost to, so each call is applied as if alone, in some
+ * order consistent with its time check, and returns its error number,
+ * or the warning (ExboWarn_*) of the state it wrote if it has no error.
+ * The config must be finished.
+ * On x86-64 the swap is inlined (cmpxchg16b); on other GCC targets it
+ * may need -latomic.  Elsewhere it returns ExboErr_AtomicUnsupported.
+ */
+extern int exboAtomicStateRecordAttempt(exboConfig cp, exboAtomicState *sp, int64_t time);
+
+/* As exboTryAttempt(), checking and recording in one atomic step.  An
+ * atomic state does not hold I, so unless the debt is paid back by now,
+ * I is recomputed from D for the check; that is floating point work
+ * unless the config uses ExboEngine_Integer.
+ */
+extern int exboAtomicStateTryAttempt(exboConfig cp, exboAtomicState *sp, int64_t now, int64_t *waitp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboAtomicStateGetPreviousAttemptTime(exboAtomicState *sp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboAtomicStateGetNextAttemptTime(exboConfig cp, exboAtomicState *sp);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboAtomicStateGetPayBackTime(exboAtomicState *sp);
+
+/* Creates a registry that holds up to capacity keys, all recorded with
+ * the shared config cp, which must outlive it.  A keySize of 0 makes a
+ * registry of 64-bit keys; otherwise its keys are byte strings of at
+ * most keySize (<= 255) bytes.  The table is allocated once, at about
+ * (33 + keySize + 1) * 8/7 bytes per key, rounded up to a power of two
+ * slots, and never grows.  Returns 0 if an argument is invalid or
+ * memory is exhausted.
+ */
+extern exboRegistry exboRegistryCreate(exboConfig cp, int64_t capacity, size_t keySize);
+
+extern void exboRegistryDestroy(exboRegistry rp);
+
+/* Looks up key, inserting a fresh state if it is absent, and records an
+ * attempt at time now in place, as exboStateRecordAttempt() would.
+ * Each record also sweeps a couple of slots, removing keys whose payback
+ * time is no later than the latest now recorded; such a key behaves as a
+ * fresh one when it is next recorded, so its state need not be kept.
+ * When the registry is full, it is swept whole before an insert fails
+ * with ExboErr_RegistryFull.  The registry thus needs room only for the
+ * keys in debt, provided every now comes from the same clock.
+ */
+extern int exboRegistryRecord(exboRegistry rp, uint64_t key, int64_t now);
+
+extern int exboRegistryRecordBytes(exboRegistry rp, const void *key, size_t length, int64_t now);
+
+/* Returns the state of key, or 0 if it is absent or was reclaimed.  The
+ * state may move when another key is removed.
+ */
+extern const exboState *exboRegistryFind(exboRegistry rp, uint64_t key);
+
+extern const exboState *exboRegistryFindBytes(exboRegistry rp, const void *key, size_t length);
+
+/* Returns 1 if key was removed, 0 if it was absent. */
+extern int exboRegistryRemove(exboRegistry rp, uint64_t key);
+
+extern int exboRegistryRemoveBytes(exboRegistry rp, const void *key, size_t length);
+
+/* Sweeps the whole registry, removing the keys paid back by now, and
+ * returns how many were removed.  To signal an error, this function
+ * returns a value that is less than Exbo_MinimumTime.
+ */
+extern int64_t exboRegistryReclaim(exboRegistry rp, int64_t now);
+
+extern int64_t exboRegistryGetCount(exboRegistry rp);
+
+/* Opens the store file at path, creating it with room for capacity keys
+ * if it does not exist, and maps it into memory.  The file holds a
+ * header with the format version and the X, A and L of cp, followed by
+ * a power-of-two number of 40-byte records, each holding a key, the
+ * config id, and the T, D and I of the key's state, in native byte
+ * order.  Reopening an existing file checks only the header, so it
+ * takes constant time, and every state recorded before carries on at
+ * once; capacity is then ignored.  Fails with ExboErr_StoreFormat or
+ * ExboErr_StoreConfigMismatch if the file was written by another
+ * version, byte order or configuration.  The store holds an exclusive
+ * flock() on the file until it is closed, so a second opening, in this
+ * process or another, such as the next one of a rolling restart, fails
+ * with ExboErr_StoreBusy rather than sharing the records.
+ */
+extern int exboStoreOpen(exboStore *storep, const char *path, exboConfig cp, int64_t capacity);
+
+/* Unmaps the store.  The states stay in the file, and the operating
+ * system writes them back even if the process then exits abruptly; call
+ * exboStoreSync() first for them to survive a machine crash.
+ */
+extern int exboStoreClose(exboStore stp);
+
+/* Waits until the states have been written to the file. */
+extern int exboStoreSync(exboStore stp);
+
+/* As exboRegistryRecord(), with the state kept in the file */
+extern int exboStoreRecord(exboStore stp, uint64_t key, int64_t now);
+
+/* Returns the state of key, or 0 if it is absent.  Removing keys does
+ * not move the state, but recording a new key may, when the store
+ * compacts its removed records to make room.
+ */
+extern const exboState *exboStoreFind(exboStore stp, uint64_t key);
+
+/* Returns 1 if key was removed, 0 if it was absent.  The record is
+ * marked removed by a single 8-byte store and left for a new key to
+ * reuse, so a process that dies while removing leaves the key present
+ * or absent, and every other key where it was.  Every change to the
+ * file is ordered this way, so a crash leaves no key lost or duplicated,
+ * though it may leave the count too high, which only lowers capacity.
+ */
+extern int exboStoreRemove(exboStore stp, uint64_t key);
+
+extern int64_t exboStoreGetCount(exboStore stp);
+
+/* Creates a timing wheel whose time starts at now and advances in ticks
+ * of resolution time units.  An entry is handed back at the first tick
+ * at or after its time, so never early and at most resolution - 1 time
+ * units late.  Returns 0 if resolution is not positive or memory is
+ * exhausted.
+ */
+extern exboWheel exboWheelCreate(int64_t now, int64_t resolution);
+
+/* Entries still scheduled are simply forgotten. */
+extern void exboWheelDestroy(exboWheel wp);
+
+extern int exboWheelEntryInit(exboWheelEntry *ep);
+
+/* Schedules ep at time when, rescheduling it if it is already scheduled.
+ * This and exboWheelCancel() take constant time.
+ */
+extern int exboWheelSchedule(exboWheel wp, exboWheelEntry *ep, int64_t when, void *userData);
+
+/* Returns 1 if ep was scheduled, 0 if it was not. */
+extern int exboWheelCancel(exboWheel wp, exboWheelEntry *ep);
+
+/* Records an attempt as exboRecordAttempt() would and, unless that
+ * fails, schedules ep, with xp as its user data, at the next attempt
+ * time.
+ */
+extern int exboWheelRecordAttempt(exboWheel wp, exboWheelEntry *ep, exbo xp, int64_t time);
+
+/* As exboWheelRecordAttempt(), with sp as the user data */
+extern int exboWheelStateRecordAttempt(exboWheel wp, exboWheelEntry *ep, exboConfig cp, exboState *sp,
+                                       int64_t time);
+
+/* Advances the wheel to now and returns the entries whose time has come,
+ * in no particular order, linked through exboWheelEntryGetNext().  They
+ * are no longer scheduled.  Time does not move backwards: an earlier now
+ * returns only entries scheduled in the past since the last advance.
+ */
+extern exboWheelEntry *exboWheelAdvance(exboWheel wp, int64_t now);
+
+extern exboWheelEntry *exboWheelEntryGetNext(const exboWheelEntry *ep);
+
+extern void *exboWheelEntryGetUserData(const exboWheelEntry *ep);
+
+/* To signal an error, this function returns a value that is less
+ * than Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboWheelEntryGetTime(const exboWheelEntry *ep);
+
+extern int64_t exboWheelGetCount(exboWheel wp);
+
+/* Writes a snapshot of the state and configuration of xp to the first
+ * Exbo_SnapshotSize bytes of buffer, without allocating.  The snapshot
+ * has a fixed layout of little-endian fields, whatever the byte order of
+ * the machine: a magic, a format version, the config flags, the table
+ * size, X (as its IEEE 754 bits), A, L, T, D, I, the jitter seed, a
+ * reserved zero word, and a checksum of the rest.
+ */
+extern int exboSerialize(exbo xp, unsigned char *buffer, size_t size);
+
+/* Replaces the state and configuration of xp with those of a snapshot.
+ * A snapshot whose checksum matches is taken without validating its
+ * configuration again in full, but a finished or validated one must
+ * still have a finite X >= 1 and 0 < A <= L, and any snapshot a known
+ * jitter mode and a state with D, I >= 0.  One that fails these, is of
+ * another version, or does not match its checksum is rejected with
+ * ExboErr_SnapshotCorrupt, leaving xp as it was.  Only a configuration
+ * with an interval table allocates, to rebuild the table.
+ */
+extern int exboDeserialize(exbo xp, const unsigned char *buffer, size_t size);
+
+/* As exboSerialize() for each of the n instances xps[k], into
+ * consecutive snapshots in buffer; results[k] receives the error number
+ * for element k.  Returns an error only if an argument is missing or the
+ * buffer is too small, in which case nothing is written.
+ */
+extern int exboSerializeBatch(const exbo *xps, size_t n, unsigned char *buffer, size_t size, int *results);
+
+/* As exboDeserialize() for each of the n instances xps[k], from
+ * consecutive snapshots in buffer, as for exboSerializeBatch().
+ */
+extern int exboDeserializeBatch(const exbo *xps, size_t n, const unsigned char *buffer, size_t size,
+                                int *results);
+
+/* Selects the source of exboClockNow() and its units per second, which
+ * should match the time base of the configs it is used with; the
+ * default is ExboClock_Monotonic in milliseconds, the units of the
+ * default A.  Configuring ExboClock_Tsc calibrates the counter against
+ * CLOCK_MONOTONIC for about 10ms, and fails with ExboErr_ClockUnsupported
+ * unless the counter is invariant.  The clock is global: configure it
+ * before other threads use it.  On failure the clock is left as it was.
+ */
+extern int exboClockConfigure(int source, int64_t unitsPerSecond);
+
+extern int exboClockGetSource(void);
+
+extern int64_t exboClockGetUnitsPerSecond(void);
+
+/* Returns the time in clock units, never decreasing for ExboClock_Monotonic,
+ * ExboClock_Coarse and ExboClock_Tsc, which share the epoch of
+ * CLOCK_MONOTONIC.  ExboClock_Manual suits an event loop that reads a
+ * clock once per turn and passes it to exboClockSet().  To signal an
+ * error, this function returns a value that is less than
+ * Exbo_MinimumTime, which equals INT64_MIN + ExboErr_MAXIMUM.
+ */
+extern int64_t exboClockNow(void);
+
+/* Sets the time of ExboClock_Manual; it may be called from any thread.
+ * A time less than Exbo_MinimumTime fails with ExboErr_InvalidClockTime.
+ */
+extern int exboClockSet(int64_t now);
+
+/* As exboRecordAttempt(), exboTryAttempt(), exboStateRecordAttempt() and
+ * exboStateTryAttempt() at exboClockNow().
+ */
+extern int exboRecordAttemptNow(exbo xp);
+
+extern int exboTryAttemptNow(exbo xp, int64_t *waitp);
+
+extern int exboStateRecordAttemptNow(exboConfig cp, exboState *sp);
+
+extern int exboStateTryAttemptNow(exboConfig cp, exboState *sp, int64_t *waitp);
+
+/* Returns the time from exboClockNow() until the next attempt time of
+ * xp, or 0 if that has passed.  To signal an error, this function
+ * returns a value that is less than Exbo_MinimumTime.
+ */
+extern int64_t exboGetWaitNow(exbo xp);
+
+/* Sets *statsp to the counts of every attempt recorded so far, by any
+ * thread, through any of the record and try functions.  The counts are
+ * kept only in a library built with -DEXBO_STATS=1, each thread counting
+ * on its own, without locked instructions; this merges them.  Counts are
+ * never reset, so measure a period by the difference of two calls.
+ * Otherwise *statsp is zeroed and ExboErr_StatsDisabled returned.
+ */
+extern int exboGetStats(exboStats *statsp);
+
+/* Makes the attempts recorded or tried through xp by exboRecordAttempt(),
+ * exboRecordAttemptWeighted(), exboTryAttempt() and
+ * exboRecordAttemptLevels() also count in *statsp, the caller's, as
+ * exboGetStats() counts them for the process.  This works whether or not
+ * the library is built with -DEXBO_STATS=1, and costs an instance
+ * without a sink one test per attempt.  *statsp is not zeroed, and must
+ * outlive its use; a statsp of 0 detaches it, as do exboInit() and
+ * exboFini().  Counts are added without locked instructions, so the
+ * instances sharing a sink must record from one thread at a time.
+ */
+extern int exboSetStatsSink(exbo xp, exboStats *statsp);
+
 extern const char *exboGetNanErrorMessage(double nanErrorNumber);
 
 extern const char *exboGetTimeErrorMessage(int64_t timeErrorNumber);
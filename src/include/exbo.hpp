@@ -0,0 +1,551 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright 2016,2018 Daniel F. Fisher                                  ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+#pragma once
+#ifndef included_exbo_exbo_hpp
+#define included_exbo_exbo_hpp
+
+/* The C++17 interface.  Exbo::instance owns an exbo instance, held in
+ * storage from a std::pmr::memory_resource, and reports errors through
+ * Exbo::result instead of the in-band encodings of the C interface.
+ * For configurations known at compile time, Exbo::backoff<X_num, X_den,
+ * A, L> checks its configuration as exboValidateConfig() would, but
+ * while compiling, and tabulates the under-saturated interval as a
+ * constexpr table.  Recording an attempt then reads no configuration and
+ * makes no configuration branch.  (The namespace is Exbo because exbo.h
+ * already declares exbo as a type.)
+ */
+
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <exbo.h>
+#include <exbo_inline.h>
+
+namespace Exbo {
+
+/*********************************
+ * external struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* The previous attempt time T, the debt D and the interval I of one
+ * backoff, laid out as exboState and exboStateLayout.
+ */
+struct state {
+    std::int64_t T = INT64_MIN;
+    std::int64_t D = 0;
+    std::int64_t I = 0;
+};
+
+static_assert(std::is_trivially_copyable<state>::value, "A state must be trivially copyable");
+static_assert(sizeof(state) == sizeof(exboState), "A state must be an exboState");
+static_assert((offsetof(state, T) == offsetof(exboStateLayout, T))
+                  && (offsetof(state, D) == offsetof(exboStateLayout, D))
+                  && (offsetof(state, I) == offsetof(exboStateLayout, I)),
+              "A state must have the layout of exboStateLayout");
+
+/* Copies a state from or to an exboState, as used by the C interface */
+inline state from_exbo_state(const exboState &c) noexcept {
+    exboStateLayout layout;
+    std::memcpy(&layout, &c, sizeof(layout));
+    return state{layout.T, layout.D, layout.I};
+}
+
+inline void to_exbo_state(const state &s, exboState &c) noexcept {
+    const exboStateLayout layout = {s.T, s.D, s.I};
+    std::memcpy(&c, &layout, sizeof(c));
+}
+
+namespace detail {
+
+/* Largest number of entries in a compile-time table */
+constexpr std::size_t maximumSteps = std::size_t(1) << 16;
+
+/* The entry of a table for one J: an excess L - D of at most threshold
+ * needs no more than J, and the interval is then
+ * (A * J - excess) * coefficient.
+ */
+struct step {
+    double threshold;     // A * m(J), where m(J) = J - (1 - X^-J) / (X - 1)
+    double coefficient;   // (X - 1) / (X^J - 1)
+};
+
+/* Returns X^(J+1) - 1 given e = X^J - 1 and d = X - 1.  Carrying X^J - 1
+ * keeps full precision when X is close to 1.  Once X^J is too large to
+ * grow further, the interval it gives rounds up to 1 regardless.
+ */
+constexpr long double grow(long double e, long double d) {
+    return (e < std::numeric_limits<long double>::max() / (2.0L + d)) ? e + d * (1.0L + e) : e;
+}
+
+constexpr double threshold(std::int64_t A, std::size_t J, long double e, long double d) {
+    return static_cast<double>(static_cast<long double>(A)
+                               * (static_cast<long double>(J) - e / ((1.0L + e) * d)));
+}
+
+/* Returns the least J with A * m(J) >= L - A, which is the number of
+ * entries the table needs, or maximumSteps + 1 if that is more.
+ */
+constexpr std::size_t countSteps(long double d, std::int64_t A, std::int64_t L) {
+    // Assert: d > 0
+    std::size_t J = 0;
+    long double e = 0.0L;
+    if (L > A) {
+        const double excess = static_cast<double>(L - A);
+        do {
+            J++;
+            e = grow(e, d);
+        } while ((threshold(A, J, e, d) < excess) && (J <= maximumSteps));
+    }
+    return J;
+}
+
+template <std::size_t N>
+constexpr std::array<step, N> buildSteps(long double d, std::int64_t A) {
+    std::array<step, N> steps{};
+    long double e = 0.0L;
+    for (std::size_t k = 0; k < N; k++) {
+        e = grow(e, d);
+        steps[k].threshold = threshold(A, k + 1, e, d);
+        steps[k].coefficient = static_cast<double>(d / e);
+    }
+    return steps;
+}
+
+} // namespace detail
+
+/*********************************
+ * external class declarations
+ *********************************/
+/* The error (ExboErr_*) that a result holds instead of a value, as
+ * std::unexpected would hold it
+ */
+struct failure {
+    int error;
+};
+
+/* The value of a call, or the error it failed with, in the manner of
+ * std::expected but without exceptions: value() and operator*() must
+ * only be used on a result that has_value().
+ */
+template <typename T>
+class result {
+public:
+    result(T value) noexcept(std::is_nothrow_move_constructible<T>::value) : value_(std::move(value)), error_(0) {}
+    result(failure f) noexcept : value_(), error_(f.error) {}
+
+    bool has_value() const noexcept {
+        return error_ == 0;
+    }
+
+    explicit operator bool() const noexcept {
+        return error_ == 0;
+    }
+
+    T &value() & noexcept {
+        return *value_;
+    }
+
+    const T &value() const & noexcept {
+        return *value_;
+    }
+
+    T &&value() && noexcept {
+        return std::move(*value_);
+    }
+
+    T &operator*() & noexcept {
+        return *value_;
+    }
+
+    const T &operator*() const & noexcept {
+        return *value_;
+    }
+
+    T &&operator*() && noexcept {
+        return std::move(*value_);
+    }
+
+    T *operator->() noexcept {
+        return &*value_;
+    }
+
+    const T *operator->() const noexcept {
+        return &*value_;
+    }
+
+    template <typename U>
+    T value_or(U &&otherwise) const & {
+        return (error_ == 0) ? *value_ : static_cast<T>(std::forward<U>(otherwise));
+    }
+
+    /* Returns the error, or 0 if there is a value */
+    int error() const noexcept {
+        return error_;
+    }
+
+    const char *message() const noexcept {
+        return exboGetErrorMessage(error_);
+    }
+
+private:
+    std::optional<T> value_;
+    int error_;
+};
+
+template <>
+class result<void> {
+public:
+    result() noexcept : error_(0) {}
+    result(failure f) noexcept : error_(f.error) {}
+
+    bool has_value() const noexcept {
+        return error_ == 0;
+    }
+
+    explicit operator bool() const noexcept {
+        return error_ == 0;
+    }
+
+    int error() const noexcept {
+        return error_;
+    }
+
+    const char *message() const noexcept {
+        return exboGetErrorMessage(error_);
+    }
+
+private:
+    int error_;
+};
+
+namespace detail {
+
+/* These decode the errors of the C interface: an error number, a time
+ * below Exbo_MinimumTime, or a NaN tagged with the error number.  A
+ * warning (ExboWarn_*) is not an error.
+ */
+inline result<void> fromStatus(int r) noexcept {
+    return (r <= 0) ? result<void>() : result<void>(failure{r});
+}
+
+inline result<std::int64_t> fromTime(std::int64_t t) noexcept {
+    return (t >= Exbo_MinimumTime) ? result<std::int64_t>(t)
+                                   : result<std::int64_t>(failure{static_cast<int>(t - INT64_MIN)});
+}
+
+inline result<double> fromReal(double x) noexcept {
+    result<double> r(x);
+    if (std::isnan(x)) {
+        // As exboGetNanErrorMessage() extracts it
+        std::uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        r = failure{static_cast<int>(bits & UINT64_C(0x7ffffff))};
+    }
+    return r;
+}
+
+} // namespace detail
+
+/* An exbo instance, created in an exboStorage allocated from a memory
+ * resource and released to it when destroyed.  It is move-only, and at
+ * two pointers it is cheap to hold in containers.  A moved-from instance
+ * is empty: its calls fail with ExboErr_NoInstance.
+ */
+class instance {
+public:
+    /* Creates an instance configured with X, A and L, with its storage
+     * from resource, which must outlive it.  Fails with the error that
+     * exboFinishConfig() reports for an invalid configuration, or with
+     * ExboErr_OutOfMemory.
+     */
+    static result<instance> create(double X, std::int64_t A, std::int64_t L,
+                                   std::pmr::memory_resource *resource = std::pmr::get_default_resource()) noexcept {
+        void *storage;
+#if defined(__cpp_exceptions)
+        try {
+            storage = resource->allocate(sizeof(exboStorage), alignof(exboStorage));
+        } catch (...) {
+            storage = nullptr;
+        }
+#else
+        storage = resource->allocate(sizeof(exboStorage), alignof(exboStorage));
+#endif
+        if (storage == nullptr) {
+            return failure{ExboErr_OutOfMemory};
+        }
+        exbo xp = exboInit(static_cast<exboStorage *>(storage));
+        int r;
+        if (((r = exboConfigure_X(xp, X)) == 0) && ((r = exboConfigure_A(xp, A)) == 0)
+            && ((r = exboConfigure_L(xp, L)) == 0) && ((r = exboFinishConfig(xp)) == 0)) {
+            return instance(xp, resource);
+        }
+        exboFini(xp);
+        resource->deallocate(storage, sizeof(exboStorage), alignof(exboStorage));
+        return failure{r};
+    }
+
+    instance(instance &&other) noexcept : xp_(other.xp_), resource_(other.resource_) {
+        other.xp_ = nullptr;
+    }
+
+    instance &operator=(instance &&other) noexcept {
+        if (this != &other) {
+            reset();
+            xp_ = other.xp_;
+            resource_ = other.resource_;
+            other.xp_ = nullptr;
+        }
+        return *this;
+    }
+
+    instance(const instance &) = delete;
+    instance &operator=(const instance &) = delete;
+
+    ~instance() {
+        reset();
+    }
+
+    /* False once moved from */
+    explicit operator bool() const noexcept {
+        return xp_ != nullptr;
+    }
+
+    /* The C handle, for the rest of the C interface */
+    exbo get() const noexcept {
+        return xp_;
+    }
+
+    std::pmr::memory_resource *resource() const noexcept {
+        return resource_;
+    }
+
+    result<void> record(std::int64_t time) noexcept {
+        return detail::fromStatus(exboRecordAttempt(xp_, time));
+    }
+
+    /* As exboRecordAttemptWeighted() */
+    result<void> record_weighted(std::int64_t time, std::int64_t cost) noexcept {
+        return detail::fromStatus(exboRecordAttemptWeighted(xp_, time, cost));
+    }
+
+    /* As exboTryAttempt(), setting wait to the time remaining */
+    result<void> try_attempt(std::int64_t now, std::int64_t &wait) noexcept {
+        return detail::fromStatus(exboTryAttempt(xp_, now, &wait));
+    }
+
+    result<std::int64_t> previous_attempt_time() const noexcept {
+        return detail::fromTime(exboInlineGetPreviousAttemptTime(xp_));
+    }
+
+    result<std::int64_t> next_attempt_time() const noexcept {
+        return detail::fromTime(exboInlineGetNextAttemptTime(xp_));
+    }
+
+    result<std::int64_t> payback_time() const noexcept {
+        return detail::fromTime(exboInlineGetPayBackTime(xp_));
+    }
+
+    result<double> X() const noexcept {
+        return detail::fromReal(exboGetConfig_X(xp_));
+    }
+
+    result<std::int64_t> A() const noexcept {
+        return detail::fromTime(exboGetConfig_A(xp_));
+    }
+
+    result<std::int64_t> L() const noexcept {
+        return detail::fromTime(exboGetConfig_L(xp_));
+    }
+
+private:
+    instance(exbo xp, std::pmr::memory_resource *resource) noexcept : xp_(xp), resource_(resource) {}
+
+    void reset() noexcept {
+        if (xp_ != nullptr) {
+            exboFini(xp_);
+            resource_->deallocate(xp_, sizeof(exboStorage), alignof(exboStorage));
+            xp_ = nullptr;
+        }
+    }
+
+    exbo xp_;
+    std::pmr::memory_resource *resource_;
+};
+
+/* A backoff with X = X_num / X_den, A and L fixed at compile time.  Its
+ * intervals are those of the double engine, but computed in long double
+ * precision while compiling, so an interval may exceed the library's by
+ * one time unit where the library rounds the other way.
+ */
+template <std::int64_t X_num, std::int64_t X_den, std::int64_t A, std::int64_t L>
+class backoff {
+    // These mirror zConfigValidate_X(), zConfigValidate_A() and
+    // zConfigValidate_L().
+    static_assert(X_den != 0, "The given X is not a finite real number");
+    static_assert((X_den > 0) ? (X_num >= X_den) : (X_num <= X_den), "The given X is not greater than 1");
+    static_assert(A > 0, "The given A is not positive");
+    static_assert(L > 0, "The given L is not positive");
+    static_assert(L >= A, "The given L is less than the given A");
+
+    static constexpr long double d =
+        (static_cast<long double>(X_num) - static_cast<long double>(X_den)) / static_cast<long double>(X_den);
+    static constexpr std::size_t stepCount = (X_num == X_den) ? 0 : detail::countSteps(d, A, L);
+
+    static_assert(stepCount <= detail::maximumSteps, "L / A is too large to tabulate at this X");
+
+    static constexpr std::array<detail::step, stepCount> steps = detail::buildSteps<stepCount>(d, A);
+
+public:
+    static constexpr double X = static_cast<double>(X_num) / static_cast<double>(X_den);
+
+    /* Returns the number of entries in the interval table */
+    static constexpr std::size_t table_size() noexcept {
+        return stepCount;
+    }
+
+    /* As exboStateRecordAttempt(), also setting warning to the warning
+     * (ExboWarn_*) of the attempt, or to 0.
+     */
+    static int record(state &s, std::int64_t time, int &warning) noexcept {
+        int result;
+        warning = 0;
+        if (time >= s.T) {
+            // The sums and differences here wrap, as the checks on them
+            // expect, just as in zStateRecordAttemptWarning().
+            std::int64_t T_diff = static_cast<std::int64_t>(static_cast<std::uint64_t>(time)
+                                                            - static_cast<std::uint64_t>(s.T));
+            std::int64_t D_prime = 0;
+            if (T_diff >= 0) {
+                // T_diff did not overflow
+                if (T_diff < s.I) {
+                    warning = ExboWarn_AttemptIsEarlierThanRecommended;
+                }
+                if (T_diff < s.D) {
+                    D_prime = s.D - T_diff;
+                }
+            }
+            std::int64_t D_out = static_cast<std::int64_t>(static_cast<std::uint64_t>(D_prime)
+                                                           + static_cast<std::uint64_t>(A));
+            std::int64_t I_out;
+            if (D_out >= A) {
+                // D_out did not overflow
+                I_out = interval(D_out, warning);
+            } else {
+                D_out = INT64_MAX;
+                I_out = D_out - (L - A);
+                warning = ExboWarn_ExcessCostLimitBreachWithDebtOverflow;
+            }
+            s.T = time;
+            s.D = D_out;
+            s.I = I_out;
+            result = 0;
+        } else {
+            // The attempts are being recorded out of order
+            result = ExboErr_RecordingAPriorAttempt;
+        }
+        return result;
+    }
+
+    /* As exboStateRecordAttempt(): the error, else the warning */
+    static int record(state &s, std::int64_t time) noexcept {
+        int warning;
+        int result = record(s, time, warning);
+        return (result == 0) ? warning : result;
+    }
+
+    /* To signal an error, these return a value that is less than
+     * Exbo_MinimumTime, as their exboState counterparts do.
+     */
+    static std::int64_t previous_attempt_time(const state &s) noexcept {
+        return (s.T >= Exbo_MinimumTime) ? s.T : Exbo_MinimumTime;
+    }
+
+    static std::int64_t next_attempt_time(const state &s) noexcept {
+        return exboInlineAddSpan(s.T, s.I, ExboErr_StateWithNegativeI, ExboErr_NextTimeOverflow);
+    }
+
+    static std::int64_t payback_time(const state &s) noexcept {
+        return exboInlineAddSpan(s.T, s.D, ExboErr_StateWithNegativeD, ExboErr_PayBackTimeOverflow);
+    }
+
+private:
+    static std::int64_t interval(std::int64_t D, int &warning) noexcept {
+        // Assert: D >= A
+        // As zInterval(), setting warning only if the limit is breached
+        std::int64_t I;
+        if (D < L) {
+            // The excess cost limit is under-saturated.
+            if constexpr (stepCount > 0) {
+                std::int64_t excess = L - D;
+                // The least J whose threshold covers the excess
+                const detail::step *p =
+                    std::lower_bound(steps.data(), steps.data() + stepCount, static_cast<double>(excess),
+                                     [](const detail::step &entry, double value) { return entry.threshold < value; });
+                std::int64_t J = static_cast<std::int64_t>(p - steps.data()) + 1;
+                // A * J - excess = A * (J - l), which may not fit in 64 bits
+                double v = static_cast<double>(static_cast<long double>(A) * static_cast<long double>(J)
+                                               - static_cast<long double>(excess))
+                           * p->coefficient;
+                // v underflows to 0 once X^J is too large.
+                I = (v > 0.0) ? static_cast<std::int64_t>(std::ceil(v)) : std::int64_t(1);
+            } else {
+                // The relaxation factor is 1.0
+                I = A;
+            }
+        } else if (D == L) {
+            // The excess cost limit is saturated.
+            I = A;
+        } else {
+            // The excess cost limit is over-saturated.
+            I = D - (L - A);
+            warning = ExboWarn_ExcessCostLimitBreach;
+        }
+        return I;
+    }
+};
+
+} // namespace Exbo
+
+#endif /* included_exbo_exbo_hpp */
+/*********************************
+ * The End
+ *********************************/
@@ -0,0 +1,473 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright 2016,2018 Daniel F. Fisher                                  ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+#pragma once
+#ifndef included_exbo_exbo_coro_hpp
+#define included_exbo_exbo_coro_hpp
+
+/* The C++20 coroutine interface.  co_await Exbo::wait_ready(target,
+ * scheduler) records an attempt on the target if it is ready now;
+ * otherwise it hands the coroutine to the scheduler to be resumed at the
+ * next attempt time, and records the attempt then.  Nothing is allocated
+ * to wait: the awaiter lives in the coroutine frame.  Exbo::task is a
+ * coroutine type whose frames come from a memory resource, by default a
+ * pool for each thread, so code that starts a task per retry does not
+ * malloc per retry either.
+ */
+
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <algorithm>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+#include <exbo.hpp>
+
+namespace Exbo {
+
+/*********************************
+ * external concept declarations
+ *********************************/
+/* A scheduler tells the time, in the units of the backoff, and resumes a
+ * coroutine at or after a given time.
+ */
+template <typename S>
+concept scheduler = requires(S &s, std::int64_t time, std::coroutine_handle<> h) {
+    { s.now() } -> std::convertible_to<std::int64_t>;
+    s.schedule_at(time, h);
+};
+
+/* What wait_ready() backs off: try_attempt() behaves as exboTryAttempt() */
+template <typename T>
+concept attempt_target = requires(T &t, std::int64_t now, std::int64_t &wait) {
+    { t.try_attempt(now, wait) } -> std::same_as<int>;
+};
+
+namespace detail {
+
+/* The targets of the C interface */
+struct instanceTarget {
+    exbo xp;
+
+    int try_attempt(std::int64_t now, std::int64_t &wait) noexcept {
+        return exboTryAttempt(xp, now, &wait);
+    }
+};
+
+struct stateTarget {
+    exboConfig cp;
+    exboState *sp;
+
+    int try_attempt(std::int64_t now, std::int64_t &wait) noexcept {
+        return exboStateTryAttempt(cp, sp, now, &wait);
+    }
+};
+
+struct atomicStateTarget {
+    exboConfig cp;
+    exboAtomicState *sp;
+
+    int try_attempt(std::int64_t now, std::int64_t &wait) noexcept {
+        return exboAtomicStateTryAttempt(cp, sp, now, &wait);
+    }
+};
+
+/* A state of Backoff, a backoff<X_num, X_den, A, L> */
+template <typename Backoff>
+struct backoffTarget {
+    state *sp;
+
+    int try_attempt(std::int64_t now, std::int64_t &wait) noexcept {
+        // As zStateTryAttempt()
+        int result;
+        std::int64_t next = Backoff::next_attempt_time(*sp);
+        wait = 0;
+        if (next >= Exbo_MinimumTime) {
+            if (now >= next) {
+                result = Backoff::record(*sp, now);
+            } else {
+                // The difference may not fit; clamp it as zReady() does.
+                std::uint64_t remaining = static_cast<std::uint64_t>(next) - static_cast<std::uint64_t>(now);
+                wait = (remaining > static_cast<std::uint64_t>(INT64_MAX)) ? INT64_MAX
+                                                                          : static_cast<std::int64_t>(remaining);
+                result = ExboErr_AttemptNotReady;
+            }
+        } else {
+            result = static_cast<int>(next - INT64_MIN);
+        }
+        return result;
+    }
+};
+
+} // namespace detail
+
+/*********************************
+ * external class declarations
+ *********************************/
+/* The awaiter returned by wait_ready().  Awaiting it yields a
+ * result<void>: empty if the attempt was recorded, or the error that
+ * try_attempt() reported.  If another attempt on a shared target was
+ * recorded while this one waited, the error is ExboErr_AttemptNotReady,
+ * and awaiting wait_ready() again waits for the new next attempt time.
+ */
+template <attempt_target Target, scheduler Scheduler>
+class ready_awaiter {
+public:
+    ready_awaiter(Target target, Scheduler &scheduler) noexcept : target_(target), scheduler_(&scheduler) {}
+
+    bool await_ready() noexcept {
+        std::int64_t now = scheduler_->now();
+        std::int64_t wait = 0;
+        status_ = target_.try_attempt(now, wait);
+        // wait is not negative, so only a positive now can overflow.
+        due_ = ((now > 0) && (wait > INT64_MAX - now)) ? INT64_MAX : now + wait;
+        return status_ != ExboErr_AttemptNotReady;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        scheduler_->schedule_at(due_, h);
+    }
+
+    result<void> await_resume() noexcept {
+        if (status_ == ExboErr_AttemptNotReady) {
+            // Resumed at or after due_
+            std::int64_t wait = 0;
+            status_ = target_.try_attempt(scheduler_->now(), wait);
+        }
+        return detail::fromStatus(status_);
+    }
+
+private:
+    Target target_;
+    Scheduler *scheduler_;
+    int status_ = 0;
+    std::int64_t due_ = 0;
+};
+
+/* A single-threaded scheduler over simulated time: run_one() moves now()
+ * forward to the earliest timer and resumes its coroutine, rather than
+ * sleeping.  It is the reference for schedulers over a real clock, which
+ * need only the same now() and schedule_at().  Its timer heap grows from
+ * resource, and once grown is reused without allocating.
+ */
+class simple_executor {
+public:
+    explicit simple_executor(std::int64_t start = 0,
+                             std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : timers_(resource), now_(start) {}
+
+    simple_executor(const simple_executor &) = delete;
+    simple_executor &operator=(const simple_executor &) = delete;
+
+    /* Coroutines still waiting are left suspended: their owners destroy
+     * them.
+     */
+    ~simple_executor() = default;
+
+    std::int64_t now() const noexcept {
+        return now_;
+    }
+
+    /* Resumes h at time, or at the next run_one() if time has passed */
+    void schedule_at(std::int64_t time, std::coroutine_handle<> h) {
+        timers_.push_back(timer{time, sequence_++, h});
+        std::push_heap(timers_.begin(), timers_.end(), later);
+    }
+
+    /* Resumes the coroutine with the earliest time, those with equal times
+     * in the order they were scheduled.  Returns false if there is none.
+     */
+    bool run_one() {
+        if (timers_.empty()) {
+            return false;
+        }
+        std::pop_heap(timers_.begin(), timers_.end(), later);
+        timer next = timers_.back();
+        timers_.pop_back();
+        if (next.time > now_) {
+            now_ = next.time;
+        }
+        next.h.resume();
+        return true;
+    }
+
+    /* Runs until no coroutine is waiting, returning the number resumed */
+    std::size_t run() {
+        std::size_t n = 0;
+        while (run_one()) {
+            n++;
+        }
+        return n;
+    }
+
+    std::size_t pending() const noexcept {
+        return timers_.size();
+    }
+
+    void reserve(std::size_t n) {
+        timers_.reserve(n);
+    }
+
+private:
+    struct timer {
+        std::int64_t time;
+        std::uint64_t sequence;
+        std::coroutine_handle<> h;
+    };
+
+    static bool later(const timer &a, const timer &b) noexcept {
+        return (a.time != b.time) ? (a.time > b.time) : (a.sequence > b.sequence);
+    }
+
+    std::pmr::vector<timer> timers_;
+    std::int64_t now_;
+    std::uint64_t sequence_ = 0;
+};
+
+namespace detail {
+
+inline std::pmr::memory_resource *&threadFrameResource() noexcept {
+    thread_local std::pmr::memory_resource *resource = nullptr;
+    return resource;
+}
+
+inline std::pmr::memory_resource *threadFramePool() noexcept {
+    thread_local std::pmr::unsynchronized_pool_resource pool;
+    return &pool;
+}
+
+/* A frame is followed by the resource it came from, so that it can be
+ * returned there.
+ */
+constexpr std::size_t frameAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+constexpr std::size_t frameBytes(std::size_t size) noexcept {
+    return (size + alignof(std::pmr::memory_resource *) - 1) / alignof(std::pmr::memory_resource *)
+               * alignof(std::pmr::memory_resource *)
+           + sizeof(std::pmr::memory_resource *);
+}
+
+inline void *frameAllocate(std::size_t size, std::pmr::memory_resource *resource) noexcept {
+    void *p;
+    std::size_t offset = frameBytes(size) - sizeof(std::pmr::memory_resource *);
+#if defined(__cpp_exceptions)
+    try {
+        p = resource->allocate(frameBytes(size), frameAlignment);
+    } catch (...) {
+        p = nullptr;
+    }
+#else
+    p = resource->allocate(frameBytes(size), frameAlignment);
+#endif
+    if (p != nullptr) {
+        std::memcpy(static_cast<unsigned char *>(p) + offset, &resource, sizeof(resource));
+    }
+    return p;
+}
+
+inline void frameFree(void *p, std::size_t size) noexcept {
+    std::pmr::memory_resource *resource;
+    std::size_t offset = frameBytes(size) - sizeof(std::pmr::memory_resource *);
+    std::memcpy(&resource, static_cast<const unsigned char *>(p) + offset, sizeof(resource));
+    resource->deallocate(p, frameBytes(size), frameAlignment);
+}
+
+} // namespace detail
+
+/* The resource that task frames of this thread come from, unless a task
+ * is given one.  By default it is a std::pmr::unsynchronized_pool_resource
+ * of the thread, so a frame must be destroyed on the thread that created
+ * it, before that thread exits.
+ */
+inline std::pmr::memory_resource *frame_resource() noexcept {
+    std::pmr::memory_resource *resource = detail::threadFrameResource();
+    return (resource != nullptr) ? resource : detail::threadFramePool();
+}
+
+/* Sets the frame resource of this thread, or restores the default if
+ * resource is null, and returns the one it replaces.
+ */
+inline std::pmr::memory_resource *set_frame_resource(std::pmr::memory_resource *resource) noexcept {
+    return std::exchange(detail::threadFrameResource(), resource);
+}
+
+/* Makes resource the frame resource of this thread for the scope's
+ * lifetime, so that the tasks started in the scope take their frames
+ * from it.  Each frame goes back to the resource it came from, so a task
+ * may outlive the scope, though not the resource.
+ */
+class frame_resource_scope {
+public:
+    explicit frame_resource_scope(std::pmr::memory_resource *resource) noexcept
+        : previous_(set_frame_resource(resource)) {}
+
+    frame_resource_scope(const frame_resource_scope &) = delete;
+    frame_resource_scope &operator=(const frame_resource_scope &) = delete;
+
+    ~frame_resource_scope() {
+        set_frame_resource(previous_);
+    }
+
+private:
+    std::pmr::memory_resource *previous_;
+};
+
+/* A coroutine that starts at once and runs until it first waits.  Its
+ * frame comes from frame_resource(), which a frame_resource_scope can
+ * set around the call.  If the frame cannot be allocated, the task is
+ * empty and the coroutine does not run.  Destroying a task destroys its
+ * coroutine, so a task must outlive its waits.
+ */
+class task {
+public:
+    class promise_type {
+    public:
+        task get_return_object() noexcept {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        static task get_return_object_on_allocation_failure() noexcept {
+            return task(nullptr);
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+
+        // The only allocation function, so that every frame is freed by
+        // its matching operator delete.
+        static void *operator new(std::size_t size) noexcept {
+            return detail::frameAllocate(size, frame_resource());
+        }
+
+        static void operator delete(void *p, std::size_t size) noexcept {
+            detail::frameFree(p, size);
+        }
+    };
+
+    task(task &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+
+    task &operator=(task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            h_ = std::exchange(other.h_, nullptr);
+        }
+        return *this;
+    }
+
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    ~task() {
+        reset();
+    }
+
+    /* False if the frame could not be allocated, or once moved from */
+    explicit operator bool() const noexcept {
+        return static_cast<bool>(h_);
+    }
+
+    /* True once the coroutine has returned */
+    bool done() const noexcept {
+        return h_ && h_.done();
+    }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+
+    void reset() noexcept {
+        if (h_) {
+            h_.destroy();
+            h_ = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> h_;
+};
+
+/*********************************
+ * external function definitions
+ *********************************/
+/* Awaitables that back off an instance, a state with a shared config,
+ * an atomic state, or a state of Backoff, a backoff<X_num, X_den, A, L>,
+ * using scheduler s.  The target and the scheduler must outlive the wait.
+ */
+template <scheduler Scheduler>
+ready_awaiter<detail::instanceTarget, Scheduler> wait_ready(instance &x, Scheduler &s) noexcept {
+    return {detail::instanceTarget{x.get()}, s};
+}
+
+template <scheduler Scheduler>
+ready_awaiter<detail::stateTarget, Scheduler> wait_ready(exboConfig cp, exboState &st, Scheduler &s) noexcept {
+    return {detail::stateTarget{cp, &st}, s};
+}
+
+template <scheduler Scheduler>
+ready_awaiter<detail::atomicStateTarget, Scheduler> wait_ready(exboConfig cp, exboAtomicState &st,
+                                                               Scheduler &s) noexcept {
+    return {detail::atomicStateTarget{cp, &st}, s};
+}
+
+template <typename Backoff, scheduler Scheduler>
+ready_awaiter<detail::backoffTarget<Backoff>, Scheduler> wait_ready(state &st, Scheduler &s) noexcept {
+    return {detail::backoffTarget<Backoff>{&st}, s};
+}
+
+/* Any other target with try_attempt() */
+template <attempt_target Target, scheduler Scheduler>
+ready_awaiter<Target, Scheduler> wait_ready_on(Target target, Scheduler &s) noexcept {
+    return {target, s};
+}
+
+} // namespace Exbo
+
+#endif /* included_exbo_exbo_coro_hpp */
+/*********************************
+ * The End
+ *********************************/
@@ -0,0 +1,142 @@
+/******************************************************************************
+ ******************************************************************************
+ ***                                                                        ***
+ ***  MIT License                                                           ***
+ ***                                                                        ***
+ ***  Copyright 2016,2018 Daniel F. Fisher                                  ***
+ ***                                                                        ***
+ ***  Permission is hereby granted, free of charge, to any person           ***
+ ***  obtaining a copy of this software and associated documentation files  ***
+ ***  (the "Software"), to deal in the Software without restriction,        ***
+ ***  including without limitation the rights to use, copy, modify, merge,  ***
+ ***  publish, distribute, sublicense, and/or sell copies of the Software,  ***
+ ***  and to permit persons to whom the Software is furnished to do so,     ***
+ ***  subject to the following conditions:                                  ***
+ ***                                                                        ***
+ ***  The above copyright notice and this permission notice shall be        ***
+ ***  included in all copies or substantial portions of the Software.       ***
+ ***                                                                        ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       ***
+ ***  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    ***
+ ***  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                 ***
+ ***  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS   ***
+ ***  BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN    ***
+ ***  ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN     ***
+ ***  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE      ***
+ ***  SOFTWARE.                                                             ***
+ ***                                                                        ***
+ ******************************************************************************
+ ******************************************************************************/
+
+#pragma once
+#ifndef included_exbo_exbo_inline_h
+#define included_exbo_exbo_inline_h
+
+/* Optional inline versions of the read accessors.  Each returns exactly
+ * what its namesake in exbo.h returns, but compiles to a few integer
+ * instructions at the call site instead of a call into the library.
+ * This header needs C99 or C++.
+ */
+
+/*********************************
+ * header file inclusions
+ *********************************/
+#include <exbo.h>
+
+/*********************************
+ * external macro declarations
+ *********************************/
+
+/*********************************
+ * external struct, union,
+ * typedef and enum declarations
+ *********************************/
+/* The layout of an exboState, which is also the start of every exbo
+ * instance: the previous attempt time T, the debt D and the interval I.
+ * A fresh state has T == INT64_MIN and D == I == 0.
+ */
+typedef struct exboStateLayout {
+    int64_t T;
+    int64_t D;
+    int64_t I;
+} exboStateLayout;
+
+/*********************************
+ * external function definitions
+ *********************************/
+/* Returns time + span, or Exbo_MinimumTime if that is earlier.  To
+ * signal an error, it returns INT64_MIN + negativeError if span is
+ * negative, and INT64_MIN + overflowError if the sum overflows.
+ */
+static inline int64_t exboInlineAddSpan(int64_t time, int64_t span, int negativeError, int overflowError) {
+    int64_t result;
+    if (span >= (int64_t)0) {
+        int64_t sum = (int64_t)((uint64_t)time + (uint64_t)span);   // wraps on overflow
+        if (sum >= time) {
+            // silently mask an underflow
+            result = (sum >= Exbo_MinimumTime) ? sum : Exbo_MinimumTime;
+        } else {
+            result = INT64_MIN + overflowError;
+        }
+    } else {
+        result = INT64_MIN + negativeError;
+    }
+    return result;
+}
+
+static inline int64_t exboInlineLayoutGetPreviousAttemptTime(const exboStateLayout *p) {
+    // silently mask the T underflow
+    return (p->T >= Exbo_MinimumTime) ? p->T : Exbo_MinimumTime;
+}
+
+static inline int64_t exboInlineLayoutGetNextAttemptTime(const exboStateLayout *p) {
+    return exboInlineAddSpan(p->T, p->I, ExboErr_StateWithNegativeI, ExboErr_NextTimeOverflow);
+}
+
+static inline int64_t exboInlineLayoutGetPayBackTime(const exboStateLayout *p) {
+    return exboInlineAddSpan(p->T, p->D, ExboErr_StateWithNegativeD, ExboErr_PayBackTimeOverflow);
+}
+
+/* As exboGetPreviousAttemptTime() */
+static inline int64_t exboInlineGetPreviousAttemptTime(exbo xp) {
+    return (xp != (exbo)0) ? exboInlineLayoutGetPreviousAttemptTime((const exboStateLayout *)(const void *)xp)
+                           : INT64_MIN + ExboErr_NoInstance;
+}
+
+/* As exboGetNextAttemptTime() */
+static inline int64_t exboInlineGetNextAttemptTime(exbo xp) {
+    return (xp != (exbo)0) ? exboInlineLayoutGetNextAttemptTime((const exboStateLayout *)(const void *)xp)
+                           : INT64_MIN + ExboErr_NoInstance;
+}
+
+/* As exboGetPayBackTime() */
+static inline int64_t exboInlineGetPayBackTime(exbo xp) {
+    return (xp != (exbo)0) ? exboInlineLayoutGetPayBackTime((const exboStateLayout *)(const void *)xp)
+                           : INT64_MIN + ExboErr_NoInstance;
+}
+
+/* As exboStateGetPreviousAttemptTime() */
+static inline int64_t exboInlineStateGetPreviousAttemptTime(const exboState *sp) {
+    return (sp != (const exboState *)0)
+               ? exboInlineLayoutGetPreviousAttemptTime((const exboStateLayout *)(const void *)sp)
+               : INT64_MIN + ExboErr_NoInstance;
+}
+
+/* As exboStateGetNextAttemptTime() */
+static inline int64_t exboInlineStateGetNextAttemptTime(const exboState *sp) {
+    return (sp != (const exboState *)0)
+               ? exboInlineLayoutGetNextAttemptTime((const exboStateLayout *)(const void *)sp)
+               : INT64_MIN + ExboErr_NoInstance;
+}
+
+/* As exboStateGetPayBackTime() */
+static inline int64_t exboInlineStateGetPayBackTime(const exboState *sp) {
+    return (sp != (const exboState *)0)
+               ? exboInlineLayoutGetPayBackTime((const exboStateLayout *)(const void *)sp)
+               : INT64_MIN + ExboErr_NoInstance;
+}
+
+#endif /* included_exbo_exbo_inline_h */
+/*********************************
+ * The End
+ *********************************/